@@ -0,0 +1,84 @@
+#include "AllocationTracker.h"
+
+#if defined(INTEGRATOR_ALLOCATION_CHECK)
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include "Eigen/Core"
+
+#if !defined(EIGEN_RUNTIME_NO_MALLOC)
+#error "allocation checking needs EIGEN_RUNTIME_NO_MALLOC defined everywhere Eigen is used"
+#endif
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+thread_local int        t_depth = 0;
+thread_local long long  t_count = 0;
+
+// threads inside a scope; Eigen's switch is off while there are any
+std::mutex              s_scopeMutex;
+int                     s_threadsInScope = 0;
+
+void *allocate(std::size_t size)
+{
+    if (t_depth > 0) ++t_count;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+}
+
+void *operator new(std::size_t size)                                { return allocate(size); }
+void *operator new[](std::size_t size)                              { return allocate(size); }
+void operator delete(void *p) noexcept                              { std::free(p); }
+void operator delete[](void *p) noexcept                            { std::free(p); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    if (t_depth > 0) ++t_count;
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &t) noexcept
+{
+    return operator new(size, t);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept      { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept    { std::free(p); }
+
+// --------------------------------------------------------------------------
+
+bool AllocationTracker::isEnabled()     { return true; }
+long long AllocationTracker::count()    { return t_count; }
+void AllocationTracker::reset()         { t_count = 0; }
+
+void AllocationTracker::enterScope()
+{
+    if (t_depth++ > 0) return;
+    std::lock_guard<std::mutex> lock(s_scopeMutex);
+    if (s_threadsInScope++ == 0) Eigen::internal::set_is_malloc_allowed(false);
+}
+
+void AllocationTracker::leaveScope()
+{
+    if (--t_depth > 0) return;
+    std::lock_guard<std::mutex> lock(s_scopeMutex);
+    if (--s_threadsInScope == 0) Eigen::internal::set_is_malloc_allowed(true);
+}
+
+#else
+
+bool AllocationTracker::isEnabled()     { return false; }
+long long AllocationTracker::count()    { return 0; }
+void AllocationTracker::reset()         {}
+void AllocationTracker::enterScope()    {}
+void AllocationTracker::leaveScope()    {}
+
+#endif
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,54 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+// --------------------------------------------------------------------------
+
+// Checks that hot paths leave the heap alone.  Code that must not allocate
+// is wrapped in a NoAllocationScope.  In builds with
+// INTEGRATOR_ALLOCATION_CHECK defined (qmake CONFIG+=alloc_check) two
+// things then happen:
+//
+//   - the global operator new is replaced, and counts the allocations made
+//     inside a scope on the calling thread;
+//   - Eigen, which allocates with malloc rather than new, is built with
+//     EIGEN_RUNTIME_NO_MALLOC, and asserts if it allocates inside a scope.
+//
+// Eigen's switch is process-wide: it is turned off when the first thread
+// enters a scope and back on when the last one leaves, so while any thread
+// is in a scope an Eigen allocation on any thread asserts.  Scopes are
+// therefore meant for single-threaded checks such as ./Benchmark
+// allocations, not for code that runs alongside other work.  The check
+// needs Eigen's assertions (i.e. no NDEBUG).  In other builds a scope
+// compiles to nothing.
+
+namespace AllocationTracker {
+
+// true if allocation checking was compiled in
+bool isEnabled();
+
+// allocations made by this thread inside scopes since the last reset
+long long count();
+void reset();
+
+void enterScope();
+void leaveScope();
+
+}
+
+class NoAllocationScope
+{
+    NoAllocationScope(const NoAllocationScope &);
+    NoAllocationScope &operator=(const NoAllocationScope &);
+
+public:
+#if defined(INTEGRATOR_ALLOCATION_CHECK)
+    NoAllocationScope()     { AllocationTracker::enterScope(); }
+    ~NoAllocationScope()    { AllocationTracker::leaveScope(); }
+#else
+    NoAllocationScope()     {}
+#endif
+};
+
+// --------------------------------------------------------------------------
+
+#endif // ALLOCATIONTRACKER_H
@@ -0,0 +1,286 @@
+#include "AutoTuner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "Eigen/StdVector"
+#include "Machine.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef vector<Vector2d, aligned_allocator<Vector2d> > Trajectory;
+
+const int       k_maxHalvings       = 12;       // smallest step tried is 1/4096 of the largest
+const double    k_loosestTolerance  = 1e-3;
+const double    k_tightestTolerance = 1e-12;
+const double    k_referenceTolerance = 1e-13;
+const double    k_minTimingSeconds  = 0.005;
+
+class ModelODE : public LinearODE<Vector2d, Matrix2d>
+{
+    Matrix2d m_matrixA;
+    Vector2d m_vectorB;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    ModelODE(const Matrix2d &A, const Vector2d &b) : m_matrixA(A), m_vectorB(b) {}
+
+    virtual Vector2d derivativeFunction(double t, const Vector2d &y) const
+    {
+        return m_matrixA * y + m_vectorB;
+    }
+
+    virtual void derivative(double t, const Vector2d &y, Vector2d &dy) const
+    {
+        dy.noalias() = m_matrixA * y;
+        dy += m_vectorB;
+    }
+
+    virtual const Matrix2d &matrixA() const { return m_matrixA; }
+    virtual const Vector2d &vectorB() const { return m_vectorB; }
+};
+
+void start(IntegratorVariant<Vector2d, Matrix2d> &integrator, ModelODE &ode, IntegratorType type,
+           double dt, double tolerance, const Vector2d &initial)
+{
+    integrator.create(type, &ode, dt);
+    integrator.setTimeStep(dt);
+    integrator.setTolerance(tolerance);
+    integrator.setState(initial);
+}
+
+// the largest error against the reference, which holds the state at every
+// stepsPerSample steps; infinite if the run blows up
+double maxError(ModelODE &ode, IntegratorType type, double dt, double tolerance,
+                int stepsPerSample, const Trajectory &reference)
+{
+    IntegratorVariant<Vector2d, Matrix2d> integrator;
+    start(integrator, ode, type, dt, tolerance, reference[0]);
+
+    double worst = 0.0;
+    for (size_t s = 1; s < reference.size(); ++s) {
+        for (int i = 0; i < stepsPerSample; ++i) integrator.step();
+        double e = (integrator.state() - reference[s]).cwiseAbs().maxCoeff();
+        if (!(e < numeric_limits<double>::max())) return numeric_limits<double>::infinity();
+        if (e > worst) worst = e;
+    }
+    return worst;
+}
+
+// wall time for the given number of steps, averaged over enough runs to
+// rise above the clock's resolution
+double runTime(ModelODE &ode, IntegratorType type, double dt, double tolerance,
+               long long steps, const Vector2d &initial)
+{
+    typedef chrono::steady_clock Clock;
+
+    IntegratorVariant<Vector2d, Matrix2d> integrator;
+    int runs = 0;
+    double seconds = 0.0;
+    Clock::time_point begin = Clock::now();
+    do {
+        start(integrator, ode, type, dt, tolerance, initial);
+        for (long long i = 0; i < steps; ++i) integrator.step();
+        ++runs;
+        seconds = chrono::duration<double>(Clock::now() - begin).count();
+    } while (seconds < k_minTimingSeconds);
+    return seconds / runs;
+}
+
+// 64-bit FNV-1a, as sixteen hex digits
+string fnv1a(const string &text)
+{
+    unsigned long long h = 14695981039346656037ull;
+    for (size_t i = 0; i < text.size(); ++i) {
+        h ^= (unsigned char)(text[i]);
+        h *= 1099511628211ull;
+    }
+    ostringstream out;
+    out.width(16);
+    out.fill('0');
+    out << hex << h;
+    return out.str();
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+AutoTuner::AutoTuner(const string &cacheFile)
+    : m_cacheFile(cacheFile), m_loaded(false), m_dirty(false), m_horizon(1.0), m_calibrations(0)
+{}
+
+AutoTuner::~AutoTuner()
+{
+    flush();
+}
+
+void AutoTuner::setCacheFile(const string &filename)
+{
+    flush();
+    m_cacheFile = filename;
+    m_loaded = false;
+}
+
+string AutoTuner::signature(const Matrix2d &A, const Vector2d &b, const Vector2d &initial,
+                            double accuracy, double maxTimeStep) const
+{
+    ostringstream text;
+    text.precision(17);
+    text << Machine::cpuName() << ";"
+         << A(0, 0) << "," << A(0, 1) << "," << A(1, 0) << "," << A(1, 1) << ";"
+         << b(0) << "," << b(1) << ";" << initial(0) << "," << initial(1) << ";"
+         << accuracy << ";" << maxTimeStep << ";" << m_horizon;
+    return fnv1a(text.str());
+}
+
+// Cache files are plain text, one choice per line:
+//
+//      <signature> <integrator> <dt> <tolerance> <error> <cost>
+//
+// Lines that cannot be read are skipped, so a damaged cache only costs a
+// recalibration.
+
+void AutoTuner::loadCache()
+{
+    m_loaded = true;
+    if (m_cacheFile.empty()) return;
+
+    ifstream in(m_cacheFile.c_str());
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string key, name;
+        TuningChoice c;
+        if (fields >> key >> name >> c.timeStep >> c.tolerance >> c.error >> c.cost &&
+            parseIntegratorType(name, &c.type))
+            m_choices[key] = c;
+    }
+}
+
+bool AutoTuner::saveCache(string *error) const
+{
+    ofstream out(m_cacheFile.c_str());
+    out << "# integrator tuning cache: signature integrator dt tolerance error cost\n";
+    out.precision(17);
+    for (map<string, TuningChoice>::const_iterator i = m_choices.begin(); i != m_choices.end(); ++i)
+        out << i->first << " " << integratorName(i->second.type) << " " << i->second.timeStep
+            << " " << i->second.tolerance << " " << i->second.error << " " << i->second.cost << "\n";
+
+    out.close();
+    if (!out) {
+        if (error) *error = "could not write " + m_cacheFile;
+        return false;
+    }
+    return true;
+}
+
+bool AutoTuner::flush(string *error)
+{
+    if (!m_dirty || m_cacheFile.empty()) return true;
+    if (!saveCache(error)) return false;
+    m_dirty = false;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool AutoTuner::choose(const Matrix2d &A, const Vector2d &b, const Vector2d &initial,
+                       double accuracy, double maxTimeStep, TuningChoice *choice, string *error)
+{
+    if (!(maxTimeStep > 0.0)) {
+        if (error) *error = "the largest time step must be positive";
+        return false;
+    }
+    if (!m_loaded) loadCache();
+
+    string key = signature(A, b, initial, accuracy, maxTimeStep);
+    map<string, TuningChoice>::const_iterator cached = m_choices.find(key);
+    if (cached != m_choices.end()) {
+        *choice = cached->second;
+    }
+    else
+    {
+        ModelODE ode(A, b);
+
+        // the reference, sampled at every largest step over the horizon
+        int samples = max(1, int(floor(m_horizon / maxTimeStep + 0.5)));
+        Trajectory reference(1, initial);
+        {
+            IntegratorVariant<Vector2d, Matrix2d> integrator;
+            start(integrator, ode, DormandPrince, maxTimeStep, k_referenceTolerance, initial);
+            for (int s = 0; s < samples; ++s) {
+                integrator.step();
+                reference.push_back(integrator.state());
+            }
+        }
+
+        TuningChoice best, mostAccurate;
+        bool found = false;
+        mostAccurate.error = numeric_limits<double>::infinity();
+
+        for (int i = 0; i < IntegratorTypeCount; ++i)
+        {
+            IntegratorType type = IntegratorType(i);
+            bool adaptive = type == DormandPrince;
+
+            // the loosest setting that meets the target
+            for (int k = 0; k <= k_maxHalvings; ++k)
+            {
+                TuningChoice c;
+                c.type = type;
+                int stepsPerSample = 1;
+                if (adaptive) {
+                    c.timeStep = maxTimeStep;
+                    c.tolerance = k_loosestTolerance * pow(0.1, k);
+                    if (c.tolerance < k_tightestTolerance) break;
+                }
+                else {
+                    stepsPerSample = 1 << k;
+                    c.timeStep = maxTimeStep / stepsPerSample;
+                }
+
+                c.error = maxError(ode, type, c.timeStep, c.tolerance, stepsPerSample, reference);
+                if (c.error < mostAccurate.error) mostAccurate = c;
+                if (c.error > accuracy) continue;
+
+                c.cost = runTime(ode, type, c.timeStep, c.tolerance,
+                                 (long long)(samples) * stepsPerSample, initial)
+                         / (samples * maxTimeStep);
+                if (!found || c.cost < best.cost) best = c;
+                found = true;
+                break;
+            }
+        }
+
+        *choice = found ? best : mostAccurate;
+        m_choices[key] = *choice;
+        ++m_calibrations;
+        m_dirty = true;
+    }
+
+    if (!(choice->error <= accuracy)) {
+        if (error) {
+            ostringstream message;
+            message << "no integrator reaches an error of " << accuracy
+                    << "; the most accurate reaches " << choice->error;
+            *error = message.str();
+        }
+        return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include <map>
+#include <string>
+
+#include "Eigen/Core"
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// The integrator settings picked for a model.  cost is the wall time
+// taken per simulated second on the machine that did the calibration.
+
+struct TuningChoice
+{
+    IntegratorType  type;
+    double          timeStep;
+    double          tolerance;      // zero for the fixed-step integrators
+    double          error;
+    double          cost;
+
+    TuningChoice()
+        : type(RungeKutta4), timeStep(0.0), tolerance(0.0), error(0.0), cost(0.0) {}
+};
+
+// --------------------------------------------------------------------------
+
+// Picks the fastest integrator and time step that keep a spring model
+// y' = Ay + b within an accuracy target.
+//
+// Calibration integrates the model from the given initial state for a
+// short horizon with every integrator, halving the time step from the
+// largest allowed (or, for the adaptive integrator, tightening its
+// tolerance) until the largest error against a tightly converged reference
+// meets the target, and times each one that does.  The time steps tried
+// all divide the largest, so the springs still land on every frame.
+//
+// Choices are remembered by a signature of the model, target and CPU, and
+// if a cache file is set they are kept there, so a later run on the same
+// machine skips calibration.  New choices are written out by flush(), or
+// when the tuner is destroyed, rather than one by one as they are made.
+
+class AutoTuner
+{
+    std::string                         m_cacheFile;
+    std::map<std::string, TuningChoice> m_choices;
+    bool                                m_loaded;
+    bool                                m_dirty;        // choices not yet in the cache file
+    double                              m_horizon;
+    int                                 m_calibrations;
+
+    void loadCache();
+    bool saveCache(std::string *error) const;
+
+    std::string signature(const Eigen::Matrix2d &A, const Eigen::Vector2d &b,
+                          const Eigen::Vector2d &initial, double accuracy,
+                          double maxTimeStep) const;
+
+public:
+    explicit AutoTuner(const std::string &cacheFile = "");
+    ~AutoTuner();
+
+    // an empty name keeps choices in memory only; choices not yet written
+    // go to the old file first
+    void setCacheFile(const std::string &filename);
+    const std::string &cacheFile() const    { return m_cacheFile; }
+
+    // simulated seconds integrated by each calibration run (default 1)
+    void setHorizon(double seconds)         { m_horizon = seconds; }
+
+    // models calibrated so far, as opposed to found in the cache
+    int calibrations() const                { return m_calibrations; }
+
+    // Chooses settings for the model.  Returns false if no setting met the
+    // accuracy, in which case choice is the most accurate one tried and
+    // error says so.
+    bool choose(const Eigen::Matrix2d &A, const Eigen::Vector2d &b,
+                const Eigen::Vector2d &initial, double accuracy, double maxTimeStep,
+                TuningChoice *choice, std::string *error = 0);
+
+    // writes the cache file if choices have been made since it was last
+    // written; returns false if it could not be
+    bool flush(std::string *error = 0);
+};
+
+// --------------------------------------------------------------------------
+
+#endif // AUTOTUNER_H
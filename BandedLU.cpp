@@ -0,0 +1,107 @@
+#include "BandedLU.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+void BandedLU::reset(int n, int lower, int upper)
+{
+    m_size = n;
+    m_lower = lower;
+    m_upper = upper;
+    m_stride = 2 * lower + upper + 1;
+    m_band.assign(size_t(n) * m_stride, 0.0);
+    m_pivots.resize(n);
+    m_inverseDiagonal.resize(n);
+    m_factorized = false;
+}
+
+bool BandedLU::factorize()
+{
+    int n = m_size, kl = m_lower, ku = m_upper;
+
+    // the last column that row exchanges have reached so far
+    int reach = 0;
+
+    for (int j = 0; j < n; ++j)
+    {
+        int below = min(kl, n - 1 - j);
+
+        // pivot on the largest entry in the column
+        int p = 0;
+        double largest = abs(at(j, j));
+        for (int r = 1; r <= below; ++r)
+            if (abs(at(j + r, j)) > largest) {
+                largest = abs(at(j + r, j));
+                p = r;
+            }
+        m_pivots[j] = j + p;
+        if (largest == 0.0) return false;
+
+        reach = max(reach, min(j + ku + p, n - 1));
+        if (p != 0)
+            for (int c = j; c <= reach; ++c)
+                swap(at(j, c), at(j + p, c));
+
+        double inverse = m_inverseDiagonal[j] = 1.0 / at(j, j);
+        for (int r = 1; r <= below; ++r)
+            at(j + r, j) *= inverse;
+
+        for (int c = j + 1; c <= reach; ++c)
+        {
+            double a = at(j, c);
+            if (a == 0.0) continue;
+            for (int r = 1; r <= below; ++r)
+                at(j + r, c) -= at(j + r, j) * a;
+        }
+    }
+
+    m_factorized = true;
+    return true;
+}
+
+void BandedLU::solve(double *x) const
+{
+    int n = m_size, kl = m_lower, ku = m_upper + m_lower;
+
+    // L, with the row exchanges applied as they were made
+    for (int j = 0; j < n; ++j)
+    {
+        if (m_pivots[j] != j) swap(x[j], x[m_pivots[j]]);
+        int below = min(kl, n - 1 - j);
+        for (int r = 1; r <= below; ++r)
+            x[j + r] -= at(j + r, j) * x[j];
+    }
+
+    // U, whose band has grown to lower + upper
+    for (int j = n - 1; j >= 0; --j)
+    {
+        x[j] *= m_inverseDiagonal[j];
+        for (int i = max(0, j - ku); i < j; ++i)
+            x[i] -= at(i, j) * x[j];
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void interleavedOrdering(int size, vector<int> &order)
+{
+    int half = size / 2;
+    order.resize(size);
+    for (int i = 0; i < half; ++i) {
+        order[i] = 2 * i;
+        order[half + i] = 2 * i + 1;
+    }
+    if (size % 2) order[size - 1] = size - 1;
+}
+
+vector<int> interleavedOrdering(int size)
+{
+    vector<int> order;
+    interleavedOrdering(size, order);
+    return order;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,83 @@
+#ifndef BANDEDLU_H
+#define BANDEDLU_H
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// LU factorization with partial pivoting of a banded matrix, with at most
+// 'lower' nonzero diagonals below the main one and 'upper' above it.  It
+// takes O(n lower (lower + upper)) to factor and O(n (lower + upper)) to
+// solve, against O(n^3) and O(n^2) for a dense LU, so a chain of springs
+// ordered along its length costs linear time however long it is.
+//
+// The storage follows LAPACK's dgbtrf: each column keeps its band plus
+// 'lower' extra diagonals above it for the fill-in of row exchanges.
+
+class BandedLU
+{
+    int     m_size;
+    int     m_lower;
+    int     m_upper;
+    int     m_stride;       // 2 lower + upper + 1, the stored rows per column
+    bool    m_factorized;
+
+    std::vector<double> m_band;
+    std::vector<int>    m_pivots;
+    std::vector<double> m_inverseDiagonal;      // of U, to multiply by
+
+    double &at(int i, int j)        { return m_band[std::size_t(j) * m_stride + m_lower + m_upper + i - j]; }
+    double at(int i, int j) const   { return m_band[std::size_t(j) * m_stride + m_lower + m_upper + i - j]; }
+
+public:
+    BandedLU() : m_size(0), m_lower(0), m_upper(0), m_stride(1), m_factorized(false) {}
+
+    // sizes the storage for an n by n matrix and zeroes it; allocates only
+    // when the shape grows
+    void reset(int n, int lower, int upper);
+
+    int size() const                { return m_size; }
+    int lower() const               { return m_lower; }
+    int upper() const               { return m_upper; }
+    bool isFactorized() const       { return m_factorized; }
+
+    // adds to entry (i, j), which must lie within the band
+    void add(int i, int j, double value)    { at(i, j) += value; }
+
+    // factors the matrix in place; false if it is singular
+    bool factorize();
+
+    // overwrites x with the solution of A x = b, given b in x
+    void solve(double *x) const;
+};
+
+// --------------------------------------------------------------------------
+
+// The lower and upper bandwidth of a square Eigen sparse matrix when row
+// and column i are renumbered to order[i] (or left alone if order is
+// empty).
+template <typename M>
+void bandwidth(const M &A, const std::vector<int> &order, int *lower, int *upper)
+{
+    *lower = *upper = 0;
+    for (int outer = 0; outer < A.outerSize(); ++outer)
+        for (typename M::InnerIterator it(A, outer); it; ++it)
+        {
+            int i = int(it.row()), j = int(it.col());
+            if (!order.empty()) { i = order[i]; j = order[j]; }
+            if (i - j > *lower) *lower = i - j;
+            if (j - i > *upper) *upper = j - i;
+        }
+}
+
+// The ordering that interleaves the two halves of a state, taking
+// [v0..vn-1, x0..xn-1] to [v0, x0, v1, x1, ...].  It turns the spring
+// models' matrices, whose couplings reach across the halves, into narrow
+// bands.  The second form fills order in place, reusing its storage.
+std::vector<int> interleavedOrdering(int size);
+void interleavedOrdering(int size, std::vector<int> &order);
+
+// --------------------------------------------------------------------------
+
+#endif // BANDEDLU_H
@@ -0,0 +1,349 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+BenchmarkOptions::BenchmarkOptions(int argc, char **argv)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            m_positional.push_back(arg);
+            continue;
+        }
+
+        // a following argument is the value, unless it is another option
+        string name = arg.substr(2), value;
+        if (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0)
+            value = argv[++i];
+        m_values[name] = value;
+    }
+}
+
+bool BenchmarkOptions::has(const string &name) const
+{
+    return m_values.count(name) > 0;
+}
+
+string BenchmarkOptions::value(const string &name, const string &fallback) const
+{
+    map<string, string>::const_iterator i = m_values.find(name);
+    return i == m_values.end() ? fallback : i->second;
+}
+
+double BenchmarkOptions::number(const string &name, double fallback) const
+{
+    string v = value(name);
+    return v.empty() ? fallback : atof(v.c_str());
+}
+
+vector<string> BenchmarkOptions::list(const string &name, const string &fallback) const
+{
+    vector<string> items;
+    istringstream in(value(name, fallback));
+    string item;
+    while (getline(in, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+// --------------------------------------------------------------------------
+
+ResultTable::ResultTable(const vector<string> &columns)
+    : m_columns(columns), m_numeric(columns.size(), true),
+      m_stream(0), m_streamFormat(Text), m_streamed(0)
+{}
+
+ResultTable &ResultTable::row()
+{
+    if (m_stream) streamRows();
+    m_rows.push_back(vector<string>());
+    return *this;
+}
+
+void ResultTable::append(const string &value)
+{
+    m_rows.back().push_back(value);
+    if (m_stream && m_rows.back().size() == m_columns.size()) streamRows();
+}
+
+ResultTable &ResultTable::operator<<(const string &value)
+{
+    size_t column = m_rows.back().size();
+    if (column < m_numeric.size()) m_numeric[column] = false;
+    append(value);
+    return *this;
+}
+
+ResultTable &ResultTable::missing()
+{
+    append(string());
+    return *this;
+}
+
+ResultTable &ResultTable::operator<<(const char *value)
+{
+    return *this << string(value);
+}
+
+ResultTable &ResultTable::operator<<(double value)
+{
+    ostringstream s;
+    s << setprecision(6) << value;
+    append(s.str());
+    return *this;
+}
+
+ResultTable &ResultTable::operator<<(long long value)
+{
+    ostringstream s;
+    s << value;
+    append(s.str());
+    return *this;
+}
+
+void ResultTable::print(ostream &out, Format format) const
+{
+    size_t n = m_columns.size();
+
+    if (format == CSV)
+    {
+        for (size_t c = 0; c < n; ++c)
+            out << (c ? "," : "") << m_columns[c];
+        out << "\n";
+        for (size_t r = 0; r < m_rows.size(); ++r) {
+            for (size_t c = 0; c < m_rows[r].size(); ++c)
+                out << (c ? "," : "") << m_rows[r][c];
+            out << "\n";
+        }
+    }
+    else if (format == JSON)
+    {
+        out << "[\n";
+        for (size_t r = 0; r < m_rows.size(); ++r) {
+            out << "  {";
+            for (size_t c = 0; c < m_rows[r].size() && c < n; ++c) {
+                out << (c ? ", " : " ") << "\"" << m_columns[c] << "\": ";
+                if (m_rows[r][c].empty() && m_numeric[c]) out << "null";
+                else if (m_numeric[c]) out << m_rows[r][c];
+                else              out << "\"" << m_rows[r][c] << "\"";
+            }
+            out << " }" << (r + 1 < m_rows.size() ? "," : "") << "\n";
+        }
+        out << "]\n";
+    }
+    else
+    {
+        vector<size_t> width(n);
+        for (size_t c = 0; c < n; ++c) {
+            width[c] = m_columns[c].size();
+            for (size_t r = 0; r < m_rows.size(); ++r)
+                if (c < m_rows[r].size()) width[c] = max(width[c], m_rows[r][c].size());
+        }
+        for (size_t c = 0; c < n; ++c)
+            out << setw(int(width[c]) + 2) << m_columns[c];
+        out << "\n";
+        for (size_t r = 0; r < m_rows.size(); ++r) {
+            for (size_t c = 0; c < m_rows[r].size(); ++c)
+                out << setw(int(width[c]) + 2) << (m_rows[r][c].empty() ? "-" : m_rows[r][c]);
+            out << "\n";
+        }
+    }
+}
+
+static bool isNumber(const string &s)
+{
+    char *end = 0;
+    strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
+void ResultTable::stream(ostream &out, Format format)
+{
+    m_stream = &out;
+    m_streamFormat = format;
+    m_streamed = 0;
+
+    if (format == CSV) {
+        for (size_t c = 0; c < m_columns.size(); ++c)
+            out << (c ? "," : "") << m_columns[c];
+        out << "\n";
+    }
+    else if (format == JSON)
+        out << "[\n";
+    else {
+        for (size_t c = 0; c < m_columns.size(); ++c)
+            out << setw(int(max<size_t>(m_columns[c].size(), 12)) + 2) << m_columns[c];
+        out << "\n";
+    }
+    out.flush();
+}
+
+// writes the rows not yet streamed, up to the last one with every column
+void ResultTable::streamRows()
+{
+    ostream &out = *m_stream;
+    size_t last = m_rows.size();
+    if (last && m_rows.back().size() < m_columns.size()) --last;
+    for (; m_streamed < last; ++m_streamed)
+    {
+        const vector<string> &row = m_rows[m_streamed];
+        if (m_streamFormat == CSV) {
+            for (size_t c = 0; c < row.size(); ++c)
+                out << (c ? "," : "") << row[c];
+            out << "\n";
+        }
+        else if (m_streamFormat == JSON) {
+            // the type of a column is only known once every row is in, so
+            // values that parse as numbers are written as numbers
+            out << (m_streamed ? ",\n" : "") << "  {";
+            for (size_t c = 0; c < row.size() && c < m_columns.size(); ++c) {
+                out << (c ? ", " : " ") << "\"" << m_columns[c] << "\": ";
+                if (row[c].empty())         out << "null";
+                else if (isNumber(row[c]))  out << row[c];
+                else                        out << "\"" << row[c] << "\"";
+            }
+            out << " }";
+        }
+        else {
+            for (size_t c = 0; c < row.size(); ++c)
+                out << setw(int(max<size_t>(c < m_columns.size() ? m_columns[c].size() : 0, 12)) + 2)
+                    << (row[c].empty() ? "-" : row[c]);
+            out << "\n";
+        }
+    }
+    out.flush();
+}
+
+void ResultTable::finish()
+{
+    if (!m_stream) return;
+    if (!m_rows.empty()) m_rows.back().resize(m_columns.size());   // pads an unfinished row
+    streamRows();
+    if (m_streamFormat == JSON) *m_stream << (m_streamed ? "\n" : "") << "]\n";
+    m_stream->flush();
+    m_stream = 0;
+}
+
+bool ResultTable::parseFormat(const string &name, Format *format)
+{
+    if      (name == "text")    *format = Text;
+    else if (name == "csv")     *format = CSV;
+    else if (name == "json")    *format = JSON;
+    else                        return false;
+    return true;
+}
+
+void printResults(const ResultTable &table, const BenchmarkOptions &options)
+{
+    ResultTable::Format format = ResultTable::Text;
+    if (!ResultTable::parseFormat(options.value("format", "text"), &format))
+        cerr << "unknown format '" << options.value("format") << "', using text\n";
+    table.print(cout, format);
+}
+
+void streamResults(ResultTable &table, const BenchmarkOptions &options)
+{
+    ResultTable::Format format = ResultTable::Text;
+    if (!ResultTable::parseFormat(options.value("format", "text"), &format))
+        cerr << "unknown format '" << options.value("format") << "', using text\n";
+    table.stream(cout, format);
+}
+
+// --------------------------------------------------------------------------
+
+struct CommandEntry
+{
+    const char         *name;
+    BenchmarkCommand    command;
+    const char         *description;
+};
+
+static const CommandEntry k_commands[] = {
+    { "integrators", benchmarkIntegrators,
+      "time every integrator on springs and spring chains of several sizes" },
+    { "scene",       benchmarkScene,
+      "time a whole scene loaded from a scene file (--scene FILE,\n"
+      "               --counters CSV to dump each spring's integrator counters,\n"
+      "               --tuning-cache FILE for springs with integrator=auto)" },
+    { "precision",   benchmarkPrecision,
+      "work-precision tables against the exact damped oscillator (--target ERROR)" },
+    { "allocations", benchmarkAllocations,
+      "check that no integrator allocates in step(); needs CONFIG+=alloc_check" },
+    { "regress",     benchmarkRegression,
+      "compare throughput with this machine's stored baseline (--save to record\n"
+      "               it, --baseline FILE, --threshold PERCENT); fails on a regression" },
+    { "sweep",       benchmarkSweep,
+      "run a grid (or --latin N samples) of spring parameters with every integrator\n"
+      "               on all cores, streaming error, energy drift and divergence time" },
+    { "problems",    benchmarkProblems,
+      "accuracy and cost on standard nonlinear, chaotic and stiff test problems\n"
+      "               (--problems LIST, --steps LIST, --tolerances LIST)" },
+    { "network",     benchmarkNetwork,
+      "assembly, edge update and step cost of sparse spring networks\n"
+      "               (--topology chain,lattice, --sizes LIST, --dt STEP)" },
+    { "cloth",       benchmarkCloth,
+      "implicit and XPBD cloth frames per second and thread scaling\n"
+      "               (--engine implicit,xpbd, --sizes LIST, --threads LIST,\n"
+      "               --iterations N, --tolerance TOL, --sweeps N, --substeps N)" },
+    { "multigrid",   benchmarkMultigrid,
+      "multigrid implicit steps on square lattices, with cycle counts against\n"
+      "               Jacobi-preconditioned CG (--sizes LIST, --stiffness K, --dt STEP)" },
+    { "derivative",  benchmarkDerivative,
+      "cloth derivative and RK4 step cost on the calling thread and on pools\n"
+      "               (--sizes LIST, --threads LIST, --seconds S)" },
+    { "reorder",     benchmarkReorder,
+      "bandwidth, fill, mat-vec and banded factorization cost of a randomly\n"
+      "               numbered lattice under each node ordering (--sizes LIST)" },
+    { "distributed", benchmarkDistributed,
+      "a lattice split among processes, checked against one process; exits\n"
+      "               non-zero on any disagreement (--side N, --ranks LIST, --methods LIST)" },
+    { "sleep",       benchmarkSleep,
+      "frame cost of a settling spring ensemble with and without sleeping\n"
+      "               (--springs N, --duration S, --energy E, --distance D, --dwell S)" },
+    { "multirate",   benchmarkMultirate,
+      "multirate against single-rate RK4 on soft lattices with a few stiff\n"
+      "               springs (--sizes LIST, --soft K, --stiff K, --fraction F, --dt STEP)" },
+    { "trajectory",  benchmarkTrajectory,
+      "record springs from several threads, read the file back and check every\n"
+      "               record; exits non-zero on a mismatch (--springs N, --steps N, --threads N)" },
+};
+
+static void printUsage()
+{
+    printf("usage: Benchmark <command> [options]\n\n"
+           "common options:\n"
+           "  --format text|csv|json   output format (default text)\n\n"
+           "commands:\n");
+    for (size_t i = 0; i < sizeof(k_commands) / sizeof(k_commands[0]); ++i)
+        printf("  %-12s %s\n", k_commands[i].name, k_commands[i].description);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options(argc - 1, argv + 1);
+    string command = options.positional().empty() ? "integrators" : options.positional()[0];
+
+    if (options.has("help") || command == "help") {
+        printUsage();
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(k_commands) / sizeof(k_commands[0]); ++i)
+        if (command == k_commands[i].name)
+            return k_commands[i].command(options);
+
+    fprintf(stderr, "unknown command '%s'\n\n", command.c_str());
+    printUsage();
+    return 2;
+}
+
+// --------------------------------------------------------------------------
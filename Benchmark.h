@@ -0,0 +1,212 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include "Integrators.h"
+#include "PerfCounters.h"
+
+// --------------------------------------------------------------------------
+
+// Command line options of the form "--name value" (or just "--name" for a
+// flag), plus whatever positional arguments are left over.
+
+class BenchmarkOptions
+{
+    std::map<std::string, std::string>  m_values;
+    std::vector<std::string>            m_positional;
+
+public:
+    BenchmarkOptions(int argc, char **argv);
+
+    bool has(const std::string &name) const;
+    std::string value(const std::string &name, const std::string &fallback = "") const;
+    double number(const std::string &name, double fallback) const;
+
+    // a comma separated list, e.g. "--sizes 2,8,32"
+    std::vector<std::string> list(const std::string &name, const std::string &fallback) const;
+
+    const std::vector<std::string> &positional() const { return m_positional; }
+};
+
+// --------------------------------------------------------------------------
+
+// Results are collected in a table and printed either aligned for reading,
+// or as CSV or JSON for other tools.
+
+class ResultTable
+{
+public:
+    enum Format { Text, CSV, JSON };
+
+private:
+    std::vector<std::string>                m_columns;
+    std::vector<std::vector<std::string> >  m_rows;
+    std::vector<bool>                       m_numeric;
+
+    std::ostream                           *m_stream;
+    Format                                  m_streamFormat;
+    size_t                                  m_streamed;     // rows written so far
+
+    void append(const std::string &value);
+    void streamRows();
+
+public:
+    explicit ResultTable(const std::vector<std::string> &columns);
+
+    // starts a new row, which is then filled in column order with <<
+    ResultTable &row();
+    ResultTable &operator<<(const std::string &value);
+    ResultTable &operator<<(const char *value);
+    ResultTable &operator<<(double value);
+    ResultTable &operator<<(long long value);
+    ResultTable &operator<<(int value)          { return *this << (long long)(value); }
+
+    // a value that could not be measured: "-" in text, empty in CSV and
+    // null in JSON
+    ResultTable &missing();
+
+    void print(std::ostream &out, Format format) const;
+
+    // Writes the header now, and then each row as soon as it is complete,
+    // for long runs whose results should be seen as they come.  Text columns have a fixed
+    // width, since the widest value is not known in advance.
+    void stream(std::ostream &out, Format format);
+    void finish();
+
+    static bool parseFormat(const std::string &name, Format *format);
+};
+
+// --------------------------------------------------------------------------
+
+class Stopwatch
+{
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    void restart()              { m_start = std::chrono::steady_clock::now(); }
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+
+// --------------------------------------------------------------------------
+
+// Wraps a linear ODE and counts how often its derivative is evaluated.
+
+template <typename S, typename M>
+class CountingODE : public LinearODE<S, M>
+{
+    LinearODE<S, M>        *m_ode;
+    mutable long long       m_evaluations;
+
+public:
+    explicit CountingODE(LinearODE<S, M> *ode) : m_ode(ode), m_evaluations(0) {}
+
+    long long evaluations() const   { return m_evaluations; }
+    void resetCount()               { m_evaluations = 0; }
+
+    virtual S derivativeFunction(double t, const S &y) const
+    {
+        ++m_evaluations;
+        return m_ode->derivativeFunction(t, y);
+    }
+
+    virtual void derivative(double t, const S &y, S &dy) const
+    {
+        ++m_evaluations;
+        m_ode->derivative(t, y, dy);
+    }
+
+    virtual const M &matrixA() const    { return m_ode->matrixA(); }
+    virtual const S &vectorB() const    { return m_ode->vectorB(); }
+    virtual bool matrixChanged()        { return m_ode->matrixChanged(); }
+};
+
+// --------------------------------------------------------------------------
+
+struct IntegratorTiming
+{
+    long long   steps;
+    double      seconds;
+    long long   evaluations;
+    double      events[PerfCounters::EventCount];
+};
+
+// Steps one integrator for at least the given wall time, optionally
+// counting hardware events.  The state is reset every batch so that an
+// unstable scheme times ordinary arithmetic rather than overflowing to
+// infinities.
+template <typename S, typename M>
+IntegratorTiming timeIntegrator(IntegratorType type, LinearODE<S, M> *ode,
+                                const S &initial, double dt, double seconds,
+                                PerfCounters *perf = 0)
+{
+    const int batch = 1000;
+
+    CountingODE<S, M> counting(ode);
+    IntegratorVariant<S, M> integrator;
+    integrator.create(type, &counting, dt);
+    integrator.setTimeStep(dt);     // factors the implicit integrator's matrix
+
+    // one untimed batch to warm the caches and fault in the workspace
+    integrator.setState(initial);
+    for (int i = 0; i < batch; ++i) integrator.step();
+    counting.resetCount();
+
+    IntegratorTiming timing = { 0, 0.0, 0, {} };
+    Stopwatch stopwatch;
+    if (perf) perf->start();
+    do {
+        integrator.setState(initial);
+        for (int i = 0; i < batch; ++i) integrator.step();
+        timing.steps += batch;
+        timing.seconds = stopwatch.seconds();
+    } while (timing.seconds < seconds);
+    if (perf) perf->stop();
+
+    timing.evaluations = counting.evaluations();
+    for (int e = 0; e < PerfCounters::EventCount; ++e)
+        timing.events[e] = perf ? perf->value(PerfCounters::Event(e)) : 0.0;
+    return timing;
+}
+
+// --------------------------------------------------------------------------
+
+// Each benchmark command is a function taking the parsed options and
+// returning the process exit code.
+
+typedef int (*BenchmarkCommand)(const BenchmarkOptions &options);
+
+int benchmarkIntegrators(const BenchmarkOptions &options);
+int benchmarkScene(const BenchmarkOptions &options);
+int benchmarkPrecision(const BenchmarkOptions &options);
+int benchmarkAllocations(const BenchmarkOptions &options);
+int benchmarkRegression(const BenchmarkOptions &options);
+int benchmarkSweep(const BenchmarkOptions &options);
+int benchmarkProblems(const BenchmarkOptions &options);
+int benchmarkNetwork(const BenchmarkOptions &options);
+int benchmarkCloth(const BenchmarkOptions &options);
+int benchmarkMultigrid(const BenchmarkOptions &options);
+int benchmarkDerivative(const BenchmarkOptions &options);
+int benchmarkReorder(const BenchmarkOptions &options);
+int benchmarkDistributed(const BenchmarkOptions &options);
+int benchmarkSleep(const BenchmarkOptions &options);
+int benchmarkMultirate(const BenchmarkOptions &options);
+int benchmarkTrajectory(const BenchmarkOptions &options);
+
+// prints a table in the format chosen with --format (text by default)
+void printResults(const ResultTable &table, const BenchmarkOptions &options);
+
+// streams a table to standard output in the format chosen with --format
+void streamResults(ResultTable &table, const BenchmarkOptions &options);
+
+// --------------------------------------------------------------------------
+
+#endif // BENCHMARK_H
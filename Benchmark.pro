@@ -0,0 +1,39 @@
+# --------------------------------------------------------------------------
+# Command line benchmark of the simulation core.  Needs neither Qt nor a
+# display; build it through Headless.pro so the core library is built first.
+# --------------------------------------------------------------------------
+
+TEMPLATE = app
+TARGET   = Benchmark
+CONFIG  += console c++11
+CONFIG  -= qt app_bundle
+
+# must match the core library's setting
+alloc_check: DEFINES += INTEGRATOR_ALLOCATION_CHECK EIGEN_RUNTIME_NO_MALLOC
+
+SOURCES  += Benchmark.cpp \
+            BenchmarkIntegrators.cpp \
+            BenchmarkPrecision.cpp \
+            BenchmarkAllocations.cpp \
+            BenchmarkRegression.cpp \
+            BenchmarkSweep.cpp \
+            BenchmarkProblems.cpp \
+            BenchmarkNetwork.cpp \
+            BenchmarkCloth.cpp \
+            BenchmarkMultigrid.cpp \
+            BenchmarkDerivative.cpp \
+            BenchmarkReorder.cpp \
+            BenchmarkDistributed.cpp \
+            BenchmarkSleep.cpp \
+            BenchmarkMultirate.cpp \
+            BenchmarkTrajectory.cpp \
+            PerfCounters.cpp
+
+HEADERS  += Benchmark.h \
+            PerfCounters.h
+
+LIBS     += -L$$OUT_PWD -lIntegratorCore
+unix {
+    PRE_TARGETDEPS += $$OUT_PWD/libIntegratorCore.a
+    LIBS    += -lpthread
+}
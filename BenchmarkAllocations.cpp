@@ -0,0 +1,223 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "AllocationTracker.h"
+#include "MultirateIntegrator.h"
+#include "PositionBasedDynamics.h"
+#include "SimpleSpring.h"
+#include "SpringChain.h"
+#include "SpringNetwork.h"
+#include "SpringScene.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+// A linear ODE seen as a differentiable one, with A as its Jacobian, so
+// that the linearly implicit integrator can be checked on the same models.
+template <typename S, typename M>
+class LinearJacobian : public DifferentiableODE<S, M>
+{
+    LinearODE<S, M> *m_ode;
+
+public:
+    explicit LinearJacobian(LinearODE<S, M> *ode) : m_ode(ode) {}
+
+    virtual S derivativeFunction(double t, const S &y) const    { return m_ode->derivativeFunction(t, y); }
+    virtual void derivative(double t, const S &y, S &dy) const  { m_ode->derivative(t, y, dy); }
+    virtual void jacobian(double, const S &, M &J) const        { J = m_ode->matrixA(); }
+};
+
+}
+
+// Steps one integrator inside a NoAllocationScope and returns the number
+// of allocations counted.  The time step is reset every so often, which
+// makes the implicit integrators refactor, so that path is covered too.
+// An Eigen allocation inside the scope stops the program with an
+// assertion, so the case being checked is announced first.
+template <typename S>
+static long long countAllocations(const char *model, const char *name, Integrator<S> &integrator,
+                                  const S &initial, double dt, int steps)
+{
+    fprintf(stderr, "checking %s on %s (%d)...\n", name, model, int(initial.size()));
+
+    integrator.setTimeStep(dt);
+    integrator.setState(initial);
+
+    // the first step sizes the integrator's workspace
+    integrator.step();
+
+    AllocationTracker::reset();
+    {
+        NoAllocationScope scope;
+        for (int i = 0; i < steps; ++i) {
+            if (i % 16 == 0) integrator.setTimeStep(dt);
+            integrator.step();
+        }
+    }
+    return AllocationTracker::count();
+}
+
+template <typename S, typename M>
+static long long countAllocations(const char *model, IntegratorType type, LinearODE<S, M> *ode,
+                                  const S &initial, double dt, int steps)
+{
+    IntegratorVariant<S, M> integrator;
+    integrator.create(type, ode, dt);
+    return countAllocations(model, integratorName(type), *integrator.integrator(), initial, dt,
+                            steps);
+}
+
+// The same for the linearly implicit integrator, which needs a Jacobian.
+template <typename S, typename M>
+static long long countLinearlyImplicitAllocations(const char *model, LinearODE<S, M> *ode,
+                                                  const S &initial, double dt, int steps)
+{
+    LinearJacobian<S, M> differentiable(ode);
+    LinearlyImplicitEulerIntegrator<S, M> integrator(&differentiable, dt);
+    return countAllocations(model, "linearly implicit", integrator, initial, dt, steps);
+}
+
+// Updates a scene of springs, with sleeping on, on the calling thread.
+static long long countSceneAllocations(int springs, double dt, int steps)
+{
+    fprintf(stderr, "checking scene update (%d springs)...\n", springs);
+
+    SpringScene scene;
+    scene.reserve(springs);
+    for (int i = 0; i < springs; ++i) {
+        SpringDescription d;
+        d.integrator = IntegratorType(i % IntegratorTypeCount);
+        d.initialPosition = i % 2 ? 0.25 : 0.0;
+        scene.addSpring(d);
+    }
+    scene.setSleeping(SleepThresholds(1e-6, 1e-4, 0.05));
+    scene.update(dt);
+
+    AllocationTracker::reset();
+    {
+        NoAllocationScope scope;
+        for (int i = 0; i < steps; ++i) scene.update(dt);
+    }
+    return AllocationTracker::count();
+}
+
+// The same for the cloth engines on a hanging sheet, on the calling thread
+// or spread over a pool.  Eigen's check covers the pool's threads too.
+static long long countClothAllocations(bool xpbd, int threads, int side, double dt, int steps)
+{
+    fprintf(stderr, "checking %s on cloth (%d, %d threads)...\n", xpbd ? "xpbd" : "implicit",
+            6 * side * side, threads);
+
+    Cloth cloth;
+    cloth.createSheet(side, side);
+    cloth.pin(0);
+    cloth.pin(side - 1);
+
+    unique_ptr<WorkStealingPool> pool(threads > 1 ? new WorkStealingPool(threads) : 0);
+    unique_ptr<Integrator<Cloth::StateType> > integrator;
+    if (xpbd) integrator.reset(new XpbdIntegrator(&cloth, dt, pool.get()));
+    else integrator.reset(new ClothIntegrator(&cloth, dt, pool.get()));
+    integrator->setState(cloth.initialState());
+    integrator->step();
+
+    AllocationTracker::reset();
+    {
+        NoAllocationScope scope;
+        for (int i = 0; i < steps; ++i) integrator->step();
+    }
+    return AllocationTracker::count();
+}
+
+int benchmarkAllocations(const BenchmarkOptions &options)
+{
+    if (!AllocationTracker::isEnabled()) {
+        fprintf(stderr, "built without allocation checking; "
+                        "rebuild with qmake CONFIG+=alloc_check\n");
+        return 2;
+    }
+
+    int steps = int(options.number("steps", 1000));
+    double dt = options.number("dt", 1e-3);
+    vector<string> sizes = options.list("sizes", "1,8,64");
+
+    const char *columns[] = { "model", "state", "integrator", "steps", "allocations" };
+    ResultTable table(vector<string>(columns, columns + 5));
+    long long total = 0;
+
+    SimpleSpring spring(1.0, 200.0, 1.0, -9.81);
+    for (int i = 0; i < IntegratorTypeCount; ++i) {
+        IntegratorType type = IntegratorType(i);
+        long long n = countAllocations("spring", type, &spring, Vector2d(0.0, 0.25), dt, steps);
+        table.row() << "spring" << 2 << integratorName(type) << steps << n;
+        total += n;
+    }
+    long long a = countLinearlyImplicitAllocations("spring", &spring, Vector2d(0.0, 0.25), dt, steps);
+    table.row() << "spring" << 2 << "linearly implicit" << steps << a;
+    total += a;
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int n = atoi(sizes[s].c_str());
+        if (n <= 0) continue;
+
+        SpringChain chain(n);
+        for (int i = 0; i < IntegratorTypeCount; ++i) {
+            IntegratorType type = IntegratorType(i);
+            long long a = countAllocations("chain", type, &chain, chain.initialState(), dt, steps);
+            table.row() << "chain" << 2 * n << integratorName(type) << steps << a;
+            total += a;
+        }
+        a = countLinearlyImplicitAllocations("chain", &chain, chain.initialState(), dt, steps);
+        table.row() << "chain" << 2 * n << "linearly implicit" << steps << a;
+        total += a;
+
+        // the network integrators on the same chain, with a few of its
+        // springs made stiff for the multirate one
+        SpringNetwork network;
+        network.createChain(n);
+        BandedImplicitEulerIntegrator<VectorXd, SpringNetwork::MatrixType> banded(&network, dt);
+        a = countAllocations("network", "banded implicit", banded, network.initialState(), dt,
+                             steps);
+        table.row() << "network" << 2 * n << "banded implicit" << steps << a;
+        total += a;
+
+        for (int e = 0; e < network.edgeCount(); e += 4) {
+            const SpringNetworkEdge &edge = network.edge(e);
+            network.setEdge(e, 1e5, edge.damping, edge.length);
+        }
+        MultirateIntegrator multirate(&network, dt, 1e4, 8);
+        a = countAllocations("network", "multirate", multirate, network.initialState(), dt, steps);
+        table.row() << "network" << 2 * n << "multirate" << steps << a;
+        total += a;
+    }
+
+    a = countSceneAllocations(64, dt, steps);
+    table.row() << "scene" << 2 * 64 << "update" << steps << a;
+    total += a;
+
+    // a cloth step is much dearer than a chain's, so take fewer
+    int clothSteps = max(1, steps / 100);
+    for (int e = 0; e < 2; ++e)
+        for (int threads = 1; threads <= 2; ++threads) {
+            a = countClothAllocations(e == 1, threads, 20, 1.0 / 60.0, clothSteps);
+            string name = string(e == 1 ? "xpbd" : "implicit") + (threads > 1 ? " (pool)" : "");
+            table.row() << "cloth" << 6 * 20 * 20 << name << clothSteps << a;
+            total += a;
+        }
+
+    printResults(table, options);
+    if (total > 0) {
+        fprintf(stderr, "FAILED: %lld heap allocations in steps\n", total);
+        return 1;
+    }
+    fprintf(stderr, "passed: no heap allocations in steps\n");
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "Cloth.h"
+#include "PositionBasedDynamics.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+int benchmarkCloth(const BenchmarkOptions &options)
+{
+    int frames          = int(options.number("frames", 120));
+    double dt           = options.number("dt", 1.0 / 60.0);
+    double tolerance    = options.number("tolerance", 1e-2);
+    int iterations      = int(options.number("iterations", 20));    // a 60 Hz budget
+    int sweeps          = int(options.number("sweeps", 10));
+    int substeps        = int(options.number("substeps", 2));
+    vector<string> engines = options.list("engine", "implicit,xpbd");
+    vector<string> sizes   = options.list("sizes", "32,100");
+    vector<string> threads = options.list("threads", "1,2,4");
+
+    const char *columns[] = { "engine", "size", "particles", "springs", "threads",
+                              "ms_per_frame", "iterations", "speedup", "frames_per_second",
+                              "lowest_y" };
+    ResultTable table(vector<string>(columns, columns + 10));
+    streamResults(table, options);
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int size = atoi(sizes[s].c_str());
+        if (size < 2) continue;
+
+        // a square sheet hung by two corners, falling and swinging
+        Cloth cloth;
+        cloth.createSheet(size, size);
+        cloth.pin(0);
+        cloth.pin(size - 1);
+
+        for (size_t g = 0; g < engines.size(); ++g)
+        {
+            bool xpbd = engines[g] == "xpbd";
+            if (!xpbd && engines[g] != "implicit") {
+                fprintf(stderr, "unknown engine '%s'\n", engines[g].c_str());
+                return 1;
+            }
+
+            double baseline = 0.0;
+            for (size_t t = 0; t < threads.size(); ++t)
+            {
+                int count = atoi(threads[t].c_str());
+                if (count < 1) continue;
+
+                // one thread runs on the caller, without the pool; the
+                // iterations are conjugate gradient ones for the implicit
+                // engine and Gauss-Seidel sweeps, over all substeps, for XPBD
+                unique_ptr<WorkStealingPool> pool(count > 1 ? new WorkStealingPool(count) : 0);
+                unique_ptr<Integrator<Cloth::StateType> > integrator;
+                ClothIntegrator *implicit = 0;
+                if (xpbd) {
+                    XpbdIntegrator *x = new XpbdIntegrator(&cloth, dt, pool.get());
+                    x->setIterations(sweeps);
+                    x->setSubsteps(substeps);
+                    integrator.reset(x);
+                }
+                else {
+                    implicit = new ClothIntegrator(&cloth, dt, pool.get());
+                    implicit->setTolerance(tolerance);
+                    implicit->setMaxIterations(iterations);
+                    integrator.reset(implicit);
+                }
+                integrator->setState(cloth.initialState());
+
+                Stopwatch stopwatch;
+                for (int f = 0; f < frames; ++f) integrator->step();
+                double ms = 1e3 * stopwatch.seconds() / frames;
+                if (baseline == 0.0) baseline = ms;
+
+                // how far the sheet sags shows what a truncated solve gives up
+                int n = cloth.particleCount();
+                Cloth::StateType y = integrator->state();
+                double lowest = 0.0;
+                for (int i = 0; i < n; ++i) lowest = min(lowest, y[3 * n + 3 * i + 1]);
+
+                double perFrame = implicit ? double(implicit->totalIterations()) / frames
+                                           : double(sweeps * substeps);
+                table.row() << engines[g] << size << cloth.particleCount() << cloth.springCount()
+                            << count << ms << perFrame << baseline / ms << 1e3 / ms << lowest;
+            }
+        }
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
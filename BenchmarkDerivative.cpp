@@ -0,0 +1,85 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include "Cloth.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+// The cost of evaluating a cloth's derivative, and of the RK4 step built on
+// four of them, on the calling thread and on pools of several threads.
+int benchmarkDerivative(const BenchmarkOptions &options)
+{
+    double seconds          = options.number("seconds", 0.2);
+    double dt               = options.number("dt", 1e-5);
+    vector<string> sizes    = options.list("sizes", "100,300");
+    vector<string> threads  = options.list("threads", "1,2,4,8");
+
+    const char *columns[] = { "size", "particles", "springs", "threads", "evaluation_us",
+                              "ns_per_spring", "rk4_step_us", "speedup", "max_difference" };
+    ResultTable table(vector<string>(columns, columns + 9));
+    streamResults(table, options);
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int size = atoi(sizes[s].c_str());
+        if (size < 2) continue;
+
+        // a sheet that has been swinging for a while, so that every spring
+        // is stretched and moving
+        Cloth cloth;
+        cloth.createSheet(size, size);
+        cloth.pin(0);
+        cloth.pin(size - 1);
+        RungeKutta4Integrator<Cloth::StateType> settle(&cloth, dt);
+        settle.setState(cloth.initialState());
+        for (int i = 0; i < 20; ++i) settle.step();
+        Cloth::StateType y = settle.state(), reference, dy;
+        cloth.derivative(0.0, y, reference);
+
+        double baseline = 0.0;
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            int count = atoi(threads[t].c_str());
+            if (count < 1) continue;
+
+            // one thread runs on the caller, without the pool
+            unique_ptr<WorkStealingPool> pool(count > 1 ? new WorkStealingPool(count) : 0);
+            cloth.setThreadPool(pool.get());
+
+            long long evaluations = 0;
+            Stopwatch stopwatch;
+            do {
+                for (int i = 0; i < 10; ++i) cloth.derivative(0.0, y, dy);
+                evaluations += 10;
+            } while (stopwatch.seconds() < seconds);
+            double us = 1e6 * stopwatch.seconds() / evaluations;
+            if (baseline == 0.0) baseline = us;
+            double difference = (dy - reference).cwiseAbs().maxCoeff();
+
+            RungeKutta4Integrator<Cloth::StateType> integrator(&cloth, dt);
+            integrator.setState(y);
+            long long steps = 0;
+            Stopwatch stepwatch;
+            do {
+                integrator.step();
+                ++steps;
+            } while (stepwatch.seconds() < seconds);
+            double stepUs = 1e6 * stepwatch.seconds() / steps;
+
+            table.row() << size << cloth.particleCount() << cloth.springCount() << count << us
+                        << 1e3 * us / cloth.springCount() << stepUs << baseline / us
+                        << difference;
+        }
+        cloth.setThreadPool(0);
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "DistributedNetwork.h"
+#include "MultigridSolver.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+// Runs a lattice split among several processes and checks each result
+// against the same steps taken in this one: the explicit methods must
+// agree to rounding, implicit Euler to its solver's tolerance.  Exits
+// non-zero if any run fails or disagrees.
+int benchmarkDistributed(const BenchmarkOptions &options)
+{
+    int side                = int(options.number("side", 100));
+    int steps               = int(options.number("steps", 100));
+    double dt               = options.number("dt", 1e-3);
+    vector<string> ranks    = options.list("ranks", "1,2,4");
+    vector<string> methods  = options.list("methods", "euler,rk4,implicit");
+
+    const char *columns[] = { "method", "nodes", "ranks", "halo_nodes", "step_us", "speedup",
+                              "cg_iterations", "max_difference" };
+    ResultTable table(vector<string>(columns, columns + 8));
+    streamResults(table, options);
+
+    // numbered for narrow subdomain boundaries
+    SpringNetwork network;
+    network.createLattice(side, side);
+    network.setOrdering(SpringNetwork::BandwidthOrdering);
+    network.assemble();
+    SpringNetwork::StateType initial = network.initialState();
+
+    bool failed = false;
+    for (size_t m = 0; m < methods.size(); ++m)
+    {
+        DistributedNetwork::Method method;
+        SpringNetwork::StateType reference;
+        double allowed;
+        if (methods[m] == "euler" || methods[m] == "rk4")
+        {
+            unique_ptr<Integrator<SpringNetwork::StateType> > serial;
+            if (methods[m] == "euler") {
+                method = DistributedNetwork::ExplicitEuler;
+                serial.reset(new ExplicitEulerIntegrator<SpringNetwork::StateType>(&network, dt));
+            }
+            else {
+                method = DistributedNetwork::RungeKutta4;
+                serial.reset(new RungeKutta4Integrator<SpringNetwork::StateType>(&network, dt));
+            }
+            serial->setState(initial);
+            for (int s = 0; s < steps; ++s) serial->step();
+            reference = serial->state();
+            allowed = 1e-12;
+        }
+        else if (methods[m] == "implicit")
+        {
+            // multigrid needs the lattice in grid order
+            method = DistributedNetwork::ImplicitEuler;
+            SpringNetwork grid;
+            grid.createLattice(side, side);
+            MultigridImplicitEulerIntegrator serial(&grid, dt, side, side);
+            serial.solver().setTolerance(1e-12);
+            serial.setState(grid.initialState());
+            for (int s = 0; s < steps; ++s) serial.step();
+            reference = network.fromNodeOrder(serial.state());
+            allowed = 1e-6;
+        }
+        else {
+            fprintf(stderr, "unknown method '%s'\n", methods[m].c_str());
+            return 1;
+        }
+
+        double baseline = 0.0;
+        for (size_t r = 0; r < ranks.size(); ++r)
+        {
+            int count = atoi(ranks[r].c_str());
+            if (count < 1) continue;
+
+            DistributedNetwork distributed(network, count);
+            distributed.setMethod(method);
+            SpringNetwork::StateType y = initial;
+            string error;
+            if (!distributed.run(y, dt, steps, &error)) {
+                fprintf(stderr, "%s on %d ranks: %s\n", methods[m].c_str(), count, error.c_str());
+                failed = true;
+                continue;
+            }
+
+            double us = 1e6 * distributed.lastSeconds() / steps;
+            if (baseline == 0.0) baseline = us;
+            double difference = (y - reference).cwiseAbs().maxCoeff();
+            if (!(difference <= allowed)) failed = true;
+
+            table.row() << methods[m] << network.nodeCount() << distributed.rankCount()
+                        << distributed.haloSize() << us << baseline / us;
+            if (method == DistributedNetwork::ImplicitEuler)
+                table << double(distributed.lastIterations()) / steps;
+            else
+                table.missing();
+            table << difference;
+        }
+    }
+
+    table.finish();
+    return failed ? 1 : 0;
+}
+
+// --------------------------------------------------------------------------
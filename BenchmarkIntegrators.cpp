@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include "AutoTuner.h"
+#include "SimpleSpring.h"
+#include "SpringChain.h"
+#include "SpringScene.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+static void addRow(ResultTable &table, const char *model, int stateSize,
+                   IntegratorType type, const IntegratorTiming &t, const PerfCounters &perf)
+{
+    table.row() << model << stateSize << integratorName(type) << t.steps
+                << t.steps / t.seconds << 1e9 * t.seconds / t.steps
+                << double(t.evaluations) / t.steps;
+
+    // hardware events per step, and instructions per cycle
+    for (int e = 0; e < PerfCounters::EventCount; ++e) {
+        if (perf.isAvailable(PerfCounters::Event(e))) table << t.events[e] / t.steps;
+        else                                          table.missing();
+    }
+    if (perf.isAvailable(PerfCounters::Cycles) && perf.isAvailable(PerfCounters::Instructions) &&
+        t.events[PerfCounters::Cycles] > 0)
+        table << t.events[PerfCounters::Instructions] / t.events[PerfCounters::Cycles];
+    else
+        table.missing();
+}
+
+int benchmarkIntegrators(const BenchmarkOptions &options)
+{
+    double seconds  = options.number("seconds", 0.2);
+    double dt       = options.number("dt", 1e-4);
+    vector<string> sizes = options.list("sizes", "1,4,16,64,256");
+
+    // the implicit integrator factors a dense matrix, so it is only run on
+    // chains up to this many masses unless asked otherwise
+    int implicitLimit = int(options.number("implicit-limit", 256));
+
+    // hardware counters are reported where the system allows it
+    PerfCounters perf;
+    if (!perf.isAvailable())
+        fprintf(stderr, "hardware counters unavailable (%s)\n", perf.error().c_str());
+
+    const char *columns[] = { "model", "state", "integrator", "steps",
+                              "steps_per_s", "ns_per_step", "evals_per_step",
+                              "cycles_per_step", "instructions_per_step",
+                              "cache_misses_per_step", "branch_misses_per_step", "ipc" };
+    ResultTable table(vector<string>(columns, columns + 12));
+
+    // the fixed-size spring used by the demo
+    SimpleSpring spring(1.0, 200.0, 1.0, -9.81);
+    Vector2d springState(0.0, 0.25);
+    for (int i = 0; i < IntegratorTypeCount; ++i) {
+        IntegratorType type = IntegratorType(i);
+        addRow(table, "spring", 2, type,
+               timeIntegrator(type, &spring, springState, dt, seconds, &perf), perf);
+    }
+
+    // chains, whose state size is only known at run time
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int n = atoi(sizes[s].c_str());
+        if (n <= 0) {
+            fprintf(stderr, "ignoring chain size '%s'\n", sizes[s].c_str());
+            continue;
+        }
+
+        SpringChain chain(n);
+        VectorXd chainState = chain.initialState();
+        for (int i = 0; i < IntegratorTypeCount; ++i) {
+            IntegratorType type = IntegratorType(i);
+            if (type == ImplicitEuler && n > implicitLimit) continue;
+            addRow(table, "chain", 2 * n, type,
+                   timeIntegrator(type, &chain, chainState, dt, seconds, &perf), perf);
+        }
+    }
+
+    printResults(table, options);
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkScene(const BenchmarkOptions &options)
+{
+    string filename = options.value("scene");
+    double seconds  = options.number("seconds", 1.0);
+
+    // springs with "integrator=auto" are tuned once per machine
+    AutoTuner tuner(options.value("tuning-cache", "integrator-tuning.cache"));
+    SpringScene scene;
+    scene.setAutoTuner(&tuner);
+    string error;
+    if (filename.empty()) {
+        scene.createDefault();
+        filename = "default";
+    }
+    else if (!scene.load(filename, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (!tuner.flush(&error)) fprintf(stderr, "warning: %s\n", error.c_str());
+    scene.reset();
+    scene.resetCounters();
+
+    // every update() advances each spring by one of its own steps
+    long long updates = 0;
+    Stopwatch stopwatch;
+    double elapsed = 0.0;
+    do {
+        scene.update();
+        ++updates;
+        elapsed = stopwatch.seconds();
+    } while (elapsed < seconds);
+
+    long long springSteps = updates * scene.size();
+    IntegratorCounters work = scene.counters();
+
+    const char *columns[] = { "scene", "springs", "updates", "updates_per_s",
+                              "spring_steps_per_s", "ns_per_spring_step", "evals_per_spring_step" };
+    ResultTable table(vector<string>(columns, columns + 7));
+    table.row() << filename << scene.size() << updates << updates / elapsed
+                << springSteps / elapsed << 1e9 * elapsed / springSteps
+                << double(work.evaluations) / springSteps;
+
+    // the per-spring breakdown, for attributing the cost
+    string countersFile = options.value("counters");
+    if (!countersFile.empty() && !scene.writeCounters(countersFile, &error))
+        fprintf(stderr, "%s\n", error.c_str());
+
+    printResults(table, options);
+    return 0;
+}
+
+// --------------------------------------------------------------------------
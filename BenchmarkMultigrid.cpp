@@ -0,0 +1,99 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "MultigridSolver.h"
+#include "SpringNetwork.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef MultigridSolver::MatrixType Matrix;
+
+// Jacobi-preconditioned conjugate gradients, for comparison: returns the
+// iterations to reduce the residual by the tolerance from x = 0
+int conjugateGradientIterations(const Matrix &A, const VectorXd &b, double tolerance,
+                                int maxIterations)
+{
+    int n = int(A.rows());
+    VectorXd inverseDiagonal(n);
+    for (int r = 0; r < n; ++r)
+        for (Matrix::InnerIterator it(A, r); it; ++it)
+            if (it.col() == r) inverseDiagonal[r] = 1.0 / it.value();
+
+    VectorXd x = VectorXd::Zero(n), r = b;
+    VectorXd z = r.cwiseProduct(inverseDiagonal), p = z, q(n);
+    double delta = r.dot(z), target = tolerance * b.norm();
+
+    int iterations = 0;
+    while (r.norm() > target && iterations < maxIterations) {
+        q = A * p;
+        double alpha = delta / p.dot(q);
+        x += alpha * p;
+        r -= alpha * q;
+        z = r.cwiseProduct(inverseDiagonal);
+        double next = r.dot(z);
+        p = z + (next / delta) * p;
+        delta = next;
+        ++iterations;
+    }
+    return iterations;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkMultigrid(const BenchmarkOptions &options)
+{
+    double dt           = options.number("dt", 1.0 / 60.0);
+    double stiffness    = options.number("stiffness", 1e6);
+    double tolerance    = options.number("tolerance", 1e-6);
+    int steps           = int(options.number("steps", 20));
+    vector<string> sizes = options.list("sizes", "32,64,128,256,512");
+
+    const char *columns[] = { "side", "nodes", "levels", "setup_ms", "step_ms", "ns_per_node",
+                              "cycles_per_step", "mg_cycles", "cg_iterations" };
+    ResultTable table(vector<string>(columns, columns + 9));
+    streamResults(table, options);
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int side = atoi(sizes[s].c_str());
+        if (side < 2) continue;
+
+        SpringNetwork lattice;
+        lattice.createLattice(side, side, 1.0, stiffness, 1.0);
+        int n = lattice.nodeCount();
+
+        MultigridImplicitEulerIntegrator integrator(&lattice, dt, side, side);
+        integrator.solver().setTolerance(tolerance);
+        Stopwatch setup;
+        integrator.setTimeStep(dt);     // builds the hierarchy
+        double setupSeconds = setup.seconds();
+
+        integrator.setState(lattice.initialState());
+        Stopwatch stepping;
+        for (int i = 0; i < steps; ++i) integrator.step();
+        double stepSeconds = stepping.seconds() / steps;
+
+        // both solvers from zero on the same system, to the same tolerance
+        VectorXd b = VectorXd::Ones(n), x = VectorXd::Zero(n);
+        integrator.solver().solve(b, x);
+        int cycles = integrator.solver().lastCycles();
+        int iterations = conjugateGradientIterations(integrator.system(), b, tolerance, 100000);
+
+        table.row() << side << n << integrator.solver().levelCount() << 1e3 * setupSeconds
+                    << 1e3 * stepSeconds << 1e9 * stepSeconds / n
+                    << double(integrator.totalCycles()) / steps << cycles << iterations;
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "MultirateIntegrator.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef SpringNetwork::StateType State;
+
+// a soft lattice with a few of its springs made stiff, at random
+void buildMixed(SpringNetwork &network, int side, double soft, double stiff, double fraction)
+{
+    network.createLattice(side, side, 1.0, soft, 0.5);
+    mt19937 random(1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int e = 0; e < network.edgeCount(); ++e)
+        if (unit(random) < fraction) {
+            const SpringNetworkEdge &edge = network.edge(e);
+            network.setEdge(e, stiff, edge.damping, edge.length);
+        }
+}
+
+// seconds to simulate the given time, and the state reached
+double simulate(Integrator<State> &integrator, const State &initial, double duration,
+                State &result)
+{
+    integrator.setState(initial);
+    int steps = int(duration / integrator.timeStep() + 0.5);
+    Stopwatch stopwatch;
+    for (int s = 0; s < steps; ++s) integrator.step();
+    result = integrator.state();
+    return stopwatch.seconds();
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkMultirate(const BenchmarkOptions &options)
+{
+    double duration     = options.number("duration", 1.0);
+    double soft         = options.number("soft", 100.0);
+    double stiff        = options.number("stiff", 1e6);
+    double fraction     = options.number("fraction", 0.02);
+    double dt           = options.number("dt", 1.0 / 60.0);
+    vector<string> sizes = options.list("sizes", "30,100");
+
+    const char *columns[] = { "side", "nodes", "fast_nodes", "fast_springs", "method", "dt",
+                              "substeps", "ms_per_second", "speedup", "max_error" };
+    ResultTable table(vector<string>(columns, columns + 10));
+    streamResults(table, options);
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int side = atoi(sizes[s].c_str());
+        if (side < 2) continue;
+
+        SpringNetwork network;
+        buildMixed(network, side, soft, stiff, fraction);
+        State initial = network.initialState();
+
+        // RK4 is stable to about 2.8 / omega; keep well inside that for the
+        // stiff springs between two unit masses
+        double stiffStep = 1.0 / sqrt(2.0 * stiff);
+        int substeps = max(1, int(ceil(dt / stiffStep)));
+        double singleStep = dt / substeps;
+
+        State reference, singleResult, multirateResult;
+        RungeKutta4Integrator<State> fine(&network, 0.25 * singleStep);
+        simulate(fine, initial, duration, reference);
+
+        RungeKutta4Integrator<State> single(&network, singleStep);
+        double singleSeconds = simulate(single, initial, duration, singleResult);
+        double singleError = (singleResult - reference).cwiseAbs().maxCoeff();
+
+        // one step first, so that building the split is not timed
+        MultirateIntegrator multirate(&network, dt, 0.5 * stiff, substeps);
+        multirate.setState(initial);
+        multirate.step();
+        double multirateSeconds = simulate(multirate, initial, duration, multirateResult);
+        double multirateError = (multirateResult - reference).cwiseAbs().maxCoeff();
+
+        table.row() << side << network.nodeCount() << multirate.fastNodeCount()
+                    << multirate.fastSpringCount() << "rk4" << singleStep << 1
+                    << 1e3 * singleSeconds / duration << 1.0 << singleError;
+        table.row() << side << network.nodeCount() << multirate.fastNodeCount()
+                    << multirate.fastSpringCount() << "multirate" << dt << substeps
+                    << 1e3 * multirateSeconds / duration << singleSeconds / multirateSeconds
+                    << multirateError;
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
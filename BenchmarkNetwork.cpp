@@ -0,0 +1,131 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "SpringNetwork.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef SpringNetwork::StateType State;
+
+// The integrator variant's implicit Euler needs a dense matrix, so the
+// sparse model is timed with the integrators directly, and implicit Euler
+// is the banded one.
+enum NetworkIntegrator { NetworkEuler, NetworkRungeKutta4, NetworkBandedImplicit,
+                         NetworkIntegratorCount };
+
+const char *k_networkIntegratorNames[NetworkIntegratorCount] = { "euler", "rk4", "banded" };
+
+unique_ptr<Integrator<State> > createIntegrator(NetworkIntegrator type, SpringNetwork *network,
+                                                double dt)
+{
+    typedef unique_ptr<Integrator<State> > Pointer;
+    switch (type) {
+    case NetworkEuler:          return Pointer(new ExplicitEulerIntegrator<State>(network, dt));
+    case NetworkRungeKutta4:    return Pointer(new RungeKutta4Integrator<State>(network, dt));
+    case NetworkBandedImplicit:
+        return Pointer(new BandedImplicitEulerIntegrator<State, SpringNetwork::MatrixType>(network, dt));
+    default:                    return Pointer();
+    }
+}
+
+// builds a network of roughly the given number of nodes
+void build(SpringNetwork &network, const string &topology, int size)
+{
+    if (topology == "lattice") {
+        int side = max(1, int(sqrt(double(size)) + 0.5));
+        network.createLattice(side, side);
+    } else {
+        network.createChain(size);
+    }
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkNetwork(const BenchmarkOptions &options)
+{
+    double seconds  = options.number("seconds", 0.1);
+    double dt       = options.number("dt", 1e-4);
+    vector<string> topologies = options.list("topology", "chain,lattice");
+    vector<string> sizes      = options.list("sizes", "100,1000,10000,100000");
+
+    const char *columns[] = { "topology", "nodes", "springs", "nonzeros", "assemble_ms",
+                              "set_edge_ns", "integrator", "factor_ms", "step_ns",
+                              "ns_per_spring" };
+    ResultTable table(vector<string>(columns, columns + 10));
+    streamResults(table, options);
+
+    for (size_t t = 0; t < topologies.size(); ++t)
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int size = atoi(sizes[s].c_str());
+        if (size <= 0) continue;
+
+        SpringNetwork network;
+        Stopwatch assembly;
+        build(network, topologies[t], size);
+        double assembleSeconds = assembly.seconds();
+
+        // change every edge once, in place
+        Stopwatch edits;
+        for (int e = 0; e < network.edgeCount(); ++e) {
+            const SpringNetworkEdge &edge = network.edge(e);
+            network.setEdge(e, edge.stiffness * 1.001, edge.damping, edge.length);
+        }
+        double setEdgeSeconds = edits.seconds() / network.edgeCount();
+
+        // the banded factorization of a wide lattice would need gigabytes
+        int lower, upper;
+        bandwidth(network.matrixA(), interleavedOrdering(2 * network.nodeCount()), &lower, &upper);
+        bool banded = double(lower) * (lower + upper) * network.nodeCount() < 1e9;
+
+        State initial = network.initialState();
+        for (int i = 0; i < NetworkIntegratorCount; ++i)
+        {
+            NetworkIntegrator type = NetworkIntegrator(i);
+            if (type == NetworkBandedImplicit && !banded) continue;
+            unique_ptr<Integrator<State> > integrator = createIntegrator(type, &network, dt);
+
+            Stopwatch factoring;
+            integrator->setTimeStep(dt);    // factors the implicit integrator's matrix
+            double factorSeconds = factoring.seconds();
+
+            // reset every batch, as timeIntegrator() does, and run one
+            // untimed batch first
+            const int batch = 100;
+            integrator->setState(initial);
+            for (int k = 0; k < batch; ++k) integrator->step();
+
+            long long steps = 0;
+            double elapsed = 0.0;
+            do {
+                integrator->setState(initial);
+                Stopwatch stopwatch;
+                for (int k = 0; k < batch; ++k) integrator->step();
+                elapsed += stopwatch.seconds();
+                steps += batch;
+            } while (elapsed < seconds);
+
+            double stepNs = 1e9 * elapsed / steps;
+            table.row() << topologies[t] << network.nodeCount() << network.edgeCount()
+                        << int(network.matrixA().nonZeros()) << 1e3 * assembleSeconds
+                        << 1e9 * setEdgeSeconds << k_networkIntegratorNames[type];
+            if (type == NetworkBandedImplicit) table << 1e3 * factorSeconds;
+            else                               table.missing();
+            table << stepNs << stepNs / network.edgeCount();
+        }
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,171 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "DampedOscillator.h"
+#include "SimpleSpring.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+struct Regime
+{
+    const char *name;
+    double      damping;
+};
+
+// one run of one integrator setting, measured at each horizon
+struct PrecisionRun
+{
+    IntegratorType  type;
+    double          dt;
+    double          tolerance;      // zero for the fixed-step integrators
+    double          horizon;
+    double          error;
+    double          seconds;
+    long long       evaluations;
+};
+
+vector<double> numbers(const BenchmarkOptions &options, const string &name, const string &fallback)
+{
+    vector<string> items = options.list(name, fallback);
+    vector<double> values;
+    for (size_t i = 0; i < items.size(); ++i)
+        values.push_back(atof(items[i].c_str()));
+    return values;
+}
+
+// Integrates the spring from rest at x0 to each horizon in turn, comparing
+// with the exact solution there.  Runs are repeated until they add up to
+// minSeconds, so the times of short runs are averages rather than noise.
+void measure(SimpleSpring &spring, const DampedOscillator &exact, double x0,
+             IntegratorType type, double dt, double tolerance,
+             const vector<double> &horizons, double minSeconds,
+             vector<PrecisionRun> &runs)
+{
+    size_t first = runs.size();
+    for (size_t h = 0; h < horizons.size(); ++h) {
+        PrecisionRun r = { type, dt, tolerance, horizons[h], 0.0, 0.0, 0 };
+        runs.push_back(r);
+    }
+
+    CountingODE<Vector2d, Matrix2d> counting(&spring);
+    IntegratorVariant<Vector2d, Matrix2d> integrator;
+
+    int repetitions = 0;
+    double total = 0.0;
+    do {
+        integrator.create(type, &counting, dt);
+        integrator.setTimeStep(dt);
+        integrator.setTolerance(tolerance);
+        integrator.setState(Vector2d(0.0, x0));
+        counting.resetCount();
+
+        Stopwatch stopwatch;
+        long long steps = 0;
+        for (size_t h = 0; h < horizons.size(); ++h)
+        {
+            long long target = (long long)(floor(horizons[h] / dt + 0.5));
+            for (; steps < target; ++steps)
+                integrator.step();
+
+            PrecisionRun &r = runs[first + h];
+            r.seconds += stopwatch.seconds();
+            r.evaluations = counting.evaluations();
+            r.error = (integrator.state() - exact.state(steps * dt)).cwiseAbs().maxCoeff();
+        }
+        total += stopwatch.seconds();
+        ++repetitions;
+    } while (total < minSeconds);
+
+    for (size_t h = 0; h < horizons.size(); ++h)
+        runs[first + h].seconds /= repetitions;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkPrecision(const BenchmarkOptions &options)
+{
+    double mass         = options.number("mass", 1.0);
+    double stiffness    = options.number("stiffness", 200.0);
+    double gravity      = options.number("gravity", -9.81);
+    double x0           = options.number("position", 0.25);
+    double minSeconds   = options.number("seconds", 0.01);
+    double adaptiveDt   = options.number("adaptive-dt", 0.1);
+    bool   pickBest     = options.has("target");
+    double target       = options.number("target", 0.0);
+
+    vector<double> dts          = numbers(options, "dts", "0.02,0.01,0.005,0.002,0.001,0.0005,0.0002,0.0001");
+    vector<double> tolerances   = numbers(options, "tolerances", "1e-3,1e-4,1e-5,1e-6,1e-7,1e-8,1e-9,1e-10");
+    vector<double> horizons     = numbers(options, "horizons", "1,10");
+
+    // the damping for each regime follows from the mass and stiffness
+    double critical = 2.0 * sqrt(mass * stiffness);
+    Regime regimes[] = {
+        { "under",    options.number("under-damping", 1.0) },
+        { "critical", critical },
+        { "over",     options.number("over-damping", 4.0 * critical) },
+    };
+
+    const char *columns[] = { "regime", "integrator", "dt", "tolerance", "horizon",
+                              "error", "seconds", "evals" };
+    ResultTable table(vector<string>(columns, columns + 8));
+    ResultTable best(vector<string>(columns, columns + 8));
+
+    for (int g = 0; g < 3; ++g)
+    {
+        SimpleSpring spring(mass, stiffness, regimes[g].damping, gravity);
+        DampedOscillator exact(mass, stiffness, regimes[g].damping, gravity, x0);
+
+        // the fixed-step integrators sweep the time step, and the adaptive
+        // one sweeps its tolerance at a fixed outer step
+        vector<PrecisionRun> runs;
+        for (int i = 0; i < IntegratorTypeCount; ++i) {
+            IntegratorType type = IntegratorType(i);
+            if (type == DormandPrince) {
+                for (size_t k = 0; k < tolerances.size(); ++k)
+                    measure(spring, exact, x0, type, adaptiveDt, tolerances[k],
+                            horizons, minSeconds, runs);
+            }
+            else {
+                for (size_t k = 0; k < dts.size(); ++k)
+                    measure(spring, exact, x0, type, dts[k], 0.0, horizons, minSeconds, runs);
+            }
+        }
+
+        for (size_t r = 0; r < runs.size(); ++r)
+            table.row() << regimes[g].name << integratorName(runs[r].type) << runs[r].dt
+                        << runs[r].tolerance << runs[r].horizon << runs[r].error
+                        << runs[r].seconds << runs[r].evaluations;
+
+        // the fastest run meeting the accuracy target at each horizon
+        for (size_t h = 0; pickBest && h < horizons.size(); ++h)
+        {
+            const PrecisionRun *cheapest = 0;
+            for (size_t r = 0; r < runs.size(); ++r)
+                if (runs[r].horizon == horizons[h] && runs[r].error <= target &&
+                    (!cheapest || runs[r].seconds < cheapest->seconds))
+                    cheapest = &runs[r];
+
+            if (cheapest)
+                best.row() << regimes[g].name << integratorName(cheapest->type) << cheapest->dt
+                           << cheapest->tolerance << cheapest->horizon << cheapest->error
+                           << cheapest->seconds << cheapest->evaluations;
+            else
+                fprintf(stderr, "%s, horizon %g: no setting reaches an error of %g\n",
+                        regimes[g].name, horizons[h], target);
+        }
+    }
+
+    // with --target, only the cheapest setting meeting it is reported
+    printResults(pickBest ? best : table, options);
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include "TestProblems.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef TestProblem::StateType State;
+typedef TestProblem::MatrixType Matrix;
+
+// The integrators that apply to nonlinear problems: implicit Euler needs a
+// linear ODE, so the linearly implicit variant stands in for it.
+enum ProblemIntegrator
+{
+    ProblemEuler,
+    ProblemMidpoint,
+    ProblemRungeKutta4,
+    ProblemLinearlyImplicit,
+    ProblemDormandPrince,
+    ProblemIntegratorCount
+};
+
+const char *k_problemIntegratorNames[ProblemIntegratorCount] = {
+    "euler", "midpoint", "rk4", "linimplicit", "dopri"
+};
+
+unique_ptr<Integrator<State> > createIntegrator(ProblemIntegrator type, TestProblem *problem,
+                                                double dt, double tolerance)
+{
+    typedef unique_ptr<Integrator<State> > Pointer;
+    switch (type) {
+    case ProblemEuler:          return Pointer(new ExplicitEulerIntegrator<State>(problem, dt));
+    case ProblemMidpoint:       return Pointer(new ModifiedMidpointIntegrator<State>(problem, dt));
+    case ProblemRungeKutta4:    return Pointer(new RungeKutta4Integrator<State>(problem, dt));
+    case ProblemLinearlyImplicit:
+        return Pointer(new LinearlyImplicitEulerIntegrator<State, Matrix>(problem, dt));
+    case ProblemDormandPrince: {
+        DormandPrinceIntegrator<State> *dp = new DormandPrinceIntegrator<State>(problem, dt);
+        dp->setTolerance(tolerance);
+        return Pointer(dp);
+    }
+    default:                    return Pointer();
+    }
+}
+
+bool isFinite(const State &y)
+{
+    for (int i = 0; i < y.size(); ++i)
+        if (!(abs(y(i)) <= numeric_limits<double>::max())) return false;
+    return true;
+}
+
+struct ProblemRun
+{
+    double      error;          // infinite if the run blew up
+    double      drift;          // of the invariant, if the problem has one
+    double      seconds;
+    long long   evaluations;
+};
+
+// Integrates the problem to its end time in the given number of steps,
+// repeating the run until the runs add up to minSeconds.
+ProblemRun measure(TestProblem &problem, ProblemIntegrator type, int steps, double tolerance,
+                   double minSeconds)
+{
+    double dt = problem.endTime() / steps;
+    State initial = problem.initialState();
+
+    ProblemRun r = { 0.0, 0.0, 0.0, 0 };
+    int repetitions = 0;
+    State final;
+    do {
+        unique_ptr<Integrator<State> > integrator = createIntegrator(type, &problem, dt, tolerance);
+        integrator->setState(initial);
+
+        Stopwatch stopwatch;
+        bool finite = true;
+        for (int i = 0; i < steps && finite; ++i) {
+            integrator->step();
+            finite = isFinite(integrator->state());
+        }
+        r.seconds += stopwatch.seconds();
+        r.evaluations = integrator->counters().evaluations;
+        final = integrator->state();
+        ++repetitions;
+        if (!finite) break;
+    } while (r.seconds < minSeconds);
+    r.seconds /= repetitions;
+
+    r.error = isFinite(final) ? (final - problem.reference()).cwiseAbs().maxCoeff()
+                              : numeric_limits<double>::infinity();
+    if (problem.hasInvariant())
+        r.drift = problem.invariant(final) - problem.invariant(initial);
+    return r;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkProblems(const BenchmarkOptions &options)
+{
+    double minSeconds = options.number("seconds", 0.01);
+    vector<string> names    = options.list("problems", "vanderpol,duffing,pendulum,lorenz,"
+                                                       "robertson,hires,brusselator");
+    vector<string> steps    = options.list("steps", "100,1000,10000");
+    vector<string> tolerances = options.list("tolerances", "1e-4,1e-6,1e-8");
+
+    const char *columns[] = { "problem", "stiff", "integrator", "steps", "tolerance",
+                              "error", "invariant_drift", "seconds", "evals" };
+    ResultTable table(vector<string>(columns, columns + 9));
+
+    for (size_t p = 0; p < names.size(); ++p)
+    {
+        TestProblemType problemType;
+        if (!parseTestProblemType(names[p], &problemType)) {
+            fprintf(stderr, "ignoring unknown problem '%s'\n", names[p].c_str());
+            continue;
+        }
+        unique_ptr<TestProblem> problem = createTestProblem(problemType);
+
+        // the fixed-step integrators sweep the number of steps, and the
+        // adaptive one its tolerance at the smallest number of steps
+        for (int i = 0; i < ProblemIntegratorCount; ++i)
+        {
+            ProblemIntegrator type = ProblemIntegrator(i);
+            bool adaptive = type == ProblemDormandPrince;
+            size_t settings = adaptive ? tolerances.size() : steps.size();
+
+            for (size_t k = 0; k < settings; ++k)
+            {
+                int n = atoi((adaptive ? steps[0] : steps[k]).c_str());
+                double tolerance = adaptive ? atof(tolerances[k].c_str()) : 0.0;
+                if (n <= 0) continue;
+
+                ProblemRun r = measure(*problem, type, n, tolerance, minSeconds);
+                table.row() << problem->name() << (problem->isStiff() ? "yes" : "no")
+                            << k_problemIntegratorNames[type] << n << tolerance;
+
+                // a run that blew up has neither error nor drift
+                bool diverged = r.error == numeric_limits<double>::infinity();
+                if (diverged) table.missing();
+                else          table << r.error;
+                if (problem->hasInvariant() && !diverged) table << r.drift;
+                else                                      table.missing();
+                table << r.seconds << r.evaluations;
+            }
+        }
+    }
+
+    printResults(table, options);
+    return 0;
+}
+
+// --------------------------------------------------------------------------
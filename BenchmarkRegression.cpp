@@ -0,0 +1,216 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "Machine.h"
+#include "SimpleSpring.h"
+#include "SpringChain.h"
+#include "SpringScene.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+// The throughput of one case over all repetitions: the median, and a 95%
+// confidence interval for the median.
+struct Throughput
+{
+    double median;
+    double low;
+    double high;
+};
+
+typedef map<string, Throughput> Baseline;
+
+// The interval between order statistics around the median holds the true
+// median with about 95% probability, whatever the distribution of the
+// samples (the normal approximation to the binomial).
+Throughput summarize(vector<double> samples)
+{
+    sort(samples.begin(), samples.end());
+    int n = int(samples.size());
+    double spread = 0.98 * sqrt(double(n));
+    int low  = max(0, int(floor(0.5 * n - spread)));
+    int high = min(n - 1, int(ceil(0.5 * n + spread)) - 1);
+
+    Throughput t;
+    t.median = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    t.low    = samples[low];
+    t.high   = samples[high];
+    return t;
+}
+
+template <typename S, typename M>
+Throughput measureIntegrator(IntegratorType type, LinearODE<S, M> *ode, const S &initial,
+                             double dt, double seconds, int repetitions)
+{
+    vector<double> samples;
+    for (int r = 0; r < repetitions; ++r) {
+        IntegratorTiming t = timeIntegrator(type, ode, initial, dt, seconds);
+        samples.push_back(t.steps / t.seconds);
+    }
+    return summarize(samples);
+}
+
+// spring steps per second of a whole scene
+Throughput measureScene(SpringScene &scene, double seconds, int repetitions)
+{
+    vector<double> samples;
+    for (int r = 0; r < repetitions; ++r)
+    {
+        scene.reset();
+        long long updates = 0;
+        Stopwatch stopwatch;
+        double elapsed = 0.0;
+        do {
+            scene.update();
+            ++updates;
+            elapsed = stopwatch.seconds();
+        } while (elapsed < seconds);
+        samples.push_back(updates * scene.size() / elapsed);
+    }
+    return summarize(samples);
+}
+
+bool readBaseline(const string &filename, Baseline &baseline)
+{
+    ifstream in(filename.c_str());
+    if (!in) return false;
+
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream fields(line);
+        string name;
+        Throughput t;
+        if (fields >> name >> t.median >> t.low >> t.high)
+            baseline[name] = t;
+    }
+    return true;
+}
+
+bool writeBaseline(const string &filename, const vector<string> &names,
+                   const vector<Throughput> &results, string *error)
+{
+    ofstream out(filename.c_str());
+    if (!out) {
+        if (error) *error = "cannot write baseline '" + filename + "'";
+        return false;
+    }
+
+    out << "# benchmark baseline for " << Machine::hostName() << " (" << Machine::cpuName() << ")\n"
+        << "# case median low high, in steps per second\n";
+    out.precision(10);
+    for (size_t i = 0; i < names.size(); ++i)
+        out << names[i] << " " << results[i].median << " "
+            << results[i].low << " " << results[i].high << "\n";
+    return true;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkRegression(const BenchmarkOptions &options)
+{
+    double seconds      = options.number("seconds", 0.05);
+    double dt           = options.number("dt", 1e-4);
+    double threshold    = options.number("threshold", 10.0) / 100.0;
+    int    repetitions  = max(1, int(options.number("repetitions", 9)));
+    int    chainSize    = max(1, int(options.number("chain", 16)));
+    string sceneFile    = options.value("scene");
+    string filename     = options.value("baseline", "benchmark-" + Machine::hostName() + ".baseline");
+
+    // the cases: every integrator on the fixed-size spring and on a chain,
+    // and a whole scene
+    vector<string> names;
+    vector<Throughput> results;
+
+    SimpleSpring spring(1.0, 200.0, 1.0, -9.81);
+    Vector2d springState(0.0, 0.25);
+    SpringChain chain(chainSize);
+    VectorXd chainState = chain.initialState();
+
+    for (int i = 0; i < IntegratorTypeCount; ++i) {
+        IntegratorType type = IntegratorType(i);
+        names.push_back(string("spring/") + integratorName(type));
+        results.push_back(measureIntegrator(type, &spring, springState, dt, seconds, repetitions));
+    }
+    for (int i = 0; i < IntegratorTypeCount; ++i) {
+        IntegratorType type = IntegratorType(i);
+        ostringstream name;
+        name << "chain" << chainSize << "/" << integratorName(type);
+        names.push_back(name.str());
+        results.push_back(measureIntegrator(type, &chain, chainState, dt, seconds, repetitions));
+    }
+
+    SpringScene scene;
+    string error;
+    if (sceneFile.empty())
+        scene.createDefault();
+    else if (!scene.load(sceneFile, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    names.push_back("scene");
+    results.push_back(measureScene(scene, seconds, repetitions));
+
+    if (options.has("save")) {
+        if (!writeBaseline(filename, names, results, &error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        fprintf(stderr, "baseline written to %s\n", filename.c_str());
+    }
+
+    Baseline baseline;
+    bool haveBaseline = readBaseline(filename, baseline);
+    if (!haveBaseline)
+        fprintf(stderr, "no baseline '%s'; run with --save to record one\n", filename.c_str());
+
+    // A case regresses when its median drops by more than the threshold and
+    // the confidence intervals do not overlap, so that one noisy run does
+    // not fail the suite.
+    const char *columns[] = { "case", "median", "low", "high", "baseline", "change_pct", "status" };
+    ResultTable table(vector<string>(columns, columns + 7));
+    int regressions = 0;
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        const Throughput &t = results[i];
+        table.row() << names[i] << t.median << t.low << t.high;
+
+        Baseline::const_iterator b = baseline.find(names[i]);
+        if (b == baseline.end()) {
+            table.missing().missing() << "new";
+            continue;
+        }
+
+        const Throughput &base = b->second;
+        double change = t.median / base.median - 1.0;
+        bool regressed = t.median < (1.0 - threshold) * base.median && t.high < base.low;
+        bool improved  = t.median > (1.0 + threshold) * base.median && t.low > base.high;
+        if (regressed) ++regressions;
+
+        table << base.median << 100.0 * change
+              << (regressed ? "REGRESSED" : improved ? "improved" : "ok");
+    }
+
+    printResults(table, options);
+
+    if (regressions) {
+        fprintf(stderr, "%d case%s regressed by more than %g%%\n",
+                regressions, regressions == 1 ? "" : "s", 100.0 * threshold);
+        return 1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------
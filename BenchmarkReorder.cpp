@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "BandedLU.h"
+#include "NodeOrdering.h"
+#include "SpringNetwork.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+typedef SpringNetwork::StateType State;
+
+// A lattice as createLattice() makes it, but with its nodes numbered at
+// random, as a mesh read from a file might be.
+void buildShuffledLattice(SpringNetwork &network, int side, unsigned seed)
+{
+    int n = side * side;
+    vector<int> label(n);
+    for (int i = 0; i < n; ++i) label[i] = i;
+    mt19937 random(seed);
+    shuffle(label.begin(), label.end(), random);
+
+    vector<int> grid(n);
+    for (int i = 0; i < n; ++i) grid[label[i]] = i;
+
+    network.clear();
+    for (int i = 0; i < n; ++i) network.addNode(1.0, -0.1 * (grid[i] / side + 1));
+    for (int g = 0; g < n; ++g) {
+        int r = g / side, c = g % side;
+        if (r == 0) network.addEdge(SpringNetwork::Ground, label[g], 1000.0, 1.0, -0.1);
+        else        network.addEdge(label[g - side], label[g], 1000.0, 1.0, -0.1);
+        if (c > 0)  network.addEdge(label[g - 1], label[g], 1000.0, 1.0, 0.0);
+    }
+}
+
+// the graph of the network's rows, for factorFill()
+void rowGraph(const SpringNetwork &network, vector<int> &start, vector<int> &neighbours)
+{
+    int n = network.nodeCount();
+    start.assign(n + 1, 0);
+    for (int e = 0; e < network.edgeCount(); ++e)
+        if (network.edge(e).from != SpringNetwork::Ground) {
+            ++start[network.row(network.edge(e).from) + 1];
+            ++start[network.row(network.edge(e).to) + 1];
+        }
+    for (int i = 0; i < n; ++i) start[i + 1] += start[i];
+    neighbours.resize(start[n]);
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int e = 0; e < network.edgeCount(); ++e)
+        if (network.edge(e).from != SpringNetwork::Ground) {
+            int a = network.row(network.edge(e).from), b = network.row(network.edge(e).to);
+            neighbours[fill[a]++] = b;
+            neighbours[fill[b]++] = a;
+        }
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkReorder(const BenchmarkOptions &options)
+{
+    double seconds          = options.number("seconds", 0.1);
+    double dt               = options.number("dt", 1e-3);
+    vector<string> sizes    = options.list("sizes", "30,100,300");
+
+    const char *orderings[] = { "natural", "rcm", "amd" };
+    const SpringNetwork::Ordering kinds[] = { SpringNetwork::NaturalOrdering,
+                                              SpringNetwork::BandwidthOrdering,
+                                              SpringNetwork::FillOrdering };
+
+    const char *columns[] = { "side", "nodes", "ordering", "assemble_ms", "bandwidth",
+                              "factor_fill", "matvec_us", "banded_factor_ms", "max_difference" };
+    ResultTable table(vector<string>(columns, columns + 9));
+    streamResults(table, options);
+
+    for (size_t s = 0; s < sizes.size(); ++s)
+    {
+        int side = atoi(sizes[s].c_str());
+        if (side < 2) continue;
+
+        State reference;
+        for (int o = 0; o < 3; ++o)
+        {
+            SpringNetwork network;
+            buildShuffledLattice(network, side, 1u);
+            network.setOrdering(kinds[o]);
+            Stopwatch assembly;
+            network.assemble();
+            double assembleMs = 1e3 * assembly.seconds();
+
+            vector<int> start, neighbours;
+            rowGraph(network, start, neighbours);
+            long long fill = factorFill(start, neighbours, vector<int>());
+
+            int lower, upper;
+            bandwidth(network.matrixA(), interleavedOrdering(2 * network.nodeCount()),
+                      &lower, &upper);
+
+            State y = network.initialState(), dy;
+            long long evaluations = 0;
+            Stopwatch stopwatch;
+            do {
+                for (int i = 0; i < 10; ++i) network.derivative(0.0, y, dy);
+                evaluations += 10;
+            } while (stopwatch.seconds() < seconds);
+            double matvecUs = 1e6 * stopwatch.seconds() / evaluations;
+
+            // the same steps in any numbering, once put back in node order
+            ExplicitEulerIntegrator<State> euler(&network, dt);
+            euler.setState(y);
+            for (int i = 0; i < 10; ++i) euler.step();
+            State result = network.toNodeOrder(euler.state());
+            if (o == 0) reference = result;
+
+            table.row() << side << network.nodeCount() << orderings[o] << assembleMs
+                        << max(lower, upper) << fill << matvecUs;
+
+            // the band of a scattered numbering is as wide as the network
+            if (double(lower) * (lower + upper) * network.nodeCount() < 1e9) {
+                BandedImplicitEulerIntegrator<State, SpringNetwork::MatrixType> banded(&network, dt);
+                banded.setOrdering(interleavedOrdering(2 * network.nodeCount()));
+                Stopwatch factoring;
+                banded.setTimeStep(dt);
+                table << 1e3 * factoring.seconds();
+            }
+            else table.missing();
+            table << (result - reference).cwiseAbs().maxCoeff();
+        }
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+#include <random>
+#include "SpringScene.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+// An ensemble of damped springs released from random heights, stepped at
+// 60 Hz with and without sleeping.  Once every spring has been still for
+// the dwell time the frame cost falls to a scan of the awake flags; a
+// change of gravity then wakes them all.
+int benchmarkSleep(const BenchmarkOptions &options)
+{
+    int count           = int(options.number("springs", 20000));
+    double duration     = options.number("duration", 20.0);
+    double energy       = options.number("energy", 1e-6);
+    double distance     = options.number("distance", 1e-4);
+    double dwell        = options.number("dwell", 0.5);
+    double frame        = 1.0 / 60.0;
+
+    const char *columns[] = { "sleeping", "time", "awake", "frame_ms", "ns_per_spring" };
+    ResultTable table(vector<string>(columns, columns + 5));
+    streamResults(table, options);
+
+    SpringScene scene;
+    scene.reserve(count);
+    mt19937 random(1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < count; ++i) {
+        SpringDescription d;
+        d.stiffness = 200.0 + 800.0 * unit(random);
+        d.damping = 2.0 + 8.0 * unit(random);
+        d.initialPosition = 0.5 * unit(random);
+        scene.addSpring(d);
+    }
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        SpringScene run = scene;
+        bool sleeping = pass == 1;
+        if (sleeping) run.setSleeping(SleepThresholds(energy, distance, dwell));
+
+        // one row per simulated second, then one after waking everything
+        int frames = int(duration / frame + 0.5);
+        Stopwatch stopwatch;
+        for (int f = 1; f <= frames + 60; ++f)
+        {
+            if (f == frames + 1) run.setParameter(-1, Gravity, -9.0);
+            run.update(frame);
+            if (f % 60 == 0) {
+                double ms = 1e3 * stopwatch.seconds() / 60.0;
+                table.row() << (sleeping ? "on" : "off") << f * frame << run.awakeCount() << ms
+                            << 1e6 * ms / count;
+                stopwatch.restart();
+            }
+        }
+    }
+
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include "DampedOscillator.h"
+#include "SimpleSpring.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+// the spring parameters set by the main window's spinners
+enum SweepParameter { SweepMass, SweepStiffness, SweepDamping, SweepGravity, SweepTimeStep,
+                      SweepParameterCount };
+
+const char *k_parameterNames[SweepParameterCount] = {
+    "mass", "stiffness", "damping", "gravity", "dt"
+};
+const char *k_parameterDefaults[SweepParameterCount] = {
+    "1", "50,200,1000", "0,1,10", "-9.81", "0.02,0.005,0.001"
+};
+
+// stiffness and time step span decades, so are sampled on a log scale
+const bool k_logarithmic[SweepParameterCount] = { false, true, false, false, true };
+
+struct SweepCase
+{
+    IntegratorType  type;
+    double          values[SweepParameterCount];
+};
+
+struct SweepResult
+{
+    double      error;
+    double      energyDrift;
+    double      divergedAt;     // negative if the run stayed bounded
+    double      seconds;
+    long long   evaluations;
+};
+
+vector<double> numbers(const BenchmarkOptions &options, int parameter)
+{
+    vector<string> items = options.list(k_parameterNames[parameter],
+                                        k_parameterDefaults[parameter]);
+    vector<double> values;
+    for (size_t i = 0; i < items.size(); ++i)
+        values.push_back(atof(items[i].c_str()));
+    return values;
+}
+
+// every combination of the listed values
+void gridCases(const vector<double> (&values)[SweepParameterCount],
+               const vector<IntegratorType> &types, vector<SweepCase> &cases)
+{
+    size_t combinations = 1;
+    for (int p = 0; p < SweepParameterCount; ++p) combinations *= values[p].size();
+
+    for (size_t t = 0; t < types.size(); ++t)
+        for (size_t i = 0; i < combinations; ++i) {
+            SweepCase c;
+            c.type = types[t];
+            for (size_t p = 0, rest = i; p < SweepParameterCount; rest /= values[p].size(), ++p)
+                c.values[p] = values[p][rest % values[p].size()];
+            cases.push_back(c);
+        }
+}
+
+// Latin-hypercube samples between the smallest and largest listed value of
+// each parameter: every parameter's range is cut into as many strata as
+// there are samples, and each stratum is used exactly once.
+void latinCases(const vector<double> (&values)[SweepParameterCount], int samples,
+                unsigned seed, const vector<IntegratorType> &types, vector<SweepCase> &cases)
+{
+    mt19937 random(seed);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    vector<SweepCase> points(samples);
+    for (int p = 0; p < SweepParameterCount; ++p)
+    {
+        double low  = *min_element(values[p].begin(), values[p].end());
+        double high = *max_element(values[p].begin(), values[p].end());
+        bool logarithmic = k_logarithmic[p] && low > 0.0;
+        if (logarithmic) { low = log(low); high = log(high); }
+
+        vector<int> strata(samples);
+        for (int i = 0; i < samples; ++i) strata[i] = i;
+        shuffle(strata.begin(), strata.end(), random);
+
+        for (int i = 0; i < samples; ++i) {
+            double v = low + (high - low) * (strata[i] + uniform(random)) / samples;
+            points[i].values[p] = logarithmic ? exp(v) : v;
+        }
+    }
+
+    // every integrator runs the same samples, so they can be compared
+    for (size_t t = 0; t < types.size(); ++t)
+        for (int i = 0; i < samples; ++i) {
+            points[i].type = types[t];
+            cases.push_back(points[i]);
+        }
+}
+
+double energy(const SweepCase &c, double equilibrium, const Vector2d &y)
+{
+    double x = y(1) - equilibrium;
+    return 0.5 * c.values[SweepMass] * y(0) * y(0) + 0.5 * c.values[SweepStiffness] * x * x;
+}
+
+// Integrates one case from rest at x0 to the horizon, stopping early if
+// the state blows up.
+SweepResult simulate(const SweepCase &c, double x0, double horizon, double tolerance)
+{
+    double m = c.values[SweepMass], k = c.values[SweepStiffness];
+    double b = c.values[SweepDamping], g = c.values[SweepGravity];
+    double dt = c.values[SweepTimeStep];
+
+    SimpleSpring spring(m, k, b, g);
+    DampedOscillator exact(m, k, b, g, x0);
+    double equilibrium = exact.equilibrium();
+    double limit = 1e6 * (1.0 + fabs(x0) + fabs(equilibrium));
+
+    CountingODE<Vector2d, Matrix2d> counting(&spring);
+    IntegratorVariant<Vector2d, Matrix2d> integrator;
+    integrator.create(c.type, &counting, dt);
+    integrator.setTimeStep(dt);
+    integrator.setTolerance(tolerance);
+    integrator.setState(Vector2d(0.0, x0));
+
+    SweepResult r = { 0.0, 0.0, -1.0, 0.0, 0 };
+    long long steps = (long long)(ceil(horizon / dt - 1e-9));
+    Stopwatch stopwatch;
+    long long s = 0;
+    while (s < steps) {
+        integrator.step();
+        ++s;
+        const Vector2d &y = integrator.state();
+        if (!(fabs(y(0)) < limit && fabs(y(1)) < limit)) {
+            r.divergedAt = s * dt;
+            break;
+        }
+    }
+    r.seconds = stopwatch.seconds();
+    r.evaluations = counting.evaluations();
+
+    Vector2d reference = exact.state(s * dt);
+    r.error = (integrator.state() - reference).cwiseAbs().maxCoeff();
+
+    // drift relative to the starting energy, or absolute if that is zero
+    double initial = energy(c, equilibrium, Vector2d(0.0, x0));
+    double drift = energy(c, equilibrium, integrator.state()) - energy(c, equilibrium, reference);
+    r.energyDrift = initial > 0.0 ? drift / initial : drift;
+    return r;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+int benchmarkSweep(const BenchmarkOptions &options)
+{
+    double horizon      = options.number("horizon", 10.0);
+    double x0           = options.number("position", 0.25);
+    double tolerance    = options.number("tolerance", 1e-6);
+    int    samples      = int(options.number("latin", 0));
+    int    threads      = int(options.number("threads", 0));
+    unsigned seed       = unsigned(options.number("seed", 1));
+
+    vector<IntegratorType> types;
+    vector<string> names = options.list("integrators", "euler,midpoint,rk4,implicit,dopri");
+    for (size_t i = 0; i < names.size(); ++i) {
+        IntegratorType type;
+        if (parseIntegratorType(names[i], &type)) types.push_back(type);
+        else fprintf(stderr, "ignoring unknown integrator '%s'\n", names[i].c_str());
+    }
+
+    vector<double> values[SweepParameterCount];
+    for (int p = 0; p < SweepParameterCount; ++p) {
+        values[p] = numbers(options, p);
+        if (values[p].empty()) {
+            fprintf(stderr, "no values for --%s\n", k_parameterNames[p]);
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < values[SweepTimeStep].size(); ++i)
+        if (values[SweepTimeStep][i] <= 0.0) {
+            fprintf(stderr, "time steps must be positive\n");
+            return 1;
+        }
+
+    // a grid over the listed values, or with --latin N, N samples spread
+    // over their ranges
+    vector<SweepCase> cases;
+    if (samples > 0) latinCases(values, samples, seed, types, cases);
+    else             gridCases(values, types, cases);
+
+    const char *columns[] = { "case", "integrator", "mass", "stiffness", "damping", "gravity",
+                              "dt", "error", "energy_drift", "diverged_at", "seconds", "evals" };
+    ResultTable table(vector<string>(columns, columns + 12));
+    streamResults(table, options);
+
+    // rows are written in the order the cases finish
+    mutex tableMutex;
+    WorkStealingPool pool(threads);
+    pool.run(int(cases.size()), [&](int i)
+    {
+        const SweepCase &c = cases[i];
+        SweepResult r = simulate(c, x0, horizon, tolerance);
+
+        lock_guard<mutex> lock(tableMutex);
+        table.row() << i << integratorName(c.type);
+        for (int p = 0; p < SweepParameterCount; ++p) table << c.values[p];
+        if (r.divergedAt < 0.0) table << r.error << r.energyDrift;
+        else                    table.missing().missing();
+        if (r.divergedAt < 0.0) table.missing();
+        else                    table << r.divergedAt;
+        table << r.seconds << r.evaluations;
+    });
+    table.finish();
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,182 @@
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+#include "SpringScene.h"
+#include "TrajectoryRecorder.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+bool copyFile(const string &from, const string &to, size_t keep,
+              size_t patchAt = 0, unsigned long long patch = 0)
+{
+    ifstream in(from.c_str(), ios::binary);
+    vector<char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    bytes.resize(min(keep, bytes.size()));
+    if (patchAt > 0 && patchAt + sizeof(patch) <= bytes.size())
+        memcpy(&bytes[patchAt], &patch, sizeof(patch));
+    ofstream out(to.c_str(), ios::binary);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    return bool(out);
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+// Records a spring ensemble from several threads, as the fast-forward
+// workers do, then reads the file back and checks that every record is
+// there exactly once with the state it was recorded with.  Damaged copies
+// of the file (cut short, or with an index entry pointing past the end of
+// the chunks) must be refused by TrajectoryFile::open().  Exits non-zero
+// if any check fails.
+int benchmarkTrajectory(const BenchmarkOptions &options)
+{
+    int count           = int(options.number("springs", 1000));
+    int steps           = int(options.number("steps", 200));
+    int threads         = max(1, int(options.number("threads", 4)));
+    size_t chunk        = size_t(max(1.0, options.number("chunk", 4096)));
+    string filename     = options.value("file", "trajectory-check.traj");
+
+    const char *columns[] = { "springs", "threads", "records", "chunks", "write_MBps",
+                              "read_MBps", "mismatches", "damaged_refused" };
+    ResultTable table(vector<string>(columns, columns + 8));
+
+    SpringScene scene;
+    scene.reserve(count);
+    mt19937 random(1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < count; ++i) {
+        SpringDescription d;
+        d.stiffness = 100.0 + 900.0 * unit(random);
+        d.initialPosition = unit(random);
+        scene.addSpring(d);
+    }
+    double dt = scene.maxTimeStep();
+
+    // what each record should hold, written by the threads as they go
+    const int n = SpringScene::StateType::SizeAtCompileTime;
+    vector<double> expected(size_t(steps) * count * n);
+
+    TrajectoryRecorder recorder(chunk);
+    string error;
+    if (!recorder.start(filename, n, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    vector<TrajectoryRecorder::Producer *> producers;
+    for (int t = 0; t < threads; ++t) producers.push_back(recorder.createProducer());
+
+    Stopwatch stopwatch;
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(thread([&, t]() {
+            int first = t * count / threads, last = (t + 1) * count / threads;
+            for (int s = 0; s < steps; ++s) {
+                scene.update(dt, first, last);
+                for (int i = first; i < last; ++i) {
+                    SpringScene::StateType y = scene.spring(i).currentState();
+                    for (int k = 0; k < n; ++k) expected[(size_t(s) * count + i) * n + k] = y[k];
+                    producers[t]->record((s + 1) * dt, unsigned(i), y);
+                }
+            }
+        }));
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    bool written = recorder.stop(&error);
+    double writeSeconds = stopwatch.seconds();
+    if (!written) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    // read it all back
+    stopwatch.restart();
+    TrajectoryFile file;
+    if (!file.open(filename, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    long long records = 0, mismatches = 0;
+    vector<char> seen(size_t(steps) * count, 0);
+    for (size_t c = 0; c < file.chunkCount(); ++c)
+    {
+        TrajectoryFile::Chunk ch = file.chunk(c);
+        for (size_t r = 0; r < ch.count; ++r, ++records)
+        {
+            long long s = (long long)(floor(ch.time[r] / dt + 0.5)) - 1;
+            long long i = ch.id[r];
+            if (s < 0 || s >= steps || i >= count || seen[size_t(s) * count + i]) {
+                ++mismatches;
+                continue;
+            }
+            seen[size_t(s) * count + i] = 1;
+            for (int k = 0; k < n; ++k)
+                if (ch.component(k, r) != expected[(size_t(s) * count + i) * n + k]) {
+                    ++mismatches;
+                    break;
+                }
+        }
+    }
+    mismatches += (long long)(steps) * count - (records - mismatches);
+
+    // chunks before the one findChunk() gives must all end earlier
+    for (int s = 0; s < steps; s += max(1, steps / 16)) {
+        double t = (s + 1) * dt;
+        for (size_t c = 0; c < file.findChunk(t); ++c)
+            if (file.chunkInfo(c).maxTime >= t) ++mismatches;
+    }
+    double readSeconds = stopwatch.seconds();
+    size_t chunks = file.chunkCount();
+    file.close();
+
+    // damaged copies: cut short, a chunk count that would overflow the
+    // index size, and a first chunk claiming to run into the index
+    ifstream probe(filename.c_str(), ios::binary | ios::ate);
+    size_t size = size_t(probe.tellg());
+    probe.close();
+    string damaged = filename + ".damaged";
+    int refused = 0, cases = 0;
+    for (int d = 0; d < 3; ++d)
+    {
+        bool made = false;
+        if (d == 0) made = copyFile(filename, damaged, size - 1);
+        if (d == 1) made = copyFile(filename, damaged, size, size - 16, 1ull << 61);
+        if (d == 2) {
+            unsigned long long indexOffset = 0;
+            ifstream in(filename.c_str(), ios::binary);
+            in.seekg(size - 24);
+            in.read(reinterpret_cast<char *>(&indexOffset), sizeof(indexOffset));
+            made = copyFile(filename, damaged, size, size_t(indexOffset) + 8, 1ull << 40);
+        }
+        if (!made) continue;
+        ++cases;
+        TrajectoryFile check;
+        if (!check.open(damaged)) ++refused;
+    }
+    remove(damaged.c_str());
+    remove(filename.c_str());
+
+    double megabytes = double(size) / (1 << 20);
+    table.row() << count << threads << records << (long long)(chunks) << megabytes / writeSeconds
+                << megabytes / readSeconds << mismatches << refused;
+    printResults(table, options);
+
+    if (mismatches > 0 || refused < cases) {
+        fprintf(stderr, "FAILED: %lld records wrong or missing, %d of %d damaged files refused\n",
+                mismatches, refused, cases);
+        return 1;
+    }
+    fprintf(stderr, "passed: every record read back, every damaged file refused\n");
+    return 0;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,97 @@
+#include "Checkpoint.h"
+#include <istream>
+#include <ostream>
+#include <algorithm>
+
+// --------------------------------------------------------------------------
+
+CheckpointWriter::CheckpointWriter(std::ostream &out, size_t bufferSize)
+    : m_out(out), m_buffer(bufferSize), m_used(0), m_ok(true)
+{}
+
+void CheckpointWriter::writeHeader()
+{
+    writeBytes(k_checkpointMagic, sizeof(k_checkpointMagic));
+    write(k_checkpointVersion);
+    write(k_checkpointByteOrder);
+}
+
+void CheckpointWriter::writeBytes(const void *data, size_t size)
+{
+    // small writes are copied into the buffer, big ones go straight out
+    if (m_used + size > m_buffer.size()) {
+        flush();
+        if (size > m_buffer.size()) {
+            m_out.write(static_cast<const char *>(data), size);
+            m_ok = m_ok && m_out.good();
+            return;
+        }
+    }
+    memcpy(&m_buffer[m_used], data, size);
+    m_used += size;
+}
+
+bool CheckpointWriter::flush()
+{
+    if (m_used > 0) {
+        m_out.write(&m_buffer[0], m_used);
+        m_used = 0;
+    }
+    m_ok = m_ok && m_out.good();
+    return m_ok;
+}
+
+// --------------------------------------------------------------------------
+
+CheckpointReader::CheckpointReader(std::istream &in, size_t bufferSize)
+    : m_in(in), m_buffer(bufferSize), m_position(0), m_end(0), m_ok(true),
+      m_version(k_checkpointVersion)
+{}
+
+bool CheckpointReader::readHeader()
+{
+    char magic[sizeof(k_checkpointMagic)];
+    unsigned int version, byteOrder;
+
+    if (!readBytes(magic, sizeof(magic))) return false;
+    if (memcmp(magic, k_checkpointMagic, sizeof(magic)) != 0)
+        return fail("not a checkpoint file");
+    if (!read(version) || !read(byteOrder)) return false;
+    if (byteOrder != k_checkpointByteOrder)
+        return fail("checkpoint was written on a machine with a different byte order");
+    if (version < 1 || version > k_checkpointVersion)
+        return fail("unsupported checkpoint version");
+    m_version = version;
+    return true;
+}
+
+bool CheckpointReader::readBytes(void *data, size_t size)
+{
+    if (!m_ok) return false;
+
+    char *out = static_cast<char *>(data);
+    while (size > 0)
+    {
+        if (m_position == m_end) {
+            m_in.read(&m_buffer[0], m_buffer.size());
+            m_position = 0;
+            m_end = size_t(m_in.gcount());
+            if (m_end == 0) return fail("unexpected end of checkpoint");
+        }
+        size_t n = std::min(size, m_end - m_position);
+        memcpy(out, &m_buffer[m_position], n);
+        m_position += n;
+        out += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool CheckpointReader::fail(const std::string &error)
+{
+    if (m_ok) m_error = error;
+    m_ok = false;
+    return false;
+}
+
+// --------------------------------------------------------------------------
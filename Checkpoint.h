@@ -0,0 +1,176 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// Checkpoints are a compact binary dump of simulation state in the native
+// byte order: a header (magic, format version, byte order marker) followed
+// by whatever records the object being saved writes.  Reading and writing
+// go through a buffer, so huge scenes are streamed in fixed-size chunks.
+//
+// Version 2 added DormandPrince as integrator type 4; in version 1 files
+// type 4 is the null integrator.
+
+const char         k_checkpointMagic[8]     = { 'S', 'P', 'R', 'I', 'N', 'G', 'C', 'K' };
+const unsigned int k_checkpointVersion      = 2;
+const unsigned int k_checkpointByteOrder    = 0x01020304;
+
+class CheckpointWriter
+{
+    std::ostream       &m_out;
+    std::vector<char>   m_buffer;
+    size_t              m_used;
+    bool                m_ok;
+
+public:
+    explicit CheckpointWriter(std::ostream &out, size_t bufferSize = 1 << 16);
+    ~CheckpointWriter() { flush(); }
+
+    void writeHeader();
+    void writeBytes(const void *data, size_t size);
+
+    // writes a plain-old-data value as raw bytes
+    template <typename T> void write(const T &value) { writeBytes(&value, sizeof(T)); }
+
+    // Eigen matrices: dimensions are only stored if not fixed at compile time
+    template <typename Derived>
+    void writeMatrix(const Eigen::PlainObjectBase<Derived> &m)
+    {
+        if (Derived::RowsAtCompileTime == Eigen::Dynamic) write(int(m.rows()));
+        if (Derived::ColsAtCompileTime == Eigen::Dynamic) write(int(m.cols()));
+        writeBytes(m.data(), m.size() * sizeof(typename Derived::Scalar));
+    }
+
+    bool flush();
+    bool ok() const                     { return m_ok; }
+};
+
+class CheckpointReader
+{
+    std::istream       &m_in;
+    std::vector<char>   m_buffer;
+    size_t              m_position, m_end;
+    bool                m_ok;
+    std::string         m_error;
+    unsigned int        m_version;
+
+public:
+    explicit CheckpointReader(std::istream &in, size_t bufferSize = 1 << 16);
+
+    // checks the magic number, version and byte order of the stream; files
+    // of this or an earlier version are read
+    bool readHeader();
+    unsigned int version() const        { return m_version; }
+    bool readBytes(void *data, size_t size);
+
+    template <typename T> bool read(T &value) { return readBytes(&value, sizeof(T)); }
+
+    template <typename Derived>
+    bool readMatrix(Eigen::PlainObjectBase<Derived> &m)
+    {
+        int rows = int(m.rows()), cols = int(m.cols());
+        if (Derived::RowsAtCompileTime == Eigen::Dynamic && !read(rows)) return false;
+        if (Derived::ColsAtCompileTime == Eigen::Dynamic && !read(cols)) return false;
+        if (rows < 0 || cols < 0) return fail("bad matrix size");
+        m.resize(rows, cols);
+        return readBytes(m.data(), m.size() * sizeof(typename Derived::Scalar));
+    }
+
+    // marks the stream as bad; returns false for convenience
+    bool fail(const std::string &error);
+
+    bool ok() const                     { return m_ok; }
+    const std::string &error() const    { return m_error; }
+};
+
+// --------------------------------------------------------------------------
+
+// Integrator records: the type, time, time step and state, plus the cached
+// factorization for implicit integrators so that they resume without having
+// to refactor.
+
+template <typename S, typename M>
+void writeIntegrator(CheckpointWriter &out, const IntegratorVariant<S, M> &v)
+{
+    out.write((unsigned char)(v.type()));
+    if (v.isNull()) return;
+
+    const Integrator<S> *i = v.integrator();
+    out.write(i->time());
+    out.write(i->timeStep());
+    out.writeMatrix(i->state());
+
+    if (v.type() == ImplicitEuler) {
+        const RestorableLU<M> &lu =
+            static_cast<const ImplicitEulerIntegrator<S, M> *>(i)->factorization();
+        out.write((unsigned char)(lu.isInitialized()));
+        if (lu.isInitialized()) {
+            out.writeMatrix(lu.matrixLU());
+            for (int k = 0; k < lu.transpositions().size(); ++k)
+                out.write(int(lu.transpositions().coeff(k)));
+        }
+    }
+    else if (v.type() == DormandPrince) {
+        const DormandPrinceIntegrator<S> *dp = static_cast<const DormandPrinceIntegrator<S> *>(i);
+        out.write(dp->tolerance());
+        out.write(dp->substep());
+    }
+}
+
+template <typename S, typename M>
+bool readIntegrator(CheckpointReader &in, IntegratorVariant<S, M> &v, LinearODE<S, M> *ode)
+{
+    unsigned char type;
+    if (!in.read(type)) return false;
+    unsigned char nullType = in.version() < 2 ? (unsigned char)(DormandPrince) : IntegratorTypeCount;
+    if (type > nullType) return in.fail("bad integrator type");
+    if (type == nullType) {
+        v.clear();
+        return true;
+    }
+
+    double t, dt;
+    S state;
+    if (!in.read(t) || !in.read(dt) || !in.readMatrix(state)) return false;
+
+    v.create(IntegratorType(type), ode, dt);
+    Integrator<S> *i = v.integrator();
+    i->setTime(t);
+    i->setState(state);
+
+    if (type == ImplicitEuler) {
+        unsigned char initialized;
+        if (!in.read(initialized)) return false;
+        if (initialized) {
+            M lu;
+            if (!in.readMatrix(lu)) return false;
+            typename RestorableLU<M>::TranspositionType transpositions(lu.rows());
+            for (int k = 0; k < lu.rows(); ++k) {
+                int index;
+                if (!in.read(index)) return false;
+                if (index < 0 || index >= lu.rows()) return in.fail("bad pivot index");
+                transpositions.coeffRef(k) = index;
+            }
+            static_cast<ImplicitEulerIntegrator<S, M> *>(i)->factorization()
+                    .restore(lu, transpositions);
+        }
+    }
+    else if (type == DormandPrince) {
+        double tolerance, substep;
+        if (!in.read(tolerance) || !in.read(substep)) return false;
+        DormandPrinceIntegrator<S> *dp = static_cast<DormandPrinceIntegrator<S> *>(i);
+        dp->setTolerance(tolerance);
+        dp->setSubstep(substep);
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+#endif // CHECKPOINT_H
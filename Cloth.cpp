@@ -0,0 +1,510 @@
+#include "Cloth.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace Eigen;
+
+namespace {
+
+// particles in each of ClothIntegrator's chunks
+const int k_chunkParticles = 256;
+
+}
+
+// --------------------------------------------------------------------------
+
+Cloth::Cloth()
+    : m_gravity(0.0, -9.81, 0.0), m_assembled(false), m_pool(0)
+{}
+
+void Cloth::clear()
+{
+    m_masses.clear();
+    m_positions.clear();
+    m_springs.clear();
+    m_pinned.clear();
+    m_targets.clear();
+    m_assembled = false;
+}
+
+int Cloth::addParticle(double mass, const Vector3d &position)
+{
+    m_masses.push_back(mass);
+    m_positions.push_back(position);
+    m_pinned.push_back(0);
+    m_targets.push_back(position);
+    m_assembled = false;
+    return particleCount() - 1;
+}
+
+int Cloth::addSpring(int a, int b, double stiffness, double damping)
+{
+    ClothSpring s = { a, b, stiffness, damping, (m_positions[b] - m_positions[a]).norm() };
+    m_springs.push_back(s);
+    m_assembled = false;
+    return springCount() - 1;
+}
+
+void Cloth::createSheet(int width, int height, double spacing, double mass,
+                        double stretch, double shear, double bend, double damping)
+{
+    clear();
+    for (int r = 0; r < height; ++r)
+        for (int c = 0; c < width; ++c)
+            addParticle(mass, Vector3d(c * spacing, 0.0, r * spacing));
+
+    for (int r = 0; r < height; ++r)
+        for (int c = 0; c < width; ++c)
+        {
+            int i = r * width + c;
+            if (c + 1 < width)  addSpring(i, i + 1, stretch, damping);
+            if (r + 1 < height) addSpring(i, i + width, stretch, damping);
+            if (c + 1 < width && r + 1 < height) {
+                addSpring(i, i + width + 1, shear, damping);
+                addSpring(i + 1, i + width, shear, damping);
+            }
+            if (c + 2 < width)  addSpring(i, i + 2, bend, damping);
+            if (r + 2 < height) addSpring(i, i + 2 * width, bend, damping);
+        }
+    assemble();
+}
+
+void Cloth::pin(int i)
+{
+    pin(i, m_positions[i]);
+}
+
+void Cloth::pin(int i, const Vector3d &target)
+{
+    m_pinned[i] = 1;
+    m_targets[i] = target;
+}
+
+void Cloth::unpin(int i)
+{
+    m_pinned[i] = 0;
+}
+
+void Cloth::assemble()
+{
+    int n = particleCount();
+    m_incidentStart.assign(n + 1, 0);
+    for (size_t e = 0; e < m_springs.size(); ++e) {
+        ++m_incidentStart[m_springs[e].a + 1];
+        ++m_incidentStart[m_springs[e].b + 1];
+    }
+    for (int i = 0; i < n; ++i) m_incidentStart[i + 1] += m_incidentStart[i];
+
+    m_incident.resize(2 * m_incidentStart[n] + 1);
+    vector<int> fill(m_incidentStart.begin(), m_incidentStart.end() - 1);
+    for (size_t e = 0; e < m_springs.size(); ++e) {
+        int a = m_springs[e].a, b = m_springs[e].b;
+        int *at = &m_incident[2 * fill[a]++];
+        at[0] = int(e);     at[1] = b;
+        at = &m_incident[2 * fill[b]++];
+        at[0] = int(e);     at[1] = a;
+    }
+    for (int i = 0; i <= n; ++i) m_incidentStart[i] *= 2;
+    m_assembled = true;
+    partition();
+}
+
+void Cloth::setThreadPool(WorkStealingPool *pool)
+{
+    m_pool = pool;
+    partition();
+}
+
+// a few chunks per thread; each particle gathers its own forces, so the
+// result does not depend on how many there are
+void Cloth::partition()
+{
+    int chunks = m_pool ? 4 * m_pool->threadCount() : 1;
+    int n = particleCount(), springs = springCount();
+
+    m_springChunks.resize(chunks + 1);
+    m_nodeChunks.resize(chunks + 1);
+    for (int c = 0; c <= chunks; ++c) {
+        m_springChunks[c] = int((long long)springs * c / chunks);
+        m_nodeChunks[c] = int((long long)n * c / chunks);
+    }
+    m_forces.resize(m_pool ? springs : 0);
+}
+
+// --------------------------------------------------------------------------
+
+Cloth::StateType Cloth::initialState() const
+{
+    int n = particleCount();
+    StateType y = StateType::Zero(6 * n);
+    for (int i = 0; i < n; ++i)
+        y.segment<3>(3 * n + 3 * i) = m_positions[i];
+    return y;
+}
+
+Cloth::StateType Cloth::derivativeFunction(double t, const StateType &y) const
+{
+    StateType dy;
+    derivative(t, y, dy);
+    return dy;
+}
+
+void Cloth::derivative(double t, const StateType &y, StateType &dy) const
+{
+    int n = particleCount();
+    dy.resize(6 * n);
+
+    if (m_pool && m_assembled)
+    {
+        // the lambda holds a single pointer so that making a Task of it
+        // does not allocate
+        struct Evaluation {
+            const Cloth *cloth;  const StateType *y;  StateType *dy;  bool gather;
+        } evaluation = { this, &y, &dy, false };
+        WorkStealingPool::Task task = [&evaluation](int chunk) {
+            if (evaluation.gather) evaluation.cloth->gatherForces(chunk, *evaluation.y, *evaluation.dy);
+            else                   evaluation.cloth->springForces(chunk, *evaluation.y);
+        };
+
+        int chunks = int(m_springChunks.size()) - 1;
+        m_pool->run(chunks, task);
+        evaluation.gather = true;
+        m_pool->run(chunks, task);
+        return;
+    }
+
+    for (int i = 0; i < n; ++i)
+        dy.segment<3>(3 * i) = m_masses[i] * m_gravity;
+
+    for (size_t e = 0; e < m_springs.size(); ++e)
+    {
+        const ClothSpring &s = m_springs[e];
+        Vector3d d = y.segment<3>(3 * n + 3 * s.b) - y.segment<3>(3 * n + 3 * s.a);
+        double l = d.norm();
+        if (l == 0.0) continue;
+        Vector3d u = d / l;
+        double relative = u.dot(y.segment<3>(3 * s.b) - y.segment<3>(3 * s.a));
+        Vector3d f = (s.stiffness * (l - s.length) + s.damping * relative) * u;
+        dy.segment<3>(3 * s.a) += f;
+        dy.segment<3>(3 * s.b) -= f;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (m_pinned[i]) dy.segment<3>(3 * i).setZero();
+        else             dy.segment<3>(3 * i) /= m_masses[i];
+    }
+    dy.tail(3 * n) = y.head(3 * n);
+}
+
+// the force on each spring's first particle
+void Cloth::springForces(int chunk, const StateType &y) const
+{
+    int n = particleCount();
+    for (int e = m_springChunks[chunk]; e < m_springChunks[chunk + 1]; ++e)
+    {
+        const ClothSpring &s = m_springs[e];
+        Vector3d d = y.segment<3>(3 * n + 3 * s.b) - y.segment<3>(3 * n + 3 * s.a);
+        double l = d.norm();
+        if (l == 0.0) { m_forces[e].setZero(); continue; }
+        Vector3d u = d / l;
+        double relative = u.dot(y.segment<3>(3 * s.b) - y.segment<3>(3 * s.a));
+        m_forces[e] = (s.stiffness * (l - s.length) + s.damping * relative) * u;
+    }
+}
+
+void Cloth::gatherForces(int chunk, const StateType &y, StateType &dy) const
+{
+    int n = particleCount();
+    const int *incident = &m_incident[0];
+    for (int i = m_nodeChunks[chunk]; i < m_nodeChunks[chunk + 1]; ++i)
+    {
+        dy.segment<3>(3 * n + 3 * i) = y.segment<3>(3 * i);
+        if (m_pinned[i]) { dy.segment<3>(3 * i).setZero(); continue; }
+
+        Vector3d f = m_masses[i] * m_gravity;
+        for (int k = m_incidentStart[i]; k < m_incidentStart[i + 1]; k += 2) {
+            int e = incident[k];
+            if (m_springs[e].a == i) f += m_forces[e];
+            else                     f -= m_forces[e];
+        }
+        dy.segment<3>(3 * i) = f / m_masses[i];
+    }
+}
+
+// --------------------------------------------------------------------------
+
+ClothIntegrator::ClothIntegrator(Cloth *cloth, double dt, WorkStealingPool *pool)
+    : Integrator<StateType>(cloth, dt), m_cloth(cloth), m_pool(pool),
+      m_tolerance(1e-3), m_maxIterations(100), m_lastIterations(0), m_totalIterations(0),
+      m_phase(SpringPhase), m_alpha(0.0), m_beta(0.0)
+{
+    m_task = [this](int chunk) { runChunk(chunk); };
+}
+
+void ClothIntegrator::bind(Cloth *cloth)
+{
+    Integrator<StateType>::bind(cloth);
+    m_cloth = cloth;
+    m_springChunks.clear();
+}
+
+void ClothIntegrator::setThreadPool(WorkStealingPool *pool)
+{
+    m_pool = pool;
+    m_springChunks.clear();
+}
+
+// The chunks hold a fixed number of particles, with or without a pool, so
+// that the dot products are summed in the same order and come out the same
+// on any number of threads.  A 100x100 sheet gives 40 chunks, enough for
+// the pool to even out uneven ones.
+void ClothIntegrator::partition()
+{
+    int n = m_cloth->particleCount(), springs = m_cloth->springCount();
+    int chunks = max(1, (n + k_chunkParticles - 1) / k_chunkParticles);
+
+    m_springChunks.resize(chunks + 1);
+    m_nodeChunks.resize(chunks + 1);
+    for (int c = 0; c <= chunks; ++c) {
+        m_springChunks[c] = int((long long)springs * c / chunks);
+        m_nodeChunks[c] = int((long long)n * c / chunks);
+    }
+    m_partial.assign(chunks, 0.0);
+
+    m_blocks.resize(springs);
+    m_incidentBlocks.resize(m_cloth->incidentStart(n) / 2);
+    m_loads.resize(springs);
+    m_preconditioner.resize(n);
+    m_rhs.resize(n);
+    m_deltaV.assign(n, Vector3d::Zero());
+    m_residual.resize(n);
+    m_search.resize(n);
+    m_product.resize(n);
+    m_precond.resize(n);
+}
+
+void ClothIntegrator::parallel(Phase phase)
+{
+    m_phase = phase;
+    int chunks = int(m_partial.size());
+    if (m_pool) m_pool->run(chunks, m_task);
+    else        for (int c = 0; c < chunks; ++c) runChunk(c);
+}
+
+double ClothIntegrator::sum(const vector<double> &partial) const
+{
+    double total = 0.0;
+    for (size_t c = 0; c < partial.size(); ++c) total += partial[c];
+    return total;
+}
+
+// (A x)_i = m_i x_i + sum over i's springs of B_e (x_i - x_other)
+Vector3d ClothIntegrator::product(int i, const vector<Vector3d> &x) const
+{
+    const int *incident = m_cloth->incident();
+    const Vector3d &xi = x[i];
+    double m = m_cloth->mass(i);
+    double y0 = m * xi[0], y1 = m * xi[1], y2 = m * xi[2];
+    for (int k = m_cloth->incidentStart(i); k < m_cloth->incidentStart(i + 1); k += 2)
+    {
+        const SymmetricBlock &B = m_incidentBlocks[k / 2];
+        const Vector3d &xj = x[incident[k + 1]];
+        double d0 = xi[0] - xj[0], d1 = xi[1] - xj[1], d2 = xi[2] - xj[2];
+        y0 += B.xx * d0 + B.xy * d1 + B.xz * d2;
+        y1 += B.xy * d0 + B.yy * d1 + B.yz * d2;
+        y2 += B.xz * d0 + B.yz * d1 + B.zz * d2;
+    }
+    return Vector3d(y0, y1, y2);
+}
+
+void ClothIntegrator::runChunk(int chunk)
+{
+    const Cloth &cloth = *m_cloth;
+    const StateType &y = m_state;
+    double dt = m_timeStep;
+    int n = cloth.particleCount();
+    const int *incident = cloth.incident();
+
+    if (m_phase == SpringPhase)
+    {
+        for (int e = m_springChunks[chunk]; e < m_springChunks[chunk + 1]; ++e)
+        {
+            const ClothSpring &s = cloth.spring(e);
+            Vector3d d = y.segment<3>(3 * n + 3 * s.b) - y.segment<3>(3 * n + 3 * s.a);
+            Vector3d dv = y.segment<3>(3 * s.b) - y.segment<3>(3 * s.a);
+            double l = d.norm();
+            if (l == 0.0) {
+                SymmetricBlock zero = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+                m_blocks[e] = zero;
+                m_loads[e].setZero();
+                continue;
+            }
+            Vector3d u = d / l;
+            Matrix3d uu = u * u.transpose();
+
+            // df_a/dx_b; the transverse part is dropped under compression,
+            // where it would make the system indefinite
+            double transverse = max(0.0, 1.0 - s.length / l);
+            Matrix3d K = s.stiffness * (transverse * (Matrix3d::Identity() - uu) + uu);
+
+            Vector3d f = (s.stiffness * (l - s.length) + s.damping * u.dot(dv)) * u;
+            Matrix3d B = dt * s.damping * uu + dt * dt * K;
+            SymmetricBlock block = { B(0, 0), B(0, 1), B(0, 2), B(1, 1), B(1, 2), B(2, 2) };
+            m_blocks[e] = block;
+            m_loads[e] = f + dt * (K * dv);
+        }
+        return;
+    }
+
+    int first = m_nodeChunks[chunk], last = m_nodeChunks[chunk + 1];
+    double partial = 0.0;
+
+    switch (m_phase)
+    {
+    case NodePhase:
+        // the right hand side, the preconditioner, and the starting guess:
+        // the pinned particles' exact velocity change, the last step's
+        // elsewhere
+        for (int i = first; i < last; ++i)
+        {
+            double m = cloth.mass(i);
+            Vector3d b = m * cloth.gravity();
+            Matrix3d D = m * Matrix3d::Identity();
+            for (int k = cloth.incidentStart(i); k < cloth.incidentStart(i + 1); k += 2) {
+                int e = incident[k];
+                b += cloth.spring(e).a == i ? m_loads[e] : Vector3d(-m_loads[e]);
+                const SymmetricBlock &B = m_incidentBlocks[k / 2] = m_blocks[e];
+                D(0, 0) += B.xx;    D(0, 1) += B.xy;    D(0, 2) += B.xz;
+                D(1, 1) += B.yy;    D(1, 2) += B.yz;    D(2, 2) += B.zz;
+            }
+            D(1, 0) = D(0, 1);  D(2, 0) = D(0, 2);  D(2, 1) = D(1, 2);
+            m_rhs[i] = dt * b;
+            m_preconditioner[i] = D.inverse();
+
+            if (cloth.isPinned(i)) {
+                Vector3d x = y.segment<3>(3 * n + 3 * i), v = y.segment<3>(3 * i);
+                m_deltaV[i] = (cloth.pinTarget(i) - x) / dt - v;
+            } else {
+                partial += m_rhs[i].dot(m_preconditioner[i] * m_rhs[i]);
+            }
+        }
+        break;
+
+    case ResidualPhase:
+        for (int i = first; i < last; ++i)
+        {
+            if (cloth.isPinned(i)) {
+                m_residual[i].setZero();
+                m_precond[i].setZero();
+            } else {
+                m_residual[i] = m_rhs[i] - product(i, m_deltaV);
+                m_precond[i] = m_preconditioner[i] * m_residual[i];
+            }
+            m_search[i] = m_precond[i];
+            partial += m_residual[i].dot(m_precond[i]);
+        }
+        break;
+
+    case ProductPhase:
+        for (int i = first; i < last; ++i)
+        {
+            if (cloth.isPinned(i)) m_product[i].setZero();
+            else                   m_product[i] = product(i, m_search);
+            partial += m_search[i].dot(m_product[i]);
+        }
+        break;
+
+    case UpdatePhase:
+        for (int i = first; i < last; ++i)
+        {
+            m_deltaV[i] += m_alpha * m_search[i];
+            m_residual[i] -= m_alpha * m_product[i];
+            m_precond[i] = m_preconditioner[i] * m_residual[i];
+            partial += m_residual[i].dot(m_precond[i]);
+        }
+        break;
+
+    case DirectionPhase:
+        // A (s + beta c) = A s + beta A c, so the next product needs no
+        // separate pass over the new search direction
+        for (int i = first; i < last; ++i)
+        {
+            if (cloth.isPinned(i)) {
+                m_search[i].setZero();
+                m_product[i].setZero();
+            } else {
+                m_search[i] = m_precond[i] + m_beta * m_search[i];
+                m_product[i] = product(i, m_precond) + m_beta * m_product[i];
+            }
+            partial += m_search[i].dot(m_product[i]);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    m_partial[chunk] = partial;
+}
+
+void ClothIntegrator::step()
+{
+    INTEGRATOR_TIME(stepSeconds);
+    INTEGRATOR_COUNT(steps, 1);
+    INTEGRATOR_COUNT(evaluations, 1);
+
+    if (m_springChunks.empty() || int(m_deltaV.size()) != m_cloth->particleCount())
+        partition();
+
+    parallel(SpringPhase);
+    parallel(NodePhase);
+    double target = m_tolerance * m_tolerance * sum(m_partial);
+
+    // the last velocity change is usually a good first guess, but after a
+    // sudden change it can be worse than none, and a truncated iteration
+    // started from it can then gain energy
+    parallel(ResidualPhase);
+    double delta = sum(m_partial);
+    if (delta > target / (m_tolerance * m_tolerance))
+    {
+        int n = m_cloth->particleCount();
+        for (int i = 0; i < n; ++i)
+            if (!m_cloth->isPinned(i)) m_deltaV[i].setZero();
+        parallel(ResidualPhase);
+        delta = sum(m_partial);
+    }
+    int iterations = 0;
+    if (delta > target)
+    {
+        parallel(ProductPhase);
+        while (iterations < m_maxIterations)
+        {
+            ++iterations;
+            double curvature = sum(m_partial);
+            if (curvature <= 0.0) break;
+            m_alpha = delta / curvature;
+            parallel(UpdatePhase);
+
+            double next = sum(m_partial);
+            if (next <= target) break;
+            m_beta = next / delta;
+            delta = next;
+            parallel(DirectionPhase);
+        }
+    }
+    m_lastIterations = iterations;
+    m_totalIterations += iterations;
+    INTEGRATOR_COUNT(solves, 1);
+
+    // the pinned particles land exactly on their targets
+    int n = m_cloth->particleCount();
+    double dt = m_timeStep;
+    for (int i = 0; i < n; ++i) {
+        m_state.segment<3>(3 * i) += m_deltaV[i];
+        m_state.segment<3>(3 * n + 3 * i) += dt * m_state.segment<3>(3 * i);
+    }
+    m_time += dt;
+}
+
+// --------------------------------------------------------------------------
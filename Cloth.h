@@ -0,0 +1,206 @@
+#ifndef CLOTH_H
+#define CLOTH_H
+
+#include <vector>
+
+#include "Eigen/Core"
+#include "Integrators.h"
+#include "WorkStealingPool.h"
+
+// --------------------------------------------------------------------------
+
+// A sheet of particles in 3-D joined by nonlinear springs, which pull
+// along their current direction in proportion to their stretch, with
+// dampers along the same line.  The state holds the velocities first, then
+// the positions, three components per particle: y = [v; x].
+//
+// Any particle can be pinned, either where it is or to a target position
+// that can move from step to step.  The explicit integrators see pinned
+// particles as having no acceleration; ClothIntegrator moves them onto
+// their targets exactly.
+//
+// The derivative can be evaluated on a thread pool: each spring's force is
+// found in parallel, then each particle gathers the forces of its own
+// springs, so no two threads add into the same particle and the result
+// does not depend on the number of threads.
+
+struct ClothSpring
+{
+    int     a, b;
+    double  stiffness;
+    double  damping;
+    double  length;         // at rest
+};
+
+class Cloth : public OrdinaryDifferentialEquation<Eigen::VectorXd>
+{
+public:
+    typedef Eigen::VectorXd StateType;
+
+private:
+    std::vector<double>             m_masses;
+    std::vector<Eigen::Vector3d>    m_positions;    // initial
+    std::vector<ClothSpring>        m_springs;
+    std::vector<char>               m_pinned;
+    std::vector<Eigen::Vector3d>    m_targets;      // of the pinned particles
+    Eigen::Vector3d                 m_gravity;
+
+    // the springs at each particle, as (spring, other particle) pairs
+    std::vector<int>    m_incidentStart;
+    std::vector<int>    m_incident;
+    bool                m_assembled;
+
+    // the threaded evaluation: chunks of springs and particles, and each
+    // spring's force between the two passes
+    WorkStealingPool                       *m_pool;
+    std::vector<int>                        m_springChunks, m_nodeChunks;
+    mutable std::vector<Eigen::Vector3d>    m_forces;
+
+    void partition();
+    void springForces(int chunk, const StateType &y) const;
+    void gatherForces(int chunk, const StateType &y, StateType &dy) const;
+
+public:
+    Cloth();
+
+    void clear();
+
+    int addParticle(double mass, const Eigen::Vector3d &position);
+    int addSpring(int a, int b, double stiffness, double damping);
+
+    // A width by height grid of particles in the horizontal plane, spacing
+    // apart, with structural springs to the neighbours along each row and
+    // column, shear springs across the diagonals and bending springs to the
+    // particles two along.  The stiffnesses are per spring.
+    void createSheet(int width, int height, double spacing = 0.01, double mass = 1e-4,
+                     double stretch = 500.0, double shear = 50.0, double bend = 5.0,
+                     double damping = 0.01);
+
+    // Builds each particle's list of springs; must be called after adding
+    // any particles or springs, before the cloth is integrated.
+    void assemble();
+    bool isAssembled() const                        { return m_assembled; }
+
+    // holds the particle at its initial position, or moves it to target
+    void pin(int i);
+    void pin(int i, const Eigen::Vector3d &target);
+    void unpin(int i);
+    bool isPinned(int i) const                      { return m_pinned[i] != 0; }
+    const Eigen::Vector3d &pinTarget(int i) const   { return m_targets[i]; }
+
+    void setGravity(const Eigen::Vector3d &g)       { m_gravity = g; }
+    const Eigen::Vector3d &gravity() const          { return m_gravity; }
+
+    int particleCount() const                       { return int(m_masses.size()); }
+    int springCount() const                         { return int(m_springs.size()); }
+    double mass(int i) const                        { return m_masses[i]; }
+    const ClothSpring &spring(int e) const          { return m_springs[e]; }
+
+    // for particle i, entries [incidentStart(i), incidentStart(i + 1)) of
+    // incident() are pairs of a spring and the particle at its other end
+    int incidentStart(int i) const                  { return m_incidentStart[i]; }
+    const int *incident() const                     { return &m_incident[0]; }
+
+    // Evaluates the derivative on the pool's threads, or on the calling
+    // thread if pool is null (the default).  With a pool, the cloth must be
+    // assembled, and only one evaluation may run at a time.
+    void setThreadPool(WorkStealingPool *pool);
+    WorkStealingPool *threadPool() const            { return m_pool; }
+
+    // all particles at rest at their initial positions
+    StateType initialState() const;
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void derivative(double t, const StateType &y, StateType &dy) const;
+};
+
+// --------------------------------------------------------------------------
+
+// The implicit step of Baraff and Witkin, "Large steps in cloth
+// simulation": the forces are linearized about the current state, and
+//
+//      (M - dt df/dv - dt^2 df/dx) dv = dt (f + dt df/dx v)
+//
+// is solved for the velocity change by conjugate gradients, preconditioned
+// with the inverses of the 3x3 diagonal blocks.  The pinned particles'
+// velocity changes are fixed and filtered out of the iteration, and each
+// solve starts from the previous step's velocity change.
+//
+// The system is never assembled: each spring keeps its 3x3 block, and each
+// particle gathers from its springs, so the work divides among the threads
+// of an optional pool without any two writing the same particle.
+
+class ClothIntegrator : public Integrator<Eigen::VectorXd>
+{
+public:
+    typedef Eigen::VectorXd StateType;
+
+private:
+    enum Phase { SpringPhase, NodePhase, ResidualPhase, ProductPhase, UpdatePhase,
+                 DirectionPhase };
+
+    Cloth              *m_cloth;
+    WorkStealingPool   *m_pool;
+    double              m_tolerance;
+    int                 m_maxIterations;
+    int                 m_lastIterations;
+    long long           m_totalIterations;
+
+    // the six distinct entries of a symmetric 3x3 block
+    struct SymmetricBlock { double xx, xy, xz, yy, yz, zz; };
+
+    // per spring: dt c uu' + dt^2 df/dx, and f + dt df/dx (v_b - v_a)
+    std::vector<SymmetricBlock>     m_blocks;
+    std::vector<Eigen::Vector3d>    m_loads;
+
+    // the blocks again in the order of the particles' spring lists, so
+    // that the products read them in sequence
+    std::vector<SymmetricBlock>     m_incidentBlocks;
+
+    // per particle
+    std::vector<Eigen::Matrix3d>    m_preconditioner;
+    std::vector<Eigen::Vector3d>    m_rhs, m_deltaV, m_residual, m_search, m_product,
+                                    m_precond;
+
+    // the chunks the phases divide the springs and particles into, and
+    // each chunk's share of the phase's dot products
+    std::vector<int>    m_springChunks, m_nodeChunks;
+    std::vector<double> m_partial;
+
+    Phase                   m_phase;
+    double                  m_alpha, m_beta;
+    WorkStealingPool::Task  m_task;
+
+    void partition();
+    void parallel(Phase phase);
+    void runChunk(int chunk);
+    double sum(const std::vector<double> &partial) const;
+
+    Eigen::Vector3d product(int i, const std::vector<Eigen::Vector3d> &x) const;
+
+public:
+    ClothIntegrator(Cloth *cloth, double dt, WorkStealingPool *pool = 0);
+
+    void bind(Cloth *cloth);
+
+    // spreads the work over the pool's threads, or runs on the calling
+    // thread if pool is null
+    void setThreadPool(WorkStealingPool *pool);
+
+    // The iteration stops when the preconditioned residual norm falls
+    // below tolerance times that of the right hand side (1e-3 by default),
+    // or after the given number of iterations (100).  A real-time budget
+    // of about 20 iterations keeps a 100x100 sheet stable, but the stiff
+    // springs then give more than they should and the sheet sags further.
+    void setTolerance(double tolerance)     { m_tolerance = tolerance; }
+    void setMaxIterations(int iterations)   { m_maxIterations = iterations; }
+
+    int lastIterations() const              { return m_lastIterations; }
+    long long totalIterations() const       { return m_totalIterations; }
+
+    virtual void step();
+};
+
+// --------------------------------------------------------------------------
+
+#endif // CLOTH_H
@@ -0,0 +1,74 @@
+#include "DampedOscillator.h"
+#include <cmath>
+
+// --------------------------------------------------------------------------
+
+DampedOscillator::DampedOscillator(double m, double k, double b, double g, double x0, double v0)
+{
+    m_equilibrium = m * g / k;
+    m_decay = b / (2.0 * m);
+
+    // the displacement from equilibrium, u = x - mg/k, obeys the homogeneous
+    // equation, whose character depends on the sign of the discriminant
+    double u0 = x0 - m_equilibrium;
+    double w0squared = k / m;
+    double discriminant = m_decay * m_decay - w0squared;
+
+    if (std::abs(discriminant) <= 1e-12 * w0squared)
+    {
+        // u = (c1 + c2 t) e^(-decay t)
+        m_regime = CriticallyDamped;
+        m_frequency = 0.0;
+        m_c1 = u0;
+        m_c2 = v0 + m_decay * u0;
+    }
+    else if (discriminant < 0.0)
+    {
+        // u = e^(-decay t) (c1 cos wt + c2 sin wt)
+        m_regime = Underdamped;
+        m_frequency = std::sqrt(-discriminant);
+        m_c1 = u0;
+        m_c2 = (v0 + m_decay * u0) / m_frequency;
+    }
+    else
+    {
+        // u = c1 e^(r1 t) + c2 e^(r2 t), with r = -decay +/- spread
+        m_regime = Overdamped;
+        m_frequency = std::sqrt(discriminant);
+        double r1 = -m_decay + m_frequency, r2 = -m_decay - m_frequency;
+        m_c1 = (v0 - r2 * u0) / (r1 - r2);
+        m_c2 = u0 - m_c1;
+    }
+}
+
+Eigen::Vector2d DampedOscillator::state(double t) const
+{
+    double u, v;
+    double a = m_decay, w = m_frequency;
+
+    switch (m_regime) {
+    case CriticallyDamped: {
+        double e = std::exp(-a * t);
+        u = (m_c1 + m_c2 * t) * e;
+        v = (m_c2 - a * (m_c1 + m_c2 * t)) * e;
+        break;
+    }
+    case Underdamped: {
+        double e = std::exp(-a * t), c = std::cos(w * t), s = std::sin(w * t);
+        u = e * (m_c1 * c + m_c2 * s);
+        v = e * ((m_c2 * w - a * m_c1) * c - (m_c1 * w + a * m_c2) * s);
+        break;
+    }
+    default: {
+        double r1 = -a + w, r2 = -a - w;
+        double e1 = std::exp(r1 * t), e2 = std::exp(r2 * t);
+        u = m_c1 * e1 + m_c2 * e2;
+        v = m_c1 * r1 * e1 + m_c2 * r2 * e2;
+        break;
+    }
+    }
+
+    return Eigen::Vector2d(v, u + m_equilibrium);
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,43 @@
+#ifndef DAMPEDOSCILLATOR_H
+#define DAMPEDOSCILLATOR_H
+
+#include "Eigen/Core"
+
+// --------------------------------------------------------------------------
+
+// Closed-form solution of the motion SimpleSpring integrates numerically,
+//
+//      m x'' + b x' + k x = m g,
+//
+// i.e. a damped oscillator about the equilibrium x = mg/k.  States are
+// returned in the same [v; x] order as SimpleSpring uses.
+
+class DampedOscillator
+{
+public:
+    enum Regime
+    {
+        Underdamped,
+        CriticallyDamped,
+        Overdamped
+    };
+
+private:
+    double  m_equilibrium;
+    double  m_decay;            // b / 2m
+    double  m_frequency;        // damped frequency, or the root spread if overdamped
+    double  m_c1, m_c2;         // coefficients fitted to the initial state
+    Regime  m_regime;
+
+public:
+    DampedOscillator(double m, double k, double b, double g, double x0, double v0 = 0.0);
+
+    Regime regime() const       { return m_regime; }
+    double equilibrium() const  { return m_equilibrium; }
+
+    Eigen::Vector2d state(double t) const;
+};
+
+// --------------------------------------------------------------------------
+
+#endif // DAMPEDOSCILLATOR_H
@@ -0,0 +1,554 @@
+#include "DistributedNetwork.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+DistributedNetwork::DistributedNetwork(const SpringNetwork &network, int ranks)
+    : m_method(ExplicitEuler), m_tolerance(1e-10), m_maxIterations(1000),
+      m_lastSeconds(0.0), m_lastIterations(0)
+{
+    const SpringNetwork::MatrixType &A = network.matrixA();
+    const int *rows = A._outerIndexPtr();
+    int n = network.nodeCount();
+    ranks = max(1, min(ranks, n));
+
+    // cut where the running count of entries passes each rank's share
+    vector<int> cuts(1, 0);
+    long long total = rows[n];
+    for (int r = 1, i = 0; r < ranks; ++r) {
+        while (i < n && (long long)rows[i] * ranks < total * r) ++i;
+        cuts.push_back(min(max(i, cuts.back() + 1), n - (ranks - r)));
+    }
+    cuts.push_back(n);
+
+    m_subdomains.resize(ranks);
+    vector<int> local(n, -1);
+    for (int r = 0; r < ranks; ++r)
+    {
+        Subdomain &s = m_subdomains[r];
+        s.first = cuts[r];
+        s.last = cuts[r + 1];
+
+        for (int i = s.first; i < s.last; ++i)
+            for (SpringNetwork::MatrixType::InnerIterator it(A, i); it; ++it) {
+                int g = it.col() % n;
+                if (g < s.first || g >= s.last) s.halo.push_back(g);
+            }
+        sort(s.halo.begin(), s.halo.end());
+        s.halo.erase(unique(s.halo.begin(), s.halo.end()), s.halo.end());
+
+        for (int i = s.first; i < s.last; ++i) local[i] = i - s.first;
+        for (size_t k = 0; k < s.halo.size(); ++k) local[s.halo[k]] = s.size() + int(k);
+
+        s.velocityStart.assign(1, 0);
+        s.positionStart.assign(1, 0);
+        for (int i = s.first; i < s.last; ++i)
+        {
+            for (SpringNetwork::MatrixType::InnerIterator it(A, i); it; ++it)
+                if (it.col() < n) {
+                    s.velocityColumns.push_back(local[it.col()]);
+                    s.velocityValues.push_back(it.value());
+                }
+                else {
+                    s.positionColumns.push_back(local[it.col() - n]);
+                    s.positionValues.push_back(it.value());
+                }
+            s.velocityStart.push_back(int(s.velocityColumns.size()));
+            s.positionStart.push_back(int(s.positionColumns.size()));
+            s.b.push_back(network.vectorB()[i]);
+            s.masses.push_back(network.mass(network.nodeOfRow(i)));
+        }
+
+        for (int i = s.first; i < s.last; ++i) local[i] = -1;
+        for (size_t k = 0; k < s.halo.size(); ++k) local[s.halo[k]] = -1;
+    }
+
+    // what each rank must publish for the others
+    for (int r = 0; r < ranks; ++r)
+        for (size_t k = 0; k < m_subdomains[r].halo.size(); ++k) {
+            int g = m_subdomains[r].halo[k];
+            int owner = int(upper_bound(cuts.begin(), cuts.end() - 1, g) - cuts.begin()) - 1;
+            m_subdomains[owner].boundary.push_back(g);
+        }
+    for (int r = 0; r < ranks; ++r) {
+        vector<int> &boundary = m_subdomains[r].boundary;
+        sort(boundary.begin(), boundary.end());
+        boundary.erase(unique(boundary.begin(), boundary.end()), boundary.end());
+    }
+}
+
+int DistributedNetwork::haloSize() const
+{
+    int total = 0;
+    for (size_t r = 0; r < m_subdomains.size(); ++r) total += int(m_subdomains[r].halo.size());
+    return total;
+}
+
+// --------------------------------------------------------------------------
+
+#if defined(__linux__)
+
+namespace {
+
+// the header of the memory the ranks share; the mailboxes, the partial
+// sums and the result follow it
+struct Shared
+{
+    atomic<int>         arrived;        // at the barrier this round
+    atomic<int>         generation;     // rounds of the barrier passed
+    double              seconds;
+    long long           iterations;
+};
+
+static_assert(sizeof(atomic<int>) == sizeof(int), "futexes need plain ints");
+
+const int k_maxSums = 3;
+
+// barrier waits spin this many times before sleeping, and sleep this long
+// at a time before looking for failed ranks
+const int  k_spins = 2000;
+const long k_pollNanoseconds = 10000000;
+
+int futex(atomic<int> *address, int operation, int value, const timespec *timeout)
+{
+    return int(syscall(SYS_futex, reinterpret_cast<int *>(address), operation, value, timeout,
+                       0, 0));
+}
+
+// thrown out of a barrier when another rank has failed
+struct RankFailed {};
+
+// The other ranks' processes, as seen by rank 0, which looks for any that
+// have died whenever it is kept waiting at a barrier.
+class Children
+{
+    vector<pid_t>  m_pids;
+    vector<char>   m_exited;
+
+public:
+    string         failure;
+
+    void add(pid_t pid)     { m_pids.push_back(pid); m_exited.push_back(0); }
+
+    // reaps the ranks that have exited, waiting for them all if block is
+    // set; false once one has failed
+    bool check(bool block)
+    {
+        for (size_t c = 0; c < m_pids.size(); ++c)
+        {
+            if (m_exited[c]) continue;
+            int status = 0;
+            pid_t pid = waitpid(m_pids[c], &status, block ? 0 : WNOHANG);
+            if (pid == 0) continue;
+            m_exited[c] = 1;
+
+            char text[64];
+            text[0] = 0;
+            if (pid < 0) snprintf(text, sizeof(text), "rank %d was lost", int(c) + 1);
+            else if (WIFSIGNALED(status))
+                snprintf(text, sizeof(text), "rank %d was killed by signal %d", int(c) + 1,
+                         WTERMSIG(status));
+            else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                snprintf(text, sizeof(text), "rank %d failed", int(c) + 1);
+            if (text[0] && failure.empty()) failure = text;
+        }
+        return failure.empty();
+    }
+
+    void killAll()
+    {
+        for (size_t c = 0; c < m_pids.size(); ++c)
+            if (!m_exited[c]) kill(m_pids[c], SIGKILL);
+    }
+};
+
+// One rank's side of a run.  The mailboxes and partial sums are double
+// buffered, so that a rank can write the next round while a slower one is
+// still reading the last: by the time a buffer comes round again, every
+// rank has passed a barrier after reading it.
+class Rank
+{
+    const DistributedNetwork::Subdomain &m_s;
+    Shared     *m_shared;
+    Children   *m_children;     // for rank 0
+    double     *m_mailbox[2];
+    double     *m_partial[2];
+    double     *m_result;
+    int         m_rank, m_ranks, m_n;
+    int         m_mailboxParity, m_partialParity;
+
+public:
+    Rank(const DistributedNetwork::Subdomain &s, void *memory, int rank, int ranks, int n,
+         Children *children)
+        : m_s(s), m_shared(static_cast<Shared *>(memory)), m_children(children), m_rank(rank),
+          m_ranks(ranks), m_n(n), m_mailboxParity(0), m_partialParity(0)
+    {
+        double *data = reinterpret_cast<double *>(static_cast<char *>(memory)
+                                                  + (sizeof(Shared) + 63) / 64 * 64);
+        m_mailbox[0] = data;
+        m_mailbox[1] = data + 2 * n;
+        m_partial[0] = data + 4 * n;
+        m_partial[1] = data + 4 * n + k_maxSums * ranks;
+        m_result = data + 4 * n + 2 * k_maxSums * ranks;
+    }
+
+    double *result()    { return m_result; }
+
+    // Returns once every rank has arrived.  Rank 0 throws RankFailed if
+    // another rank dies first, rather than wait for it forever; the others
+    // are killed along with rank 0's process.
+    void wait()
+    {
+        int generation = m_shared->generation.load(memory_order_acquire);
+        if (m_shared->arrived.fetch_add(1, memory_order_acq_rel) + 1 == m_ranks) {
+            m_shared->arrived.store(0, memory_order_relaxed);
+            m_shared->generation.store(generation + 1, memory_order_release);
+            futex(&m_shared->generation, FUTEX_WAKE, INT_MAX, 0);
+            return;
+        }
+
+        for (int spin = 0; spin < k_spins; ++spin)
+            if (m_shared->generation.load(memory_order_acquire) != generation) return;
+        for (;;) {
+            timespec timeout = { 0, k_pollNanoseconds };
+            futex(&m_shared->generation, FUTEX_WAIT, generation, &timeout);
+            if (m_shared->generation.load(memory_order_acquire) != generation) return;
+            if (m_children && !m_children->check(false)) throw RankFailed();
+        }
+    }
+
+    // publishes the boundary rows of v and x (either may be null) and
+    // reads the halo rows into the entries after the owned ones
+    void exchange(double *v, double *x)
+    {
+        double *box = m_mailbox[m_mailboxParity];
+        m_mailboxParity ^= 1;
+        int first = m_s.first, size = m_s.size();
+        for (size_t k = 0; k < m_s.boundary.size(); ++k) {
+            int g = m_s.boundary[k];
+            if (v) box[g] = v[g - first];
+            if (x) box[m_n + g] = x[g - first];
+        }
+        wait();
+        for (size_t k = 0; k < m_s.halo.size(); ++k) {
+            int g = m_s.halo[k];
+            if (v) v[size + k] = box[g];
+            if (x) x[size + k] = box[m_n + g];
+        }
+    }
+
+    // sums each of the values over all ranks, in rank order so that every
+    // rank gets the same totals
+    void sum(double *values, int count)
+    {
+        double *partial = m_partial[m_partialParity];
+        m_partialParity ^= 1;
+        for (int j = 0; j < count; ++j) partial[m_rank * k_maxSums + j] = values[j];
+        wait();
+        for (int j = 0; j < count; ++j) {
+            values[j] = 0.0;
+            for (int r = 0; r < m_ranks; ++r) values[j] += partial[r * k_maxSums + j];
+        }
+    }
+
+    // the owned rows' accelerations, summed in the same order as
+    // SpringNetwork::derivative()
+    void accelerations(const double *v, const double *x, double *dv) const
+    {
+        for (int i = 0; i < m_s.size(); ++i) {
+            double sum = m_s.b[i];
+            for (int k = m_s.velocityStart[i]; k < m_s.velocityStart[i + 1]; ++k)
+                sum += m_s.velocityValues[k] * v[m_s.velocityColumns[k]];
+            for (int k = m_s.positionStart[i]; k < m_s.positionStart[i + 1]; ++k)
+                sum += m_s.positionValues[k] * x[m_s.positionColumns[k]];
+            dv[i] = sum;
+        }
+    }
+};
+
+void explicitEuler(Rank &rank, const DistributedNetwork::Subdomain &s, vector<double> &v,
+                   vector<double> &x, double dt, int steps)
+{
+    int size = s.size();
+    vector<double> dv(size);
+    for (int step = 0; step < steps; ++step)
+    {
+        rank.exchange(&v[0], &x[0]);
+        rank.accelerations(&v[0], &x[0], &dv[0]);
+        for (int i = 0; i < size; ++i) {
+            x[i] += dt * v[i];
+            v[i] += dt * dv[i];
+        }
+    }
+}
+
+// the stages of RungeKutta4Integrator, row by row
+void rungeKutta4(Rank &rank, const DistributedNetwork::Subdomain &s, vector<double> &v,
+                 vector<double> &x, double dt, int steps)
+{
+    int size = s.size();
+    vector<double> sv(v.size()), sx(x.size());
+    vector<double> kv[4], kx[4];
+    for (int j = 0; j < 4; ++j) { kv[j].resize(size);  kx[j].resize(size); }
+    const double scale[3] = { 0.5 * dt, 0.5 * dt, dt };
+
+    for (int step = 0; step < steps; ++step)
+    {
+        rank.exchange(&v[0], &x[0]);
+        rank.accelerations(&v[0], &x[0], &kv[0][0]);
+        copy(v.begin(), v.begin() + size, kx[0].begin());
+
+        for (int j = 1; j < 4; ++j)
+        {
+            for (int i = 0; i < size; ++i) {
+                sv[i] = v[i] + scale[j - 1] * kv[j - 1][i];
+                sx[i] = x[i] + scale[j - 1] * kx[j - 1][i];
+            }
+            rank.exchange(&sv[0], &sx[0]);
+            rank.accelerations(&sv[0], &sx[0], &kv[j][0]);
+            copy(sv.begin(), sv.begin() + size, kx[j].begin());
+        }
+
+        for (int i = 0; i < size; ++i) {
+            v[i] += dt / 6.0 * (kv[0][i] + 2.0 * kv[1][i] + 2.0 * kv[2][i] + kv[3][i]);
+            x[i] += dt / 6.0 * (kx[0][i] + 2.0 * kx[1][i] + 2.0 * kx[2][i] + kx[3][i]);
+        }
+    }
+}
+
+// returns the conjugate gradient iterations over all steps
+long long implicitEuler(Rank &rank, const DistributedNetwork::Subdomain &s, vector<double> &v,
+                        vector<double> &x, double dt, int steps, double tolerance,
+                        int maxIterations)
+{
+    int size = s.size(), localSize = s.localSize();
+
+    // M (I - dt Avv - dt^2 Avx) for the owned rows
+    vector<int> start(1, 0), columns;
+    vector<double> values, inverseDiagonal(size), row(localSize, 0.0);
+    vector<int> used;
+    for (int i = 0; i < size; ++i)
+    {
+        double m = s.masses[i];
+        used.assign(1, i);
+        row[i] = m;
+        for (int k = s.velocityStart[i]; k < s.velocityStart[i + 1]; ++k) {
+            int c = s.velocityColumns[k];
+            if (row[c] == 0.0 && c != i) used.push_back(c);
+            row[c] -= dt * m * s.velocityValues[k];
+        }
+        for (int k = s.positionStart[i]; k < s.positionStart[i + 1]; ++k) {
+            int c = s.positionColumns[k];
+            if (row[c] == 0.0 && c != i) used.push_back(c);
+            row[c] -= dt * dt * m * s.positionValues[k];
+        }
+        sort(used.begin(), used.end());
+        used.erase(unique(used.begin(), used.end()), used.end());
+        for (size_t k = 0; k < used.size(); ++k) {
+            columns.push_back(used[k]);
+            values.push_back(row[used[k]]);
+            if (used[k] == i) inverseDiagonal[i] = 1.0 / row[i];
+            row[used[k]] = 0.0;
+        }
+        start.push_back(int(columns.size()));
+    }
+
+    vector<double> rhs(size), r(size), z(size), q(size), p(localSize), w(localSize);
+    long long iterations = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        // M v + dt M (Avx x + bv)
+        rank.exchange(0, &x[0]);
+        for (int i = 0; i < size; ++i) {
+            double sum = s.b[i];
+            for (int k = s.positionStart[i]; k < s.positionStart[i + 1]; ++k)
+                sum += s.positionValues[k] * x[s.positionColumns[k]];
+            rhs[i] = s.masses[i] * (v[i] + dt * sum);
+        }
+
+        // from the current velocities
+        copy(v.begin(), v.end(), w.begin());
+        rank.exchange(&w[0], 0);
+        double sums[k_maxSums] = { 0.0, 0.0, 0.0 };
+        for (int i = 0; i < size; ++i) {
+            double product = 0.0;
+            for (int k = start[i]; k < start[i + 1]; ++k) product += values[k] * w[columns[k]];
+            r[i] = rhs[i] - product;
+            z[i] = r[i] * inverseDiagonal[i];
+            p[i] = z[i];
+            sums[0] += r[i] * z[i];
+            sums[1] += r[i] * r[i];
+            sums[2] += rhs[i] * rhs[i];
+        }
+        rank.sum(sums, 3);
+        double delta = sums[0], residual = sums[1];
+        double target = tolerance * tolerance * sums[2];
+
+        for (int iteration = 0; iteration < maxIterations && residual > target; ++iteration)
+        {
+            ++iterations;
+            rank.exchange(&p[0], 0);
+            double curvature = 0.0;
+            for (int i = 0; i < size; ++i) {
+                double product = 0.0;
+                for (int k = start[i]; k < start[i + 1]; ++k) product += values[k] * p[columns[k]];
+                q[i] = product;
+                curvature += p[i] * product;
+            }
+            rank.sum(&curvature, 1);
+            if (curvature <= 0.0) break;
+            double alpha = delta / curvature;
+
+            sums[0] = sums[1] = 0.0;
+            for (int i = 0; i < size; ++i) {
+                w[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                z[i] = r[i] * inverseDiagonal[i];
+                sums[0] += r[i] * z[i];
+                sums[1] += r[i] * r[i];
+            }
+            rank.sum(sums, 2);
+            double beta = sums[0] / delta;
+            delta = sums[0];
+            residual = sums[1];
+            for (int i = 0; i < size; ++i) p[i] = z[i] + beta * p[i];
+        }
+
+        for (int i = 0; i < size; ++i) {
+            v[i] = w[i];
+            x[i] += dt * v[i];
+        }
+    }
+    return iterations;
+}
+
+}
+
+bool DistributedNetwork::run(StateType &y, double dt, int steps, string *error)
+{
+    int ranks = rankCount();
+    int n = int(y.size()) / 2;
+
+    size_t header = (sizeof(Shared) + 63) / 64 * 64;
+    size_t bytes = header + sizeof(double) * (6 * size_t(n) + 2 * k_maxSums * ranks);
+    void *memory = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        if (error) *error = string("mmap: ") + strerror(errno);
+        return false;
+    }
+    Shared *shared = static_cast<Shared *>(memory);
+    shared->arrived.store(0);
+    shared->generation.store(0);
+    shared->seconds = 0.0;
+    shared->iterations = 0;
+
+    // each rank runs its subdomain and leaves its rows in the result
+    Method method = m_method;
+    double tolerance = m_tolerance;
+    int maxIterations = m_maxIterations;
+    Children children;
+    auto work = [&](int r)
+    {
+        const Subdomain &s = m_subdomains[r];
+        Rank rank(s, memory, r, ranks, n, r == 0 ? &children : 0);
+        vector<double> v(s.localSize()), x(s.localSize());
+        for (int i = 0; i < s.size(); ++i) {
+            v[i] = y[s.first + i];
+            x[i] = y[n + s.first + i];
+        }
+
+        rank.wait();
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        long long iterations = 0;
+        switch (method) {
+        case ExplicitEuler: explicitEuler(rank, s, v, x, dt, steps);   break;
+        case RungeKutta4:   rungeKutta4(rank, s, v, x, dt, steps);     break;
+        case ImplicitEuler:
+            iterations = implicitEuler(rank, s, v, x, dt, steps, tolerance, maxIterations);
+            break;
+        }
+        rank.wait();
+
+        for (int i = 0; i < s.size(); ++i) {
+            rank.result()[s.first + i] = v[i];
+            rank.result()[n + s.first + i] = x[i];
+        }
+        if (r == 0) {
+            shared->seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            shared->iterations = iterations;
+        }
+    };
+
+    // the other ranks go down with this process, however it ends
+    pid_t parent = getpid();
+    for (int r = 1; r < ranks; ++r)
+    {
+        pid_t pid = fork();
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent) _exit(1);
+            work(r);
+            _exit(0);
+        }
+        if (pid < 0) {
+            if (error) *error = string("fork: ") + strerror(errno);
+            children.killAll();
+            children.check(true);
+            munmap(memory, bytes);
+            return false;
+        }
+        children.add(pid);
+    }
+
+    try {
+        work(0);
+    }
+    catch (const RankFailed &) {
+        children.killAll();
+    }
+    bool succeeded = children.check(true);
+    if (!succeeded && error) *error = children.failure;
+
+    if (succeeded) {
+        const double *result = reinterpret_cast<const double *>(static_cast<char *>(memory) + header)
+                               + 4 * n + 2 * k_maxSums * ranks;
+        y = Map<const VectorXd>(result, 2 * n);
+        m_lastSeconds = shared->seconds;
+        m_lastIterations = shared->iterations;
+    }
+
+    munmap(memory, bytes);
+    return succeeded;
+}
+
+#else
+
+bool DistributedNetwork::run(StateType &, double, int, string *error)
+{
+    if (error) *error = "distributed runs need POSIX processes and shared memory";
+    return false;
+}
+
+#endif
+
+// --------------------------------------------------------------------------
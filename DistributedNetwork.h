@@ -0,0 +1,104 @@
+#ifndef DISTRIBUTEDNETWORK_H
+#define DISTRIBUTEDNETWORK_H
+
+#include <string>
+#include <vector>
+
+#include "SpringNetwork.h"
+
+// --------------------------------------------------------------------------
+
+// Integrates a SpringNetwork split among several processes, each of which
+// owns a contiguous range of the network's rows (its subdomain) and keeps
+// its own copy of just those rows of A, its own state, and the halo of
+// states it reads from other ranks.  Before each derivative evaluation the
+// ranks publish their boundary states and read their halos, as they would
+// exchange messages under MPI; here the processes are forked on one host
+// and exchange through shared memory, synchronized by a barrier built on a
+// futex.  While kept waiting there the caller checks on the other ranks,
+// so one that dies ends the run with an error rather than a hang.
+// Numbering the network with SpringNetwork::BandwidthOrdering first keeps
+// the halos small.
+//
+// The explicit methods evaluate each row exactly as the serial integrators
+// do, so their results are identical.  Implicit Euler solves for the new
+// velocities, as MultigridImplicitEulerIntegrator does, scaled by the
+// masses to make the system symmetric,
+//
+//      (M + dt C + dt^2 K) v(t + dt) = M v + dt M (Avx x + bv),
+//
+// by Jacobi-preconditioned conjugate gradients with one halo exchange and
+// two global sums per iteration.
+//
+// The decomposition needs Linux processes, shared memory and futexes;
+// elsewhere, run() fails with an explanation.
+
+class DistributedNetwork
+{
+public:
+    typedef SpringNetwork::StateType StateType;
+
+    enum Method { ExplicitEuler, RungeKutta4, ImplicitEuler };
+
+    struct Subdomain
+    {
+        int                 first, last;    // the rows owned
+        std::vector<int>    halo;           // other ranks' rows read, ascending
+        std::vector<int>    boundary;       // rows owned that other ranks read
+
+        // the owned rows of A's velocity half, split into the velocity and
+        // position columns, numbered locally: the owned rows, then the halo
+        std::vector<int>    velocityStart, velocityColumns;
+        std::vector<double> velocityValues;
+        std::vector<int>    positionStart, positionColumns;
+        std::vector<double> positionValues;
+        std::vector<double> b;
+        std::vector<double> masses;
+
+        int size() const                { return last - first; }
+        int localSize() const           { return size() + int(halo.size()); }
+    };
+
+private:
+    std::vector<Subdomain>  m_subdomains;
+    Method                  m_method;
+    double                  m_tolerance;
+    int                     m_maxIterations;
+    double                  m_lastSeconds;
+    long long               m_lastIterations;
+
+public:
+    // splits the assembled network's rows among the ranks, evenly by the
+    // number of entries of A
+    DistributedNetwork(const SpringNetwork &network, int ranks);
+
+    int rankCount() const                           { return int(m_subdomains.size()); }
+    const Subdomain &subdomain(int rank) const      { return m_subdomains[rank]; }
+
+    // the halo rows summed over all ranks
+    int haloSize() const;
+
+    void setMethod(Method method)                   { m_method = method; }
+    Method method() const                           { return m_method; }
+
+    // for ImplicitEuler: conjugate gradients stop once the residual falls
+    // below tolerance times the right hand side (1e-10 by default) or
+    // after the given number of iterations (1000)
+    void setTolerance(double tolerance)             { m_tolerance = tolerance; }
+    void setMaxIterations(int iterations)           { m_maxIterations = iterations; }
+
+    // Takes steps of dt from y, in the network's state order, on
+    // rankCount() processes (the caller is rank 0), and leaves the result
+    // in y.  Returns false if the processes could not be started or one of
+    // them failed.
+    bool run(StateType &y, double dt, int steps, std::string *error = 0);
+
+    // of the last run: the time spent stepping, without starting the
+    // processes, and the conjugate gradient iterations over all steps
+    double lastSeconds() const                      { return m_lastSeconds; }
+    long long lastIterations() const                { return m_lastIterations; }
+};
+
+// --------------------------------------------------------------------------
+
+#endif // DISTRIBUTEDNETWORK_H
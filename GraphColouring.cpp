@@ -0,0 +1,60 @@
+#include "GraphColouring.h"
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+EdgeColouring colourEdges(int nodeCount, const vector<pair<int, int> > &edges)
+{
+    // the colours in use at each node, as bit sets of 'words' words each
+    const int bits = 64;
+    int words = 1;
+    vector<unsigned long long> used(nodeCount, 0ull);
+    vector<int> colours(edges.size());
+
+    EdgeColouring colouring;
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        int a = edges[e].first, b = edges[e].second;
+
+        int colour = 0;
+        for (;; ++colour) {
+            if (colour == words * bits) break;
+            unsigned long long bit = 1ull << (colour % bits);
+            int w = colour / bits;
+            if (a >= 0 && (used[a * words + w] & bit)) continue;
+            if (b >= 0 && (used[b * words + w] & bit)) continue;
+            break;
+        }
+
+        // out of bits: widen every node's set
+        if (colour == words * bits) {
+            vector<unsigned long long> wider(size_t(nodeCount) * (words + 1), 0ull);
+            for (int i = 0; i < nodeCount; ++i)
+                for (int w = 0; w < words; ++w)
+                    wider[i * (words + 1) + w] = used[i * words + w];
+            used.swap(wider);
+            ++words;
+        }
+
+        unsigned long long bit = 1ull << (colour % bits);
+        if (a >= 0) used[a * words + colour / bits] |= bit;
+        if (b >= 0) used[b * words + colour / bits] |= bit;
+        colours[e] = colour;
+        if (colour + 1 > colouring.colourCount) colouring.colourCount = colour + 1;
+    }
+
+    // group the edges by colour, keeping their order within each
+    colouring.start.assign(colouring.colourCount + 1, 0);
+    for (size_t e = 0; e < edges.size(); ++e) ++colouring.start[colours[e] + 1];
+    for (int c = 0; c < colouring.colourCount; ++c)
+        colouring.start[c + 1] += colouring.start[c];
+
+    colouring.order.resize(edges.size());
+    vector<int> fill(colouring.start.begin(), colouring.start.end() - 1);
+    for (size_t e = 0; e < edges.size(); ++e)
+        colouring.order[fill[colours[e]]++] = int(e);
+    return colouring;
+}
+
+// --------------------------------------------------------------------------
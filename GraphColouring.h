@@ -0,0 +1,32 @@
+#ifndef GRAPHCOLOURING_H
+#define GRAPHCOLOURING_H
+
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// A partition of a graph's edges into colours, no two edges of a colour
+// sharing a node, so that work on the edges of one colour can run on many
+// threads at once without two of them writing the same node.
+
+struct EdgeColouring
+{
+    int                 colourCount;
+    std::vector<int>    order;      // the edges, grouped by colour
+    std::vector<int>    start;      // colour c is order[start[c]] to order[start[c + 1] - 1]
+
+    EdgeColouring() : colourCount(0) {}
+
+    int size(int colour) const      { return start[colour + 1] - start[colour]; }
+};
+
+// Colours the edges greedily, each with the lowest colour free at both of
+// its ends, which takes at most 2 d - 1 colours for a graph of degree d.
+// Ends that are negative, such as SpringNetwork::Ground, are shared by no
+// other edge.
+EdgeColouring colourEdges(int nodeCount, const std::vector<std::pair<int, int> > &edges);
+
+// --------------------------------------------------------------------------
+
+#endif // GRAPHCOLOURING_H
@@ -0,0 +1,17 @@
+# --------------------------------------------------------------------------
+# Builds the simulation core library and the benchmark, without Qt or
+# OpenGL, e.g. on a server with no display:
+#
+#   qmake Headless.pro && make && ./Benchmark integrators --format csv
+# --------------------------------------------------------------------------
+
+TEMPLATE = subdirs
+
+core.file          = IntegratorCore.pro
+core.makefile      = Makefile.core
+
+benchmark.file     = Benchmark.pro
+benchmark.makefile = Makefile.benchmark
+benchmark.depends  = core
+
+SUBDIRS = core benchmark
@@ -20,6 +20,15 @@ SOURCES  += main.cpp \
             CSphericalCamera.cpp \
             CTrackball.cpp \
             SimpleSpring.cpp \
+            SpringScene.cpp \
+            Checkpoint.cpp \
+            TrajectoryRecorder.cpp \
+            SimulationThread.cpp \
+            Trace.cpp \
+            AllocationTracker.cpp \
+            Machine.cpp \
+            AutoTuner.cpp \
+            BandedLU.cpp \
     Integrators.cpp
 
 HEADERS  += MyMainWindow.h \
@@ -27,6 +36,15 @@ HEADERS  += MyMainWindow.h \
             CSphericalCamera.h \
             CTrackball.h \
             SimpleSpring.h \
+            SpringScene.h \
+            Checkpoint.h \
+            TrajectoryRecorder.h \
+            SimulationThread.h \
+            Trace.h \
+            AllocationTracker.h \
+            Machine.h \
+            AutoTuner.h \
+            BandedLU.h \
     Integrators.h
 
 RESOURCES   += Integrator.qrc
@@ -41,3 +59,4 @@ macx {
 }
             
 QT       += opengl
+CONFIG   += c++11
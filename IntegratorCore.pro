@@ -0,0 +1,61 @@
+# --------------------------------------------------------------------------
+# Simulation core without Qt or OpenGL: the integrators, the spring models
+# and standard test problems, scenes, checkpoints, trajectory recording,
+# the auto-tuner and a thread pool, built as a static library so that
+# headless tools can link against it.
+# --------------------------------------------------------------------------
+
+TEMPLATE = lib
+TARGET   = IntegratorCore
+CONFIG  += staticlib c++11
+CONFIG  -= qt
+
+# qmake CONFIG+=alloc_check counts and rejects heap allocations in marked
+# hot paths (see AllocationTracker.h)
+alloc_check: DEFINES += INTEGRATOR_ALLOCATION_CHECK EIGEN_RUNTIME_NO_MALLOC
+
+SOURCES  += Integrators.cpp \
+            SimpleSpring.cpp \
+            SpringChain.cpp \
+            DampedOscillator.cpp \
+            SpringScene.cpp \
+            Checkpoint.cpp \
+            TrajectoryRecorder.cpp \
+            Trace.cpp \
+            AllocationTracker.cpp \
+            WorkStealingPool.cpp \
+            Machine.cpp \
+            AutoTuner.cpp \
+            TestProblems.cpp \
+            SpringNetwork.cpp \
+            BandedLU.cpp \
+            Cloth.cpp \
+            MultigridSolver.cpp \
+            GraphColouring.cpp \
+            PositionBasedDynamics.cpp \
+            NodeOrdering.cpp \
+            DistributedNetwork.cpp \
+            MultirateIntegrator.cpp
+
+HEADERS  += Integrators.h \
+            SimpleSpring.h \
+            SpringChain.h \
+            DampedOscillator.h \
+            SpringScene.h \
+            Checkpoint.h \
+            TrajectoryRecorder.h \
+            Trace.h \
+            AllocationTracker.h \
+            WorkStealingPool.h \
+            Machine.h \
+            AutoTuner.h \
+            TestProblems.h \
+            SpringNetwork.h \
+            BandedLU.h \
+            Cloth.h \
+            MultigridSolver.h \
+            GraphColouring.h \
+            PositionBasedDynamics.h \
+            NodeOrdering.h \
+            DistributedNetwork.h \
+            MultirateIntegrator.h
@@ -1,2 +1,24 @@
 #include "Integrators.h"
 
+// --------------------------------------------------------------------------
+
+static const char *k_integratorNames[IntegratorTypeCount] = {
+    "euler", "midpoint", "rk4", "implicit", "dopri"
+};
+
+const char *integratorName(IntegratorType type)
+{
+    return type < IntegratorTypeCount ? k_integratorNames[type] : "unknown";
+}
+
+bool parseIntegratorType(const std::string &name, IntegratorType *type)
+{
+    for (int i = 0; i < IntegratorTypeCount; ++i)
+        if (name == k_integratorNames[i]) {
+            *type = IntegratorType(i);
+            return true;
+        }
+    return false;
+}
+
+// --------------------------------------------------------------------------
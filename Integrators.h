@@ -1,7 +1,14 @@
 #ifndef INTEGRATORS_H
 #define INTEGRATORS_H
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <new>
+#include <string>
+#include <vector>
 #include "Eigen/LU"
+#include "BandedLU.h"
 
 // --------------------------------------------------------------------------
 
@@ -10,6 +17,14 @@ class OrdinaryDifferentialEquation
 {
 public:
     virtual S derivativeFunction(double t, const S &state) const = 0;
+
+    // Writes the derivative into dy, which the integrators keep between
+    // steps, so that no temporary state has to be allocated once dy has
+    // its size.  Models should override this if they can.
+    virtual void derivative(double t, const S &state, S &dy) const
+    {
+        dy = derivativeFunction(t, state);
+    }
 };
 
 template <typename S, typename M>
@@ -20,10 +35,92 @@ public:
     virtual const M &matrixA() const = 0;
     virtual const S &vectorB() const = 0;
     virtual bool matrixChanged() { return false; }
+
+    virtual void derivative(double t, const S &state, S &dy) const
+    {
+        dy.noalias() = matrixA() * state;
+        dy += vectorB();
+    }
+};
+
+// An ODE that can also give its Jacobian df/dy, for integrators that
+// linearize it about the current state.
+
+template <typename S, typename M>
+class DifferentiableODE : public OrdinaryDifferentialEquation<S>
+{
+public:
+    virtual void jacobian(double t, const S &state, M &J) const = 0;
 };
 
 // --------------------------------------------------------------------------
 
+// Work done by an integrator since it was created, so that cost can be
+// attributed to a scheme and an operation.  Counting is compiled in unless
+// INTEGRATOR_NO_COUNTERS is defined.  The timers read the clock on every
+// step, which costs about as much as a small step, so they are only
+// compiled in if INTEGRATOR_TIMERS is defined.
+
+struct IntegratorCounters
+{
+    long long   steps;
+    long long   evaluations;        // of the ODE's derivative function
+    long long   factorizations;
+    long long   solves;
+    long long   rejectedSteps;      // adaptive substeps that were retried
+    double      stepSeconds;
+    double      factorSeconds;
+
+    IntegratorCounters() { reset(); }
+
+    void reset()
+    {
+        steps = evaluations = factorizations = solves = rejectedSteps = 0;
+        stepSeconds = factorSeconds = 0.0;
+    }
+
+    IntegratorCounters &operator+=(const IntegratorCounters &c)
+    {
+        steps += c.steps;
+        evaluations += c.evaluations;
+        factorizations += c.factorizations;
+        solves += c.solves;
+        rejectedSteps += c.rejectedSteps;
+        stepSeconds += c.stepSeconds;
+        factorSeconds += c.factorSeconds;
+        return *this;
+    }
+};
+
+#if defined(INTEGRATOR_NO_COUNTERS)
+#undef INTEGRATOR_TIMERS
+#define INTEGRATOR_COUNT(field, n)  ((void)0)
+#else
+#define INTEGRATOR_COUNT(field, n)  (this->m_counters.field += (n))
+#endif
+
+#if defined(INTEGRATOR_TIMERS)
+// adds the time until the end of the enclosing scope to a counter
+class IntegratorTimer
+{
+    double                                  &m_seconds;
+    std::chrono::steady_clock::time_point    m_start;
+
+public:
+    explicit IntegratorTimer(double &seconds)
+        : m_seconds(seconds), m_start(std::chrono::steady_clock::now()) {}
+    ~IntegratorTimer()
+    {
+        m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+#define INTEGRATOR_TIME(field)      IntegratorTimer integratorTimer(this->m_counters.field)
+#else
+#define INTEGRATOR_TIME(field)      ((void)0)
+#endif
+
+// --------------------------------------------------------------------------
+
 template <typename S>
 class Integrator
 {
@@ -34,9 +131,21 @@ protected:
     double  m_time;
     double  m_timeStep;
 
+#if !defined(INTEGRATOR_NO_COUNTERS)
+    IntegratorCounters m_counters;
+#endif
+
+    // evaluates the ODE into dy, counting the evaluation
+    void derivative(double t, const S &y, S &dy)
+    {
+        INTEGRATOR_COUNT(evaluations, 1);
+        m_ode->derivative(t, y, dy);
+    }
+
 public:
     Integrator(OrdinaryDifferentialEquation<S> *ode, double dt)
         : m_ode(ode), m_time(0.0), m_timeStep(dt) {}
+    virtual ~Integrator() {}
 
     void setState(const S &state)       { m_state = state; }
     S state() const                     { return m_state; }
@@ -44,6 +153,21 @@ public:
     virtual void setTimeStep(double dt) { m_timeStep = dt; }
     double timeStep() const             { return m_timeStep; }
 
+    void setTime(double t)              { m_time = t; }
+    double time() const                 { return m_time; }
+
+    // points the integrator at a different ODE, e.g. after the object
+    // holding both of them has been copied
+    void bind(OrdinaryDifferentialEquation<S> *ode) { m_ode = ode; }
+
+#if defined(INTEGRATOR_NO_COUNTERS)
+    IntegratorCounters counters() const { return IntegratorCounters(); }
+    void resetCounters()                {}
+#else
+    IntegratorCounters counters() const { return m_counters; }
+    void resetCounters()                { m_counters.reset(); }
+#endif
+
     virtual void step() = 0;
 };
 
@@ -52,6 +176,9 @@ public:
 template <typename S>
 class ExplicitEulerIntegrator : public Integrator<S>
 {
+protected:
+    S       m_dy;
+
 public:
     ExplicitEulerIntegrator(OrdinaryDifferentialEquation<S> *ode, double dt)
         : Integrator<S>(ode, dt)
@@ -59,32 +186,71 @@ public:
 
     virtual void step()
     {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
         double &t   = this->m_time;
         double &dt  = this->m_timeStep;
         S &y        = this->m_state;
 
-        y += dt * this->m_ode->derivativeFunction(t, y);
+        this->derivative(t, y, m_dy);
+        y += dt * m_dy;
         t += dt;
     }
 };
 
 // --------------------------------------------------------------------------
 
+// An LU factorization with partial pivoting that can also be put back into a
+// previously computed state (say, from a checkpoint) without factoring again.
+
+template <typename M>
+class RestorableLU : public Eigen::PartialPivLU<M>
+{
+public:
+    typedef typename Eigen::PartialPivLU<M>::TranspositionType TranspositionType;
+
+    bool isInitialized() const                      { return this->m_isInitialized; }
+    const TranspositionType &transpositions() const { return this->m_rowsTranspositions; }
+
+    void restore(const M &lu, const TranspositionType &transpositions)
+    {
+        this->m_lu = lu;
+        this->m_rowsTranspositions = transpositions;
+        this->m_p = transpositions;
+
+        int swaps = 0;
+        for (int i = 0; i < transpositions.size(); ++i)
+            if (transpositions.coeff(i) != i) ++swaps;
+        this->m_det_p = (swaps % 2) ? -1 : 1;
+        this->m_isInitialized = true;
+    }
+};
+
+// --------------------------------------------------------------------------
+
 template <typename S, typename M>
 class ImplicitEulerIntegrator : public Integrator<S>
 {
 protected:
     LinearODE<S, M>        *m_linearODE;
-    Eigen::PartialPivLU<M>  m_factorized;
+    RestorableLU<M>         m_factorized;
+
+    // workspace for forming (I - dt A) and the right hand side
+    M                       m_system;
+    S                       m_rhs;
 
     // refactor method assumes the matrix type is an Eigen matrix
     void refactor()
     {
-        M I         = M::Identity();
         double &dt  = this->m_timeStep;
         const M &A  = this->m_linearODE->matrixA();
 
-        m_factorized = (I - dt * A).partialPivLu();
+        INTEGRATOR_TIME(factorSeconds);
+        INTEGRATOR_COUNT(factorizations, 1);
+        m_system = -dt * A;
+        m_system.diagonal().array() += 1.0;
+        m_factorized.compute(m_system);
     }
 
 public:
@@ -92,6 +258,16 @@ public:
         : Integrator<S>(ode, dt), m_linearODE(ode)
     {}
 
+    void bind(LinearODE<S, M> *ode)
+    {
+        Integrator<S>::bind(ode);
+        m_linearODE = ode;
+    }
+
+    // the cached factorization of (I - dt A), e.g. for checkpointing
+    RestorableLU<M> &factorization()                { return m_factorized; }
+    const RestorableLU<M> &factorization() const    { return m_factorized; }
+
     virtual void setTimeStep(double dt)
     {
         Integrator<S>::setTimeStep(dt);
@@ -100,6 +276,9 @@ public:
 
     virtual void step()
     {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
         // if the linear ODE's matrix has changed, refactor our solution
         if (m_linearODE->matrixChanged()) refactor();
 
@@ -108,7 +287,189 @@ public:
         S &y        = this->m_state;
         const S &b  = this->m_linearODE->vectorB();
 
-        y = m_factorized.solve(y + dt * b);
+        m_rhs = y + dt * b;
+        y = m_factorized.solve(m_rhs);
+        INTEGRATOR_COUNT(solves, 1);
+        t += dt;
+    }
+};
+
+// --------------------------------------------------------------------------
+
+// Implicit Euler for linear ODEs whose A is sparse and banded once its
+// unknowns are suitably ordered, as chains of springs and 1-D meshes are.
+// (I - dt A) is factored by BandedLU, in time linear in the size for a
+// fixed bandwidth, and each step is a linear-time solve.
+//
+// The ordering can be given with setOrdering(); otherwise the narrower of
+// the natural order and interleavedOrdering() is chosen at each
+// refactorization.  M must be an Eigen sparse matrix.
+//
+// If (I - dt A) is singular, isSingular() is true and steps leave the state
+// as it was, without trying to factor it again, until the time step or the
+// matrix changes.
+
+template <typename S, typename M>
+class BandedImplicitEulerIntegrator : public Integrator<S>
+{
+protected:
+    LinearODE<S, M>    *m_linearODE;
+    BandedLU            m_factorized;
+
+    std::vector<int>    m_givenOrder;
+    std::vector<int>    m_order;        // new index of each unknown
+    std::vector<int>    m_interleaved;
+    std::vector<double> m_rhs;          // in the new order
+    bool                m_singular;
+
+    void refactor()
+    {
+        double &dt  = this->m_timeStep;
+        const M &A  = this->m_linearODE->matrixA();
+        int n       = int(A.rows());
+
+        INTEGRATOR_TIME(factorSeconds);
+        INTEGRATOR_COUNT(factorizations, 1);
+
+        int lower, upper;
+        if (!m_givenOrder.empty()) {
+            m_order = m_givenOrder;
+            bandwidth(A, m_order, &lower, &upper);
+        } else {
+            std::vector<int> natural;
+            interleavedOrdering(n, m_interleaved);
+            int naturalLower, naturalUpper;
+            bandwidth(A, natural, &naturalLower, &naturalUpper);
+            bandwidth(A, m_interleaved, &lower, &upper);
+            // the factorization's cost goes as lower (lower + upper)
+            if (double(naturalLower) * (naturalLower + naturalUpper)
+                    <= double(lower) * (lower + upper)) {
+                lower = naturalLower;
+                upper = naturalUpper;
+                m_order.resize(n);
+                for (int i = 0; i < n; ++i) m_order[i] = i;
+            } else {
+                m_order = m_interleaved;
+            }
+        }
+
+        m_factorized.reset(n, lower, upper);
+        for (int i = 0; i < n; ++i) m_factorized.add(m_order[i], m_order[i], 1.0);
+        for (int outer = 0; outer < A.outerSize(); ++outer)
+            for (typename M::InnerIterator it(A, outer); it; ++it)
+                m_factorized.add(m_order[it.row()], m_order[it.col()], -dt * it.value());
+        m_singular = !m_factorized.factorize();
+        m_rhs.resize(n);
+    }
+
+public:
+    BandedImplicitEulerIntegrator(LinearODE<S, M> *ode, double dt)
+        : Integrator<S>(ode, dt), m_linearODE(ode), m_singular(false)
+    {}
+
+    void bind(LinearODE<S, M> *ode)
+    {
+        Integrator<S>::bind(ode);
+        m_linearODE = ode;
+    }
+
+    // renumbers unknown i to order[i] before factoring; an empty order
+    // restores the automatic choice
+    void setOrdering(const std::vector<int> &order)
+    {
+        m_givenOrder = order;
+        if (m_factorized.isFactorized() || m_singular) refactor();
+    }
+
+    const std::vector<int> &ordering() const    { return m_order; }
+    const BandedLU &factorization() const       { return m_factorized; }
+    bool isSingular() const                     { return m_singular; }
+
+    virtual void setTimeStep(double dt)
+    {
+        Integrator<S>::setTimeStep(dt);
+        refactor();
+    }
+
+    virtual void step()
+    {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
+        if (m_linearODE->matrixChanged() || (!m_factorized.isFactorized() && !m_singular))
+            refactor();
+
+        double &t   = this->m_time;
+        double &dt  = this->m_timeStep;
+        S &y        = this->m_state;
+        const S &b  = this->m_linearODE->vectorB();
+        int n       = int(y.size());
+
+        if (!m_singular) {
+            for (int i = 0; i < n; ++i) m_rhs[m_order[i]] = y[i] + dt * b[i];
+            m_factorized.solve(&m_rhs[0]);
+            for (int i = 0; i < n; ++i) y[i] = m_rhs[m_order[i]];
+            INTEGRATOR_COUNT(solves, 1);
+        }
+        t += dt;
+    }
+};
+
+// --------------------------------------------------------------------------
+
+// Linearly implicit (Rosenbrock) Euler for nonlinear ODEs:
+//
+//      y(t + dt) = y + dt (I - dt J)^-1 f(t, y),   J = df/dy at (t, y)
+//
+// One Jacobian, one factorization and one solve per step, and no Newton
+// iterations.  It is stable on stiff problems, and on a linear ODE it is
+// the same as implicit Euler.
+
+template <typename S, typename M>
+class LinearlyImplicitEulerIntegrator : public Integrator<S>
+{
+protected:
+    DifferentiableODE<S, M>    *m_differentiableODE;
+    Eigen::PartialPivLU<M>      m_factorized;
+
+    M       m_jacobian;
+    M       m_system;
+    S       m_dy;
+    S       m_increment;
+
+public:
+    LinearlyImplicitEulerIntegrator(DifferentiableODE<S, M> *ode, double dt)
+        : Integrator<S>(ode, dt), m_differentiableODE(ode)
+    {}
+
+    void bind(DifferentiableODE<S, M> *ode)
+    {
+        Integrator<S>::bind(ode);
+        m_differentiableODE = ode;
+    }
+
+    virtual void step()
+    {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
+        double &t   = this->m_time;
+        double &dt  = this->m_timeStep;
+        S &y        = this->m_state;
+
+        this->derivative(t, y, m_dy);
+        m_differentiableODE->jacobian(t, y, m_jacobian);
+        {
+            INTEGRATOR_TIME(factorSeconds);
+            INTEGRATOR_COUNT(factorizations, 1);
+            m_system = -dt * m_jacobian;
+            m_system.diagonal().array() += 1.0;
+            m_factorized.compute(m_system);
+        }
+
+        m_increment = m_factorized.solve(m_dy);
+        INTEGRATOR_COUNT(solves, 1);
+        y += dt * m_increment;
         t += dt;
     }
 };
@@ -118,6 +479,10 @@ public:
 template <typename S>
 class ModifiedMidpointIntegrator : public Integrator<S>
 {
+protected:
+    S       m_dy;
+    S       m_midpoint;
+
 public:
     ModifiedMidpointIntegrator(OrdinaryDifferentialEquation<S> *ode, double dt)
         : Integrator<S>(ode, dt)
@@ -125,15 +490,20 @@ public:
 
     virtual void step()
     {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
         double &t   = this->m_time;
         double &dt  = this->m_timeStep;
         S &y        = this->m_state;
 
         // predictor step
-        S yp = y + 0.5*dt * this->m_ode->derivativeFunction(t, y);
+        this->derivative(t, y, m_dy);
+        m_midpoint = y + 0.5*dt * m_dy;
 
         // corrector step
-        y += dt * this->m_ode->derivativeFunction(t + 0.5*dt, yp);
+        this->derivative(t + 0.5*dt, m_midpoint, m_dy);
+        y += dt * m_dy;
 
         t += dt;
     }
@@ -144,6 +514,10 @@ public:
 template <typename S>
 class RungeKutta4Integrator : public Integrator<S>
 {
+protected:
+    S       m_k1, m_k2, m_k3, m_k4;
+    S       m_stage;
+
 public:
     RungeKutta4Integrator(OrdinaryDifferentialEquation<S> *ode, double dt)
         : Integrator<S>(ode, dt)
@@ -151,18 +525,24 @@ public:
 
     virtual void step()
     {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
         double &t   = this->m_time;
         double &dt  = this->m_timeStep;
         S &y        = this->m_state;
 
         // calculate 4 Runge-Kutta steps
-        S dy1 = dt * this->m_ode->derivativeFunction(t, y);
-        S dy2 = dt * this->m_ode->derivativeFunction(t + 0.5*dt, y + 0.5*dy1);
-        S dy3 = dt * this->m_ode->derivativeFunction(t + 0.5*dt, y + 0.5*dy2);
-        S dy4 = dt * this->m_ode->derivativeFunction(t + dt, y + dy3);
+        this->derivative(t, y, m_k1);
+        m_stage = y + 0.5*dt * m_k1;
+        this->derivative(t + 0.5*dt, m_stage, m_k2);
+        m_stage = y + 0.5*dt * m_k2;
+        this->derivative(t + 0.5*dt, m_stage, m_k3);
+        m_stage = y + dt * m_k3;
+        this->derivative(t + dt, m_stage, m_k4);
 
         // perform state update
-        y += 1.0/6.0 * (dy1 + 2.0*dy2 + 2.0*dy3 + dy4);
+        y += dt/6.0 * (m_k1 + 2.0*m_k2 + 2.0*m_k3 + m_k4);
 
         t += dt;
     }
@@ -170,4 +550,282 @@ public:
 
 // --------------------------------------------------------------------------
 
+// Dormand-Prince 5(4) with adaptive step size control.  Each call to step()
+// still advances the state by exactly the time step, but does so in as many
+// internal substeps as are needed to keep the local error estimate within
+// the tolerance.  The substep size is carried over from one call to the
+// next.
+
+template <typename S>
+class DormandPrinceIntegrator : public Integrator<S>
+{
+protected:
+    double  m_tolerance;
+    double  m_substep;
+
+    // stages, trial solution and error estimate, kept between steps
+    S       m_k1, m_k2, m_k3, m_k4, m_k5, m_k6, m_k7;
+    S       m_stage, m_y5, m_error;
+
+public:
+    DormandPrinceIntegrator(OrdinaryDifferentialEquation<S> *ode, double dt)
+        : Integrator<S>(ode, dt), m_tolerance(1e-6), m_substep(dt)
+    {}
+
+    // relative and absolute tolerance on each state component
+    void setTolerance(double tolerance) { m_tolerance = tolerance; }
+    double tolerance() const            { return m_tolerance; }
+
+    // the size of the next substep, saved with checkpoints
+    void setSubstep(double h)           { m_substep = h; }
+    double substep() const              { return m_substep; }
+
+    virtual void step()
+    {
+        INTEGRATOR_TIME(stepSeconds);
+        INTEGRATOR_COUNT(steps, 1);
+
+        double &t   = this->m_time;
+        double &dt  = this->m_timeStep;
+        S &y        = this->m_state;
+
+        const double end = t + dt;
+        if (!(m_substep > 0.0) || m_substep > dt) m_substep = dt;
+
+        // the last stage is evaluated at the new state, so it is reused as
+        // the first stage of the next substep
+        this->derivative(t, y, m_k1);
+        while (t < end)
+        {
+            double h = m_substep;
+            bool last = h >= end - t;
+            if (last) h = end - t;
+
+            m_stage = y + h*(1.0/5.0*m_k1);
+            this->derivative(t + h/5.0, m_stage, m_k2);
+            m_stage = y + h*(3.0/40.0*m_k1 + 9.0/40.0*m_k2);
+            this->derivative(t + h*3.0/10.0, m_stage, m_k3);
+            m_stage = y + h*(44.0/45.0*m_k1 - 56.0/15.0*m_k2 + 32.0/9.0*m_k3);
+            this->derivative(t + h*4.0/5.0, m_stage, m_k4);
+            m_stage = y + h*(19372.0/6561.0*m_k1 - 25360.0/2187.0*m_k2 + 64448.0/6561.0*m_k3
+                             - 212.0/729.0*m_k4);
+            this->derivative(t + h*8.0/9.0, m_stage, m_k5);
+            m_stage = y + h*(9017.0/3168.0*m_k1 - 355.0/33.0*m_k2 + 46732.0/5247.0*m_k3
+                             + 49.0/176.0*m_k4 - 5103.0/18656.0*m_k5);
+            this->derivative(t + h, m_stage, m_k6);
+            m_y5 = y + h*(35.0/384.0*m_k1 + 500.0/1113.0*m_k3 + 125.0/192.0*m_k4
+                          - 2187.0/6784.0*m_k5 + 11.0/84.0*m_k6);
+            this->derivative(t + h, m_y5, m_k7);
+
+            // difference between the fifth and embedded fourth order
+            // solutions, scaled by the tolerance
+            m_error = h*(71.0/57600.0*m_k1 - 71.0/16695.0*m_k3 + 71.0/1920.0*m_k4
+                         - 17253.0/339200.0*m_k5 + 22.0/525.0*m_k6 - 1.0/40.0*m_k7);
+            double error = 0.0;
+            for (int i = 0; i < m_error.size(); ++i) {
+                double scale = m_tolerance * (1.0 + std::max(std::abs(y[i]), std::abs(m_y5[i])));
+                error = std::max(error, std::abs(m_error[i]) / scale);
+            }
+
+            // substeps too small to make progress are accepted regardless
+            bool accept = error <= 1.0 || h <= 1e-12 * std::max(1.0, std::abs(t));
+            double factor = error > 0.0 ? 0.9 * std::pow(error, -0.2) : 5.0;
+            factor = std::min(5.0, std::max(0.2, factor));
+
+            if (accept) {
+                t = last ? end : t + h;
+                y = m_y5;
+                m_k1 = m_k7;
+                // a substep cut short to land on the end says nothing about
+                // how large the next one may be
+                if (!last || h >= m_substep) m_substep = h * factor;
+            }
+            else {
+                INTEGRATOR_COUNT(rejectedSteps, 1);
+                m_substep = h * factor;
+            }
+        }
+    }
+};
+
+// --------------------------------------------------------------------------
+
+// The integrators bundled above, for code that picks one at run time.
+
+enum IntegratorType
+{
+    ExplicitEuler,
+    ModifiedMidpoint,
+    RungeKutta4,
+    ImplicitEuler,
+    DormandPrince,
+    IntegratorTypeCount
+};
+
+const char *integratorName(IntegratorType type);
+bool parseIntegratorType(const std::string &name, IntegratorType *type);
+
+// --------------------------------------------------------------------------
+
+// Holds any one of the bundled integrators by value, so that a model can
+// keep its integrator inline instead of behind a pointer to a separately
+// allocated object.  Calls are dispatched with a switch on the type to a
+// non-virtual call of the concrete integrator's method.
+//
+// Because the integrators point at their ODE, the owner must call bind()
+// whenever the variant is copied into a new object.
+
+template <typename S, typename M>
+class IntegratorVariant
+{
+    union Storage
+    {
+        ExplicitEulerIntegrator<S>      explicitEuler;
+        ModifiedMidpointIntegrator<S>   modifiedMidpoint;
+        RungeKutta4Integrator<S>        rungeKutta4;
+        ImplicitEulerIntegrator<S, M>   implicitEuler;
+        DormandPrinceIntegrator<S>      dormandPrince;
+
+        Storage()   {}
+        ~Storage()  {}
+    };
+
+    Storage         m_storage;
+    IntegratorType  m_type;
+
+    // calls f with the concrete integrator currently held
+    template <typename F> void visit(F &f)
+    {
+        switch (m_type) {
+        case ExplicitEuler:     f(m_storage.explicitEuler);     break;
+        case ModifiedMidpoint:  f(m_storage.modifiedMidpoint);  break;
+        case RungeKutta4:       f(m_storage.rungeKutta4);       break;
+        case ImplicitEuler:     f(m_storage.implicitEuler);     break;
+        case DormandPrince:     f(m_storage.dormandPrince);     break;
+        default:                                                break;
+        }
+    }
+
+    struct Destroy
+    {
+        template <typename T> void operator()(T &i) const { i.~T(); }
+    };
+
+    struct CopyTo
+    {
+        Storage *target;
+        template <typename T> void operator()(T &i) const { new (target) T(i); }
+    };
+
+    struct Step
+    {
+        template <typename T> void operator()(T &i) const { i.T::step(); }
+    };
+
+    struct SetTimeStep
+    {
+        double dt;
+        template <typename T> void operator()(T &i) const { i.T::setTimeStep(dt); }
+    };
+
+    struct Bind
+    {
+        LinearODE<S, M> *ode;
+        template <typename T> void operator()(T &i) const { i.bind(ode); }
+    };
+
+public:
+    // the integrator held, as its base class (null if there is none)
+    Integrator<S> *integrator()
+    {
+        switch (m_type) {
+        case ExplicitEuler:     return &m_storage.explicitEuler;
+        case ModifiedMidpoint:  return &m_storage.modifiedMidpoint;
+        case RungeKutta4:       return &m_storage.rungeKutta4;
+        case ImplicitEuler:     return &m_storage.implicitEuler;
+        case DormandPrince:     return &m_storage.dormandPrince;
+        default:                return 0;
+        }
+    }
+
+    const Integrator<S> *integrator() const
+    {
+        return const_cast<IntegratorVariant *>(this)->integrator();
+    }
+
+    IntegratorVariant() : m_type(IntegratorTypeCount) {}
+
+    IntegratorVariant(const IntegratorVariant &v) : m_type(IntegratorTypeCount)
+    {
+        *this = v;
+    }
+
+    ~IntegratorVariant() { clear(); }
+
+    IntegratorVariant &operator=(const IntegratorVariant &v)
+    {
+        if (this != &v) {
+            clear();
+            CopyTo copy = { &m_storage };
+            const_cast<IntegratorVariant &>(v).visit(copy);
+            m_type = v.m_type;
+        }
+        return *this;
+    }
+
+    void create(IntegratorType type, LinearODE<S, M> *ode, double dt)
+    {
+        clear();
+        switch (type) {
+        case ExplicitEuler:
+            new (&m_storage.explicitEuler) ExplicitEulerIntegrator<S>(ode, dt);         break;
+        case ModifiedMidpoint:
+            new (&m_storage.modifiedMidpoint) ModifiedMidpointIntegrator<S>(ode, dt);   break;
+        case RungeKutta4:
+            new (&m_storage.rungeKutta4) RungeKutta4Integrator<S>(ode, dt);             break;
+        case ImplicitEuler:
+            new (&m_storage.implicitEuler) ImplicitEulerIntegrator<S, M>(ode, dt);      break;
+        case DormandPrince:
+            new (&m_storage.dormandPrince) DormandPrinceIntegrator<S>(ode, dt);         break;
+        default:
+            return;
+        }
+        m_type = type;
+    }
+
+    void clear()
+    {
+        Destroy destroy;
+        visit(destroy);
+        m_type = IntegratorTypeCount;
+    }
+
+    bool isNull() const                 { return m_type == IntegratorTypeCount; }
+    IntegratorType type() const         { return m_type; }
+
+    void bind(LinearODE<S, M> *ode)     { Bind b = { ode }; visit(b); }
+
+    void setState(const S &state)       { integrator()->setState(state); }
+    S state() const                     { return integrator()->state(); }
+
+    void setTimeStep(double dt)         { SetTimeStep s = { dt }; visit(s); }
+    double timeStep() const             { return integrator()->timeStep(); }
+
+    void step()                         { Step s; visit(s); }
+
+    IntegratorCounters counters() const
+    {
+        return isNull() ? IntegratorCounters() : integrator()->counters();
+    }
+    void resetCounters()                { if (!isNull()) integrator()->resetCounters(); }
+
+    // only the adaptive integrator has a tolerance; others ignore it
+    void setTolerance(double tolerance)
+    {
+        if (m_type == DormandPrince) m_storage.dormandPrince.setTolerance(tolerance);
+    }
+};
+
+// --------------------------------------------------------------------------
+
 #endif // INTEGRATORS_H
@@ -0,0 +1,42 @@
+#include "Machine.h"
+#include <cstdlib>
+#include <fstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+string Machine::hostName()
+{
+#ifdef _WIN32
+    const char *name = getenv("COMPUTERNAME");
+    return name ? name : "unknown";
+#else
+    char name[256] = { 0 };
+    if (gethostname(name, sizeof(name) - 1) != 0) return "unknown";
+    return name;
+#endif
+}
+
+string Machine::cpuName()
+{
+#ifdef _WIN32
+    const char *name = getenv("PROCESSOR_IDENTIFIER");
+    return name ? name : "unknown";
+#else
+    ifstream in("/proc/cpuinfo");
+    string line;
+    while (getline(in, line))
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t value = line.find_first_not_of(" \t", line.find(':') + 1);
+            if (value != string::npos) return line.substr(value);
+        }
+    return "unknown";
+#endif
+}
+
+// --------------------------------------------------------------------------
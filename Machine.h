@@ -0,0 +1,23 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <string>
+
+// --------------------------------------------------------------------------
+
+// Identifies the machine that measurements were taken on, so that stored
+// timings are only compared with, or reused on, the same kind of machine.
+
+namespace Machine {
+
+// the network name of this computer, or "unknown"
+std::string hostName();
+
+// the processor's model name where the system reports it, or "unknown"
+std::string cpuName();
+
+}
+
+// --------------------------------------------------------------------------
+
+#endif // MACHINE_H
@@ -0,0 +1,298 @@
+#include "MultigridSolver.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+// grids of at most this many nodes are solved directly
+static const int k_coarsestSize = 64;
+
+// y = A x, or y += A x
+static void multiply(const MultigridSolver::MatrixType &A, const VectorXd &x, VectorXd &y,
+                     bool accumulate = false)
+{
+    const double *values = A._valuePtr();
+    const int *columns = A._innerIndexPtr();
+    const int *rows = A._outerIndexPtr();
+    for (int r = 0; r < A.rows(); ++r) {
+        double sum = accumulate ? y[r] : 0.0;
+        for (int k = rows[r]; k < rows[r + 1]; ++k)
+            sum += values[k] * x[columns[k]];
+        y[r] = sum;
+    }
+}
+
+// Bilinear interpolation from a coarse grid keeping every other node to the
+// fine one; a direction with two nodes or fewer is not coarsened.
+static MultigridSolver::MatrixType prolongation(int width, int height,
+                                                int coarseWidth, int coarseHeight)
+{
+    struct Weights {
+        int     index[2];
+        double  weight[2];
+        int     count;
+
+        Weights(int i, int fine, int coarse) {
+            if (fine == coarse) { index[0] = i;  weight[0] = 1.0;  count = 1; }
+            else if (i % 2 == 0) { index[0] = i / 2;  weight[0] = 1.0;  count = 1; }
+            else if ((i + 1) / 2 < coarse) {
+                index[0] = i / 2;   index[1] = i / 2 + 1;
+                weight[0] = weight[1] = 0.5;
+                count = 2;
+            }
+            else { index[0] = i / 2;  weight[0] = 1.0;  count = 1; }
+        }
+    };
+
+    MultigridSolver::MatrixType P(width * height, coarseWidth * coarseHeight);
+    P.reserve(4 * width * height);
+    for (int j = 0; j < height; ++j)
+    {
+        Weights y(j, height, coarseHeight);
+        for (int i = 0; i < width; ++i)
+        {
+            Weights x(i, width, coarseWidth);
+            P.startVec(j * width + i);
+            for (int b = 0; b < y.count; ++b)
+                for (int a = 0; a < x.count; ++a)
+                    P.insertBack(j * width + i, y.index[b] * coarseWidth + x.index[a])
+                        = y.weight[b] * x.weight[a];
+        }
+    }
+    P.finalize();
+    return P;
+}
+
+// --------------------------------------------------------------------------
+
+MultigridSolver::MultigridSolver()
+    : m_width(0), m_height(0), m_smoothing(2), m_maxCycles(50), m_tolerance(1e-8),
+      m_lastCycles(0), m_lastResidual(0.0)
+{}
+
+void MultigridSolver::setGrid(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_levels.clear();
+}
+
+bool MultigridSolver::compute(const MatrixType &A)
+{
+    m_levels.clear();
+    if (A.rows() != A.cols() || (long long)(m_width) * m_height != A.rows()) return false;
+
+    m_levels.push_back(Level());
+    m_levels[0].width = m_width;
+    m_levels[0].height = m_height;
+    m_levels[0].matrix = A;
+
+    for (;;)
+    {
+        Level &fine = m_levels.back();
+        int n = fine.width * fine.height;
+        fine.rhs.setZero(n);
+        fine.solution.setZero(n);
+        fine.residual.setZero(n);
+        fine.inverseDiagonal.setZero(n);
+        for (int r = 0; r < n; ++r)
+            for (MatrixType::InnerIterator it(fine.matrix, r); it; ++it)
+                if (it.col() == r) fine.inverseDiagonal[r] = 1.0 / it.value();
+        if (n <= k_coarsestSize || (fine.width <= 2 && fine.height <= 2)) break;
+
+        Level coarse;
+        coarse.width = fine.width > 2 ? (fine.width + 1) / 2 : fine.width;
+        coarse.height = fine.height > 2 ? (fine.height + 1) / 2 : fine.height;
+        fine.prolongation = prolongation(fine.width, fine.height, coarse.width, coarse.height);
+        fine.restriction = fine.prolongation.transpose();
+        coarse.matrix = MatrixType(fine.restriction * fine.matrix) * fine.prolongation;
+        m_levels.push_back(coarse);
+    }
+
+    m_coarsest.compute(MatrixXd(m_levels.back().matrix));
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void MultigridSolver::computeResidual(const Level &level, const VectorType &x,
+                                      VectorType &r) const
+{
+    multiply(level.matrix, x, r);
+    r = level.rhs - r;
+}
+
+// One Gauss-Seidel sweep, through the unknowns in order or in reverse.
+// Correcting x_r by its residual over a_rr sets it to what the standard
+// form gives, without singling out the diagonal in the loop.
+void MultigridSolver::smooth(const Level &level, bool forward, VectorType &x) const
+{
+    const MatrixType &A = level.matrix;
+    const double *values = A._valuePtr();
+    const int *columns = A._innerIndexPtr();
+    const int *rows = A._outerIndexPtr();
+    int n = int(A.rows());
+
+    for (int step = 0; step < n; ++step)
+    {
+        int r = forward ? step : n - 1 - step;
+        double residual = level.rhs[r];
+        for (int k = rows[r]; k < rows[r + 1]; ++k)
+            residual -= values[k] * x[columns[k]];
+        x[r] += residual * level.inverseDiagonal[r];
+    }
+}
+
+void MultigridSolver::vCycle(int l)
+{
+    Level &level = m_levels[l];
+    if (l + 1 == int(m_levels.size())) {
+        level.solution = m_coarsest.solve(level.rhs);
+        return;
+    }
+
+    for (int i = 0; i < m_smoothing; ++i) smooth(level, true, level.solution);
+
+    Level &coarse = m_levels[l + 1];
+    computeResidual(level, level.solution, level.residual);
+    multiply(level.restriction, level.residual, coarse.rhs);
+    coarse.solution.setZero();
+    vCycle(l + 1);
+    multiply(level.prolongation, coarse.solution, level.solution, true);
+
+    for (int i = 0; i < m_smoothing; ++i) smooth(level, false, level.solution);
+}
+
+bool MultigridSolver::solve(const VectorType &b, VectorType &x)
+{
+    if (m_levels.empty()) return false;
+
+    Level &top = m_levels[0];
+    top.rhs = b;
+    top.solution = x;
+
+    double target = m_tolerance * b.norm();
+    computeResidual(top, top.solution, top.residual);
+    m_lastResidual = top.residual.norm();
+
+    int cycles = 0;
+    while (m_lastResidual > target && cycles < m_maxCycles) {
+        vCycle(0);
+        ++cycles;
+        computeResidual(top, top.solution, top.residual);
+        m_lastResidual = top.residual.norm();
+    }
+
+    x = top.solution;
+    m_lastCycles = cycles;
+    return m_lastResidual <= target;
+}
+
+// --------------------------------------------------------------------------
+
+MultigridImplicitEulerIntegrator::MultigridImplicitEulerIntegrator(
+        LinearODE<StateType, MatrixType> *ode, double dt, int width, int height)
+    : Integrator<StateType>(ode, dt), m_linearODE(ode), m_totalCycles(0), m_gridMatches(true)
+{
+    m_solver.setGrid(width, height);
+}
+
+void MultigridImplicitEulerIntegrator::bind(LinearODE<StateType, MatrixType> *ode)
+{
+    Integrator<StateType>::bind(ode);
+    m_linearODE = ode;
+}
+
+void MultigridImplicitEulerIntegrator::setTimeStep(double dt)
+{
+    Integrator<StateType>::setTimeStep(dt);
+    rebuild();
+}
+
+// forms I - dt Avv - dt^2 Avx from the velocity rows of A
+void MultigridImplicitEulerIntegrator::rebuild()
+{
+    INTEGRATOR_TIME(factorSeconds);
+    INTEGRATOR_COUNT(factorizations, 1);
+
+    const MatrixType &A = m_linearODE->matrixA();
+    const double *values = A._valuePtr();
+    const int *columns = A._innerIndexPtr();
+    const int *rows = A._outerIndexPtr();
+    double dt = m_timeStep;
+    int n = int(A.rows()) / 2;
+
+    // a dense accumulator for one row at a time, and the columns it holds
+    vector<double> row(n, 0.0);
+    vector<int> used;
+
+    m_system.resize(n, n);
+    m_system.reserve(rows[n]);
+    for (int r = 0; r < n; ++r)
+    {
+        used.assign(1, r);
+        row[r] = 1.0;
+        for (int k = rows[r]; k < rows[r + 1]; ++k) {
+            int c = columns[k] < n ? columns[k] : columns[k] - n;
+            double scale = columns[k] < n ? dt : dt * dt;
+            if (row[c] == 0.0 && c != r) used.push_back(c);
+            row[c] -= scale * values[k];
+        }
+        sort(used.begin(), used.end());
+        used.erase(unique(used.begin(), used.end()), used.end());
+
+        m_system.startVec(r);
+        for (size_t k = 0; k < used.size(); ++k) {
+            m_system.insertBack(r, used[k]) = row[used[k]];
+            row[used[k]] = 0.0;
+        }
+    }
+    m_system.finalize();
+
+    m_gridMatches = m_solver.compute(m_system);
+    m_rhs.resize(n);
+    m_velocity.resize(n);
+}
+
+void MultigridImplicitEulerIntegrator::step()
+{
+    INTEGRATOR_TIME(stepSeconds);
+    INTEGRATOR_COUNT(steps, 1);
+
+    if (m_linearODE->matrixChanged() || (m_solver.levelCount() == 0 && m_gridMatches)) rebuild();
+    if (!m_gridMatches) {
+        m_time += m_timeStep;
+        return;
+    }
+
+    const MatrixType &A = m_linearODE->matrixA();
+    const double *values = A._valuePtr();
+    const int *columns = A._innerIndexPtr();
+    const int *rows = A._outerIndexPtr();
+    const StateType &b = m_linearODE->vectorB();
+    StateType &y = m_state;
+    double dt = m_timeStep;
+    int n = int(m_rhs.size());
+
+    // v + dt (Avx x + bv)
+    for (int r = 0; r < n; ++r) {
+        double sum = b[r];
+        for (int k = rows[r]; k < rows[r + 1]; ++k)
+            if (columns[k] >= n) sum += values[k] * y[columns[k]];
+        m_rhs[r] = y[r] + dt * sum;
+    }
+
+    m_velocity = y.head(n);
+    m_solver.solve(m_rhs, m_velocity);
+    INTEGRATOR_COUNT(solves, 1);
+    m_totalCycles += m_solver.lastCycles();
+
+    y.head(n) = m_velocity;
+    y.tail(n) += dt * m_velocity;
+    m_time += dt;
+}
+
+// --------------------------------------------------------------------------
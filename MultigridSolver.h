@@ -0,0 +1,141 @@
+#ifndef MULTIGRIDSOLVER_H
+#define MULTIGRIDSOLVER_H
+
+#include <vector>
+
+#ifndef EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
+#define EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
+#endif
+#include "Eigen/Core"
+#include "Eigen/LU"
+#include "Eigen/Sparse"
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// Geometric multigrid for a sparse system whose unknowns lie on a width by
+// height grid, numbered row by row, such as a spring lattice's nodes (a
+// chain is a 1 by n grid).  Each coarser grid keeps every other node in
+// each direction; residuals are restricted to it and corrections
+// interpolated back bilinearly, and its matrix is the Galerkin product
+// R A P, so varying stiffnesses carry over to every level.
+//
+// A V-cycle smooths with symmetric Gauss-Seidel on the way down and up and
+// solves the coarsest grid directly.  Its cost is linear in the number of
+// unknowns, and the number of cycles to a given accuracy does not grow
+// with the grid, so a solve costs O(n) however fine the grid is.
+
+class MultigridSolver
+{
+public:
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor> MatrixType;
+    typedef Eigen::VectorXd VectorType;
+
+private:
+    struct Level
+    {
+        int         width, height;
+        MatrixType  matrix;
+        MatrixType  restriction;    // from this level to the next coarser one
+        MatrixType  prolongation;   // from the next coarser one to this
+        VectorType  inverseDiagonal;
+        VectorType  rhs, solution, residual;
+    };
+
+    std::vector<Level>              m_levels;
+    Eigen::PartialPivLU<Eigen::MatrixXd>   m_coarsest;
+    int         m_width, m_height;
+    int         m_smoothing;
+    int         m_maxCycles;
+    double      m_tolerance;
+    int         m_lastCycles;
+    double      m_lastResidual;
+
+    void vCycle(int level);
+    void smooth(const Level &level, bool forward, VectorType &x) const;
+    void computeResidual(const Level &level, const VectorType &x, VectorType &r) const;
+
+public:
+    MultigridSolver();
+
+    // the grid the unknowns lie on; width * height must equal the size of
+    // the matrix given to compute()
+    void setGrid(int width, int height);
+
+    // Gauss-Seidel sweeps before and after each coarse correction
+    void setSmoothing(int sweeps)           { m_smoothing = sweeps; }
+
+    // solve() stops when the residual norm falls below tolerance times
+    // that of the right hand side, or after the given number of cycles
+    void setTolerance(double tolerance)     { m_tolerance = tolerance; }
+    void setMaxCycles(int cycles)           { m_maxCycles = cycles; }
+
+    // Builds the hierarchy for A; must be called again whenever A changes.
+    // Allocates, unlike solve().  Returns false, leaving no hierarchy, if A
+    // is not square with width * height rows.
+    bool compute(const MatrixType &A);
+
+    int levelCount() const                  { return int(m_levels.size()); }
+
+    // Solves A x = b, improving on the x it is given; returns false if the
+    // tolerance was not met, or there is no hierarchy to solve with.
+    bool solve(const VectorType &b, VectorType &x);
+
+    int lastCycles() const                  { return m_lastCycles; }
+    double lastResidual() const             { return m_lastResidual; }
+};
+
+// --------------------------------------------------------------------------
+
+// Implicit Euler for a second order system written as a first order one,
+// with the velocities first and then the positions, y = [v; x], and
+// x' = v, as SimpleSpring, SpringChain and SpringNetwork are:
+//
+//      A = [ Avv  Avx ]        b = [ bv ]
+//          [  I    0  ]            [  0 ]
+//
+// Substituting x(t + dt) = x + dt v(t + dt) leaves one system for the new
+// velocities,
+//
+//      (I - dt Avv - dt^2 Avx) v(t + dt) = v + dt (Avx x + bv),
+//
+// half the size, which MultigridSolver solves starting from the current
+// velocities.  The solver's hierarchy is rebuilt when the time step or the
+// ODE's matrix changes.  If the grid does not match the ODE's size,
+// gridMatches() is false and steps leave the state as it was.
+
+class MultigridImplicitEulerIntegrator : public Integrator<Eigen::VectorXd>
+{
+public:
+    typedef Eigen::VectorXd StateType;
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor> MatrixType;
+
+private:
+    LinearODE<StateType, MatrixType>   *m_linearODE;
+    MultigridSolver     m_solver;
+    MatrixType          m_system;
+    StateType           m_rhs;
+    StateType           m_velocity;
+    long long           m_totalCycles;
+    bool                m_gridMatches;
+
+    void rebuild();
+
+public:
+    MultigridImplicitEulerIntegrator(LinearODE<StateType, MatrixType> *ode, double dt,
+                                     int width, int height);
+
+    void bind(LinearODE<StateType, MatrixType> *ode);
+
+    MultigridSolver &solver()               { return m_solver; }
+    const MatrixType &system() const        { return m_system; }
+    long long totalCycles() const           { return m_totalCycles; }
+    bool gridMatches() const                { return m_gridMatches; }
+
+    virtual void setTimeStep(double dt);
+    virtual void step();
+};
+
+// --------------------------------------------------------------------------
+
+#endif // MULTIGRIDSOLVER_H
@@ -0,0 +1,214 @@
+#include "MultirateIntegrator.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+MultirateIntegrator::MultirateIntegrator(SpringNetwork *network, double dt,
+                                         double fastStiffness, int substeps)
+    : Integrator<StateType>(network, dt), m_network(network),
+      m_fastStiffness(fastStiffness), m_substeps(substeps < 1 ? 1 : substeps)
+{}
+
+void MultirateIntegrator::bind(SpringNetwork *network)
+{
+    Integrator<StateType>::bind(network);
+    m_network = network;
+    m_inverseMasses.clear();
+}
+
+void MultirateIntegrator::setFastStiffness(double stiffness)
+{
+    m_fastStiffness = stiffness;
+    m_inverseMasses.clear();
+}
+
+void MultirateIntegrator::partition()
+{
+    const SpringNetwork &network = *m_network;
+    int n = network.nodeCount();
+
+    m_inverseMasses.resize(n);
+    for (int i = 0; i < n; ++i) m_inverseMasses[network.row(i)] = 1.0 / network.mass(i);
+
+    // the fast group: every node a stiff spring touches
+    vector<int> fastIndex(n, -1);
+    m_fastRows.clear();
+    for (int e = 0; e < network.edgeCount(); ++e)
+    {
+        const SpringNetworkEdge &edge = network.edge(e);
+        if (edge.stiffness < m_fastStiffness) continue;
+        int ends[2] = { edge.from, edge.to };
+        for (int k = 0; k < 2; ++k) {
+            if (ends[k] == SpringNetwork::Ground) continue;
+            int r = network.row(ends[k]);
+            if (fastIndex[r] < 0) {
+                fastIndex[r] = int(m_fastRows.size());
+                m_fastRows.push_back(r);
+            }
+        }
+    }
+    m_slowRows.clear();
+    for (int r = 0; r < n; ++r)
+        if (fastIndex[r] < 0) m_slowRows.push_back(r);
+
+    m_fastInverseMasses.resize(m_fastRows.size());
+    for (size_t k = 0; k < m_fastRows.size(); ++k)
+        m_fastInverseMasses[k] = m_inverseMasses[m_fastRows[k]];
+
+    // springs within the fast group are fast, even soft ones; those with
+    // one end in it couple the groups, and are numbered from that end
+    m_slowSprings.clear();
+    m_fastSprings.clear();
+    m_couplingSprings.clear();
+    for (int e = 0; e < network.edgeCount(); ++e)
+    {
+        const SpringNetworkEdge &edge = network.edge(e);
+        Spring s = { edge.from == SpringNetwork::Ground ? -1 : network.row(edge.from),
+                     network.row(edge.to), edge.stiffness, edge.damping, edge.length, 1.0 };
+        bool fastFrom = s.a >= 0 && fastIndex[s.a] >= 0, fastTo = fastIndex[s.b] >= 0;
+        if (fastTo && (s.a < 0 || fastFrom)) {
+            s.a = s.a < 0 ? -1 : fastIndex[s.a];
+            s.b = fastIndex[s.b];
+            m_fastSprings.push_back(s);
+        }
+        else if (fastTo) {
+            s.b = fastIndex[s.b];
+            m_couplingSprings.push_back(s);
+        }
+        else if (fastFrom) {
+            s.a = network.row(edge.to);
+            s.b = fastIndex[network.row(edge.from)];
+            s.sign = -1.0;
+            m_couplingSprings.push_back(s);
+        }
+        else m_slowSprings.push_back(s);
+    }
+
+    int fast = int(m_fastRows.size());
+    m_acceleration.resize(n);
+    m_fast.resize(2 * fast);
+    m_k1.resize(2 * fast);
+    m_k2.resize(2 * fast);
+    m_k3.resize(2 * fast);
+    m_k4.resize(2 * fast);
+    m_stage.resize(2 * fast);
+}
+
+// v += h (g + spring forces / m), over the slow group
+void MultirateIntegrator::kick(double h)
+{
+    INTEGRATOR_COUNT(evaluations, 1);
+
+    StateType &y = m_state;
+    int n = int(m_acceleration.size());
+    m_acceleration.setConstant(m_network->gravity());
+
+    for (size_t e = 0; e < m_slowSprings.size(); ++e)
+    {
+        const Spring &s = m_slowSprings[e];
+        double stretch = y[n + s.b] - s.length, relative = y[s.b];
+        if (s.a >= 0) {
+            stretch -= y[n + s.a];
+            relative -= y[s.a];
+        }
+        double f = -s.stiffness * stretch - s.damping * relative;
+        m_acceleration[s.b] += f * m_inverseMasses[s.b];
+        if (s.a >= 0) m_acceleration[s.a] -= f * m_inverseMasses[s.a];
+    }
+    for (size_t e = 0; e < m_couplingSprings.size(); ++e)
+    {
+        const Spring &s = m_couplingSprings[e];
+        if (s.a < 0) continue;
+        int b = m_fastRows[s.b];
+        double stretch = s.sign * (y[n + b] - y[n + s.a]) - s.length;
+        double f = -s.stiffness * stretch - s.damping * s.sign * (y[b] - y[s.a]);
+        m_acceleration[s.a] -= s.sign * f * m_inverseMasses[s.a];
+    }
+
+    for (size_t k = 0; k < m_slowRows.size(); ++k)
+        y[m_slowRows[k]] += h * m_acceleration[m_slowRows[k]];
+}
+
+// the accelerations and x' = v over the fast group, with the slow group
+// lag behind where it has drifted to by the end of the step
+void MultirateIntegrator::fastDerivative(const StateType &y, double lag, StateType &dy) const
+{
+    const StateType &slow = m_state;
+    int n = int(m_acceleration.size()), fast = int(m_fastRows.size());
+    dy.head(fast).setConstant(m_network->gravity());
+    for (size_t e = 0; e < m_fastSprings.size(); ++e)
+    {
+        const Spring &s = m_fastSprings[e];
+        double stretch = y[fast + s.b] - s.length, relative = y[s.b];
+        if (s.a >= 0) {
+            stretch -= y[fast + s.a];
+            relative -= y[s.a];
+        }
+        double f = -s.stiffness * stretch - s.damping * relative;
+        dy[s.b] += f * m_fastInverseMasses[s.b];
+        if (s.a >= 0) dy[s.a] -= f * m_fastInverseMasses[s.a];
+    }
+    for (size_t e = 0; e < m_couplingSprings.size(); ++e)
+    {
+        const Spring &s = m_couplingSprings[e];
+        double x = 0.0, v = 0.0;
+        if (s.a >= 0) {
+            v = slow[s.a];
+            x = slow[n + s.a] - lag * v;
+        }
+        double stretch = s.sign * (y[fast + s.b] - x) - s.length;
+        double f = -s.stiffness * stretch - s.damping * s.sign * (y[s.b] - v);
+        dy[s.b] += s.sign * f * m_fastInverseMasses[s.b];
+    }
+    dy.tail(fast) = y.head(fast);
+}
+
+void MultirateIntegrator::step()
+{
+    INTEGRATOR_TIME(stepSeconds);
+    INTEGRATOR_COUNT(steps, 1);
+
+    if (m_network->matrixChanged() || m_inverseMasses.empty()) partition();
+
+    StateType &y = m_state;
+    double dt = m_timeStep, h = dt / m_substeps;
+    int n = int(m_acceleration.size()), fast = int(m_fastRows.size());
+
+    kick(0.5 * dt);
+
+    // the slow group feels no fast force, so it drifts exactly, and the
+    // fast group reads it at each stage from the end of the drift
+    for (size_t k = 0; k < m_slowRows.size(); ++k)
+        y[n + m_slowRows[k]] += dt * y[m_slowRows[k]];
+
+    if (fast > 0)
+    {
+        for (int k = 0; k < fast; ++k) {
+            m_fast[k] = y[m_fastRows[k]];
+            m_fast[fast + k] = y[n + m_fastRows[k]];
+        }
+        for (int s = 0; s < m_substeps; ++s)
+        {
+            double lag = dt - s * h;
+            fastDerivative(m_fast, lag, m_k1);
+            m_stage = m_fast + 0.5*h * m_k1;
+            fastDerivative(m_stage, lag - 0.5*h, m_k2);
+            m_stage = m_fast + 0.5*h * m_k2;
+            fastDerivative(m_stage, lag - 0.5*h, m_k3);
+            m_stage = m_fast + h * m_k3;
+            fastDerivative(m_stage, lag - h, m_k4);
+            m_fast += h/6.0 * (m_k1 + 2.0*m_k2 + 2.0*m_k3 + m_k4);
+        }
+        for (int k = 0; k < fast; ++k) {
+            y[m_fastRows[k]] = m_fast[k];
+            y[n + m_fastRows[k]] = m_fast[fast + k];
+        }
+    }
+
+    kick(0.5 * dt);
+    m_time += dt;
+}
+
+// --------------------------------------------------------------------------
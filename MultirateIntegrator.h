@@ -0,0 +1,88 @@
+#ifndef MULTIRATEINTEGRATOR_H
+#define MULTIRATEINTEGRATOR_H
+
+#include <vector>
+
+#include "Eigen/Core"
+#include "Integrators.h"
+#include "SpringNetwork.h"
+
+// --------------------------------------------------------------------------
+
+// Multirate integration of a SpringNetwork whose springs differ widely in
+// stiffness, after r-RESPA (Tuckerman, Berne and Martyna, "Reversible
+// multiple time scale molecular dynamics").  The springs at or above a
+// stiffness threshold are fast, and the nodes they join form the fast
+// group; the other nodes form the slow group.  Each step is split
+// symmetrically:
+//
+//      half a step of the forces on the slow group, as a kick;
+//      the slow group drifts at its velocities, while the fast group is
+//      stepped by RK4 in substeps under every force on it, reading the
+//      slow nodes it is joined to where they have drifted to;
+//      the other half step of the forces on the slow group.
+//
+// The fast group is never kicked, which would set its stiff springs
+// ringing and, at some ratios of the step to their periods, resonating.
+// The slow forces are evaluated twice a step and the substeps touch only
+// the fast group and the springs on it, so a few stiff springs in a large
+// soft network cost little more than the soft network alone.
+//
+// The integrator rebuilds its split when the network's matrix changes.
+
+class MultirateIntegrator : public Integrator<Eigen::VectorXd>
+{
+public:
+    typedef Eigen::VectorXd StateType;
+
+private:
+    // a spring between two rows of the state (slow), two entries of the
+    // fast group (fast), or a row and an entry (coupling, b is the entry);
+    // a is negative for the ground
+    struct Spring
+    {
+        int     a, b;
+        double  stiffness;
+        double  damping;
+        double  length;
+        double  sign;                           // of b's end, from to
+    };
+
+    SpringNetwork      *m_network;
+    double              m_fastStiffness;
+    int                 m_substeps;
+
+    std::vector<Spring> m_slowSprings, m_fastSprings, m_couplingSprings;
+    std::vector<double> m_inverseMasses;        // per row
+    std::vector<int>    m_fastRows, m_slowRows;
+    std::vector<double> m_fastInverseMasses;
+
+    StateType   m_acceleration;
+    StateType   m_fast;                         // [v; x] of the fast group
+    StateType   m_k1, m_k2, m_k3, m_k4, m_stage;
+
+    void partition();
+    void kick(double h);
+    void fastDerivative(const StateType &y, double lag, StateType &dy) const;
+
+public:
+    // springs of at least fastStiffness are substepped substeps times a step
+    MultirateIntegrator(SpringNetwork *network, double dt, double fastStiffness,
+                        int substeps);
+
+    void bind(SpringNetwork *network);
+
+    void setFastStiffness(double stiffness);
+    void setSubsteps(int substeps)          { m_substeps = substeps < 1 ? 1 : substeps; }
+    double fastStiffness() const            { return m_fastStiffness; }
+    int substeps() const                    { return m_substeps; }
+
+    int fastNodeCount() const               { return int(m_fastRows.size()); }
+    int fastSpringCount() const             { return int(m_fastSprings.size()); }
+
+    virtual void step();
+};
+
+// --------------------------------------------------------------------------
+
+#endif // MULTIRATEINTEGRATOR_H
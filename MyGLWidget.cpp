@@ -10,6 +10,7 @@
 
 #include "MyGLWidget.h"
 #include <QtGui>
+#include "Trace.h"
 #include <complex>
 #include <cstdlib>
 #include <ctime>
@@ -31,6 +32,19 @@ MyGLWidget::MyGLWidget(const QGLFormat &format, QWidget *parent,
 
     m_integrating = false;
 
+    m_timeWarp = 1.0;
+    m_fastForward = false;
+    m_renderInterval = 100;
+    m_barrier = 0;
+    m_simulatedTime = m_lastSimulatedTime = 0.0;
+
+    // start with one spring for each integrator until a scene is loaded
+    m_scene.createDefault();
+    m_tuner.setCacheFile(QDir::homePath().toStdString() + "/.integrator-tuning.cache");
+    m_scene.setAutoTuner(&m_tuner);
+    m_selectedSpring = -1;
+    m_producer = 0;
+
     m_juliaX = Vector2f(-1.5f, .5f);
     m_juliaY = Vector2f(-1.f, 1.f);
 
@@ -47,6 +61,13 @@ MyGLWidget::MyGLWidget(const QGLFormat &format, QWidget *parent,
     setMinimumSize(800, 600);
 }
 
+MyGLWidget::~MyGLWidget()
+{
+    // the workers must not outlive the scene they are integrating
+    stopWorkers();
+    stopRecording();
+}
+
 // --------------------------------------------------------------------------
 
 void MyGLWidget::initializeGL()
@@ -84,20 +105,6 @@ void MyGLWidget::initializeGL()
     connect(&m_animation, SIGNAL(finished()), this, SLOT(restartAnimation()));
     m_animation.start();
 
-    // set parameters for spring simulations
-    for (int i = 0; i < k_springCount; ++i) {
-        m_springs[i].setStiffness(200.0);
-        m_springs[i].setDamping(1.0);
-        m_springs[i].setInitialPosition(.25);
-    }
-    double dt = 0.005;
-    m_springs[0].setIntegrator(new ExplicitEulerIntegrator<SimpleSpring::StateType>(&m_springs[0], dt));
-    m_springs[1].setIntegrator(new ModifiedMidpointIntegrator<SimpleSpring::StateType>(&m_springs[1], dt));
-    m_springs[2].setIntegrator(new RungeKutta4Integrator<SimpleSpring::StateType>(&m_springs[2], dt));
-    m_springs[3].setIntegrator(new ImplicitEulerIntegrator<SimpleSpring::StateType,
-                               SimpleSpring::MatrixType>(&m_springs[3], dt));
-    resetSprings();
-
     // start a timer with 15ms period (roughly 60 fps)
     startTimer(15);
 }
@@ -106,6 +113,8 @@ void MyGLWidget::initializeGL()
 
 void MyGLWidget::paintGL()
 {
+    TRACE_ZONE("paintGL");
+
     glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -157,15 +166,19 @@ void MyGLWidget::paintGL()
         m_trackball.setCameraOrientation(m_camera.orientation3x3());
         m_trackball.applyTransform();
 
+        // colour each spring by its integrator type, and only draw the
+        // first few of them if the scene is large
         Vector3f colours[] = {
             Vector3f( .8f, .2f, .2f ),
             Vector3f( .2f, .8f, .2f ),
             Vector3f( .2f, .2f, .8f ),
-            Vector3f( .7f, .7f, .2f )
+            Vector3f( .7f, .7f, .2f ),
+            Vector3f( .7f, .2f, .7f )
         };
-        glTranslatef(-0.9f, 0.f, 0.f);
-        for (int i = 0; i < 4; ++i) {
-            drawSpringSystem(m_springs[i], colours[i]);
+        int drawn = min(m_scene.size(), int(k_maxDrawnSprings));
+        glTranslatef(-.3f * (drawn - 1), 0.f, 0.f);
+        for (int i = 0; i < drawn; ++i) {
+            drawSpringSystem(springPosition(i), colours[m_scene.integratorType(i)]);
             glTranslatef(.6f, 0.f, 0.f);
         }
     glPopMatrix();
@@ -203,6 +216,8 @@ void MyGLWidget::resizeGL(int width, int height)
 
 void MyGLWidget::timerEvent(QTimerEvent *event)
 {
+    TRACE_ZONE("timerEvent");
+
     static int fdelta = 0, frames = 0;
     static QTime last = QTime::currentTime();
 
@@ -211,11 +226,13 @@ void MyGLWidget::timerEvent(QTimerEvent *event)
     int delta_ms = last.msecsTo(current);
     last = current;
 
-    // update the simulations
-    if (m_integrating) {
-        double delta_t = min(double(delta_ms) / 1000.0, 0.1);
-        for (int i = 0; i < k_springCount; ++i)
-            m_springs[i].update(delta_t);
+    // update the simulations, unless worker threads are doing it for us
+    if (m_integrating && m_workers.isEmpty()) {
+        TRACE_ZONE("integrate");
+        double delta_t = min(double(delta_ms) / 1000.0, 0.1) * m_timeWarp;
+        m_scene.update(delta_t);
+        m_simulatedTime += delta_t;
+        recordStates();
     }
 
     // call updateGL to redraw the frame
@@ -225,11 +242,31 @@ void MyGLWidget::timerEvent(QTimerEvent *event)
     ++frames;
     fdelta += delta_ms;
     if (fdelta >= 1000) {
+        // report throughput as simulated seconds per wall-clock second
+        double simulated = simulatedTime();
+        double rate = (simulated - m_lastSimulatedTime) * 1000.0 / fdelta;
+        m_lastSimulatedTime = simulated;
+
+        // and integrator work per second; the counters start over when
+        // springs are replaced, so a drop means a fresh start
+        IntegratorCounters work = counters();
+        if (work.steps < m_lastCounters.steps) m_lastCounters.reset();
+        double seconds = fdelta / 1000.0;
+        double evaluations = (work.evaluations - m_lastCounters.evaluations) / seconds;
+        double solves = (work.solves - m_lastCounters.solves) / seconds;
+        long long factorizations = work.factorizations - m_lastCounters.factorizations;
+        long long rejected = work.rejectedSteps - m_lastCounters.rejectedSteps;
+        m_lastCounters = work;
+
         m_fpsEstimate = frames;
         fdelta -= 1000;
         frames = 0;
         if (m_windowStatus)
-            m_windowStatus->showMessage(QString("FPS: %1").arg(m_fpsEstimate));
+            m_windowStatus->showMessage(
+                QString("FPS: %1    Simulation: %2 s/s    Evaluations: %3/s    "
+                        "Solves: %4/s    Factorizations: %5    Rejected: %6")
+                .arg(m_fpsEstimate).arg(rate, 0, 'g', 4).arg(evaluations, 0, 'g', 4)
+                .arg(solves, 0, 'g', 4).arg(factorizations).arg(rejected));
     }
 }
 
@@ -245,29 +282,218 @@ void MyGLWidget::restartAnimation()
 
 void MyGLWidget::resetSprings()
 {
-    for (int i = 0; i < k_springCount; ++i)
-        m_springs[i].reset();
+    bool running = stopWorkers();
+    m_scene.reset();
+    if (running) updateWorkers();
 }
 
 void MyGLWidget::stepSprings()
 {
-    for (int i = 0; i < k_springCount; ++i)
-        m_springs[i].update();
+    bool running = stopWorkers();
+    double dt = m_scene.maxTimeStep();
+    m_scene.update(dt);
+    m_simulatedTime += dt;
+    recordStates();
+    if (running) updateWorkers();
 }
 
-void MyGLWidget::setSpringParameter(int index, double value)
+void MyGLWidget::setRenderInterval(int n)
 {
-    for (int i = 0; i < k_springCount; ++i)
-    {
-        switch (index) {
-        case 0: m_springs[i].setMass(value);        break;
-        case 1: m_springs[i].setStiffness(value);   break;
-        case 2: m_springs[i].setDamping(value);     break;
-        case 3: m_springs[i].setGravity(value);     break;
-        case 4: m_springs[i].setTimeStep(value);    break;
-        default:                                    break;
+    m_renderInterval = n;
+    if (m_barrier) m_barrier->setRenderInterval(n);
+}
+
+double MyGLWidget::simulatedTime() const
+{
+    // the workers finish each frame together, but may not all have
+    // published it yet, so the scene is as far along as the slowest of them
+    double slowest = 0.0;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        double t = m_workers[i]->simulatedTime();
+        if (i == 0 || t < slowest) slowest = t;
+    }
+    return m_simulatedTime + slowest;
+}
+
+IntegratorCounters MyGLWidget::counters() const
+{
+    // the workers own their springs while running, so use their snapshots
+    if (m_workers.isEmpty()) return m_scene.counters();
+
+    IntegratorCounters total;
+    foreach (SimulationThread *worker, m_workers)
+        total += worker->counters();
+    return total;
+}
+
+void MyGLWidget::updateWorkers()
+{
+    bool run = m_integrating && m_fastForward;
+    if (!run) {
+        stopWorkers();
+        return;
+    }
+    if (!m_workers.isEmpty()) return;
+
+    // split the springs into contiguous ranges, one per worker thread
+    int count = m_scene.size();
+    int threads = min(QThread::idealThreadCount(), count);
+    if (threads < 1) return;
+    m_barrier = new SimulationBarrier(threads, m_renderInterval);
+    for (int t = 0; t < threads; ++t) {
+        int first = t * count / threads;
+        int last = (t + 1) * count / threads;
+        SimulationThread *worker = new SimulationThread(&m_scene, m_barrier, first, last);
+        if (m_recorder.isRecording()) {
+            // keep one producer per worker slot for the whole recording
+            while (m_workerProducers.size() <= t)
+                m_workerProducers.append(m_recorder.createProducer());
+            worker->setProducer(m_workerProducers[t], m_simulatedTime);
         }
+        m_workers.append(worker);
+    }
+    foreach (SimulationThread *worker, m_workers)
+        worker->start();
+}
+
+bool MyGLWidget::stopWorkers()
+{
+    if (m_workers.isEmpty()) return false;
+
+    // the workers stop together at the end of the frame they are in
+    m_barrier->requestStop();
+    foreach (SimulationThread *worker, m_workers)
+        worker->wait();
+
+    // fold the workers' progress back into the widget's simulated time
+    m_simulatedTime = simulatedTime();
+    qDeleteAll(m_workers);
+    m_workers.clear();
+    delete m_barrier;
+    m_barrier = 0;
+    return true;
+}
+
+double MyGLWidget::springPosition(int index) const
+{
+    foreach (SimulationThread *worker, m_workers)
+        if (index < worker->last()) return worker->position(index);
+    return m_scene.spring(index).currentState()[1];
+}
+
+void MyGLWidget::setSpringParameter(int index, double value)
+{
+    bool running = stopWorkers();
+    m_scene.setParameter(m_selectedSpring, SpringParameter(index), value);
+    if (running) updateWorkers();
+}
+
+void MyGLWidget::setSelectedSpring(int index)
+{
+    m_selectedSpring = index < m_scene.size() ? index : -1;
+}
+
+bool MyGLWidget::startRecording(const QString &filename)
+{
+    bool running = stopWorkers();
+    stopRecording();
+
+    string error;
+    bool started = m_recorder.start(filename.toStdString(), SpringScene::StateType::SizeAtCompileTime, &error);
+    if (started) {
+        m_producer = m_recorder.createProducer();
+        recordStates();
     }
+    else
+        QMessageBox::critical(this, tr("Recording Error"), QString::fromStdString(error));
+
+    if (running) updateWorkers();
+    return started;
+}
+
+void MyGLWidget::stopRecording()
+{
+    if (!m_recorder.isRecording()) return;
+
+    // producers are owned by the recorder, so the workers must let go first
+    bool running = stopWorkers();
+    string error;
+    if (!m_recorder.stop(&error))
+        QMessageBox::critical(this, tr("Recording Error"), QString::fromStdString(error));
+    m_producer = 0;
+    m_workerProducers.clear();
+    if (running) updateWorkers();
+}
+
+void MyGLWidget::recordStates()
+{
+    if (!m_producer) return;
+    for (int i = 0; i < m_scene.size(); ++i)
+        m_producer->record(m_simulatedTime, i, m_scene.spring(i).currentState());
+}
+
+bool MyGLWidget::saveCheckpoint(const QString &filename)
+{
+    bool running = stopWorkers();
+
+    string error;
+    bool saved = m_scene.saveCheckpoint(filename.toStdString(), &error);
+    if (!saved)
+        QMessageBox::critical(this, tr("Checkpoint Error"), QString::fromStdString(error));
+
+    if (running) updateWorkers();
+    return saved;
+}
+
+bool MyGLWidget::saveCounters(const QString &filename)
+{
+    bool running = stopWorkers();
+
+    string error;
+    bool saved = m_scene.writeCounters(filename.toStdString(), &error);
+    if (!saved)
+        QMessageBox::critical(this, tr("Counters Error"), QString::fromStdString(error));
+
+    if (running) updateWorkers();
+    return saved;
+}
+
+bool MyGLWidget::restoreCheckpoint(const QString &filename)
+{
+    bool running = stopWorkers();
+
+    string error;
+    bool restored = m_scene.restoreCheckpoint(filename.toStdString(), &error);
+    if (!restored) {
+        QMessageBox::critical(this, tr("Checkpoint Error"),
+                              QString("Could not restore checkpoint from %1:\n%2")
+                              .arg(filename).arg(QString::fromStdString(error)));
+        m_scene.createDefault();
+    }
+    m_selectedSpring = -1;
+
+    if (running) updateWorkers();
+    return restored;
+}
+
+bool MyGLWidget::loadScene(const QString &filename)
+{
+    bool running = stopWorkers();
+
+    string error;
+    bool loaded = m_scene.load(filename.toStdString(), &error);
+    if (!loaded) {
+        QMessageBox::critical(this, tr("Scene Load Error"),
+                              QString("Could not load scene from %1:\n%2")
+                              .arg(filename).arg(QString::fromStdString(error)));
+        m_scene.createDefault();
+    }
+    else if (!m_tuner.flush(&error))
+        QMessageBox::warning(this, tr("Tuning Cache Error"), QString::fromStdString(error));
+    m_selectedSpring = -1;
+
+    if (running) updateWorkers();
+    return loaded;
 }
 
 // --------------------------------------------------------------------------
@@ -340,9 +566,9 @@ void MyGLWidget::wheelEvent(QWheelEvent *event)
 
 // --------------------------------------------------------------------------
 
-void MyGLWidget::drawSpringSystem(const SimpleSpring &spring, const Vector3f &colour)
+void MyGLWidget::drawSpringSystem(double y, const Vector3f &colour)
 {
-    double y = spring.currentState()[1];
+    TRACE_ZONE("drawSpringSystem");
 
     // draw torii for springs
     double a = y + 0.2;
@@ -369,6 +595,8 @@ void MyGLWidget::drawSpringSystem(const SimpleSpring &spring, const Vector3f &co
 
 void MyGLWidget::drawSkyBox()
 {
+    TRACE_ZONE("drawSkyBox");
+
     glPushAttrib(GL_ENABLE_BIT);
     
     glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_NORMAL_MAP);
@@ -26,7 +26,9 @@
 
 #include "CSphericalCamera.h"
 #include "CTrackball.h"
-#include "SimpleSpring.h"
+#include "SpringScene.h"
+#include "SimulationThread.h"
+#include "AutoTuner.h"
 
 // --------------------------------------------------------------------------
 
@@ -44,10 +46,28 @@ class MyGLWidget : public QGLWidget
     bool                m_flying, m_tracking, m_metaKey;
 
     // our spring systems
-    static const int    k_springCount = 4;
-    SimpleSpring        m_springs[k_springCount];
+    static const int    k_maxDrawnSprings = 8;
+    SpringScene         m_scene;
+    int                 m_selectedSpring;
+    AutoTuner           m_tuner;        // for scenes with "integrator=auto"
     bool                m_integrating;
 
+    // time warp and as-fast-as-possible execution
+    double              m_timeWarp;
+    bool                m_fastForward;
+    int                 m_renderInterval;
+    QList<SimulationThread *> m_workers;
+    SimulationBarrier  *m_barrier;      // keeps the workers at the same frame
+    double              m_simulatedTime, m_lastSimulatedTime;
+
+    // integrator work at the last status bar update, for reporting rates
+    IntegratorCounters  m_lastCounters;
+
+    // trajectory recording, with one producer for this thread and one for
+    // each fast-forward worker
+    TrajectoryRecorder  m_recorder;
+    TrajectoryRecorder::Producer *m_producer;
+    QList<TrajectoryRecorder::Producer *> m_workerProducers;
 
     Eigen::Vector2f     m_juliaX, m_juliaY;
     QPointF             m_juliaCoord;
@@ -65,6 +85,7 @@ class MyGLWidget : public QGLWidget
 public:
     MyGLWidget(const QGLFormat & format, QWidget *parent = 0, 
                const QGLWidget *shareWidget = 0, Qt::WindowFlags f = 0);
+    virtual ~MyGLWidget();
 
     void setWindowStatusBar(QStatusBar *statusBar)  { m_windowStatus = statusBar; }
 
@@ -74,15 +95,47 @@ public:
     QPointF juliaCoord() const                      { return m_juliaCoord; }
     void setJuliaCoord(const QPointF &c)            { m_juliaCoord = c; }
 
+    // Changes a parameter (in the order of SpringParameter) of the selected
+    // spring, or of every spring if none is selected.
     void setSpringParameter(int index, double value);
 
+    // Replaces the scene with one read from a scene file, falling back to the
+    // default scene if the file can't be loaded.
+    bool loadScene(const QString &filename);
+
+    // Saves the full simulation state to a binary checkpoint, or restores
+    // one, so that an experiment can be resumed where it left off.
+    bool saveCheckpoint(const QString &filename);
+    bool restoreCheckpoint(const QString &filename);
+
+    // Writes the work counters of every spring's integrator as CSV.
+    bool saveCounters(const QString &filename);
+
+    // Records the state of every spring to a trajectory file each time it
+    // is drawn, until stopRecording() is called.
+    bool startRecording(const QString &filename);
+    void stopRecording();
+    bool isRecording() const                        { return m_recorder.isRecording(); }
+    int springCount() const                         { return m_scene.size(); }
+
+    // simulated time including whatever the fast-forward workers have done
+    double simulatedTime() const;
+
+    // integrator work summed over all springs, including the workers' share
+    IntegratorCounters counters() const;
+
 public slots:
     // Gets called when the animation finishes, and restarts it with a new target.
     void restartAnimation();
 
     void resetSprings();
     void stepSprings();
-    void setIntegrating(bool i)                     { m_integrating = i; }
+    void setIntegrating(bool i)                     { m_integrating = i; updateWorkers(); }
+
+    void setTimeWarp(double k)                      { m_timeWarp = k; }
+    void setFastForward(bool f)                     { m_fastForward = f; updateWorkers(); }
+    void setRenderInterval(int n);
+    void setSelectedSpring(int index);
 
 protected:
 
@@ -107,7 +160,19 @@ protected:
     virtual void wheelEvent(QWheelEvent *event);
 
 
-    void drawSpringSystem(const SimpleSpring &spring,
+    // Starts or stops the fast-forward worker threads to match the current
+    // integrating and fast-forward flags.  stopWorkers() returns whether any
+    // were running, so callers can pause them around changes to the springs.
+    void updateWorkers();
+    bool stopWorkers();
+
+    // Position of a spring's mass, read from the worker snapshots if the
+    // springs are currently owned by fast-forward threads.
+    double springPosition(int index) const;
+
+    void recordStates();
+
+    void drawSpringSystem(double position,
                           const Eigen::Vector3f &colour = Eigen::Vector3f(0,0,0));
 
     void drawSkyBox();
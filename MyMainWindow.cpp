@@ -9,6 +9,7 @@
 
 #include "MyMainWindow.h"
 #include <QtGui>
+#include "Trace.h"
 
 // --------------------------------------------------------------------------
 
@@ -94,10 +95,40 @@ QWidget *MyMainWindow::createControlPanel()
     buttonLayout->addWidget(stepButton);
     buttonLayout->addWidget(resetButton);
 
+    // execution speed controls: time warp for k times real time, or an
+    // as-fast-as-possible mode that integrates on worker threads and only
+    // renders the state published every N steps
+    QGroupBox *executionBox = new QGroupBox("Execution");
+    QFormLayout *executionLayout = new QFormLayout(executionBox);
+
+    QDoubleSpinBox *warpSpinner = createParameterSpinner(executionLayout, "Time warp",
+                                                         1.0, 0.1, 1000.0, 1, " x");
+    warpSpinner->setSingleStep(1.0);
+    connect(warpSpinner, SIGNAL(valueChanged(double)), m_openGLView, SLOT(setTimeWarp(double)));
+
+    QCheckBox *fastCheck = new QCheckBox("As fast as possible");
+    executionLayout->addRow(fastCheck);
+    connect(fastCheck, SIGNAL(toggled(bool)), m_openGLView, SLOT(setFastForward(bool)));
+    connect(fastCheck, SIGNAL(toggled(bool)), warpSpinner, SLOT(setDisabled(bool)));
+
+    QSpinBox *intervalSpinner = new QSpinBox;
+    intervalSpinner->setRange(1, 1000000);
+    intervalSpinner->setValue(100);
+    intervalSpinner->setSuffix(" steps");
+    executionLayout->addRow("Render every", intervalSpinner);
+    connect(intervalSpinner, SIGNAL(valueChanged(int)), m_openGLView, SLOT(setRenderInterval(int)));
+
     // the parameters group box
     QGroupBox *parametersBox = new QGroupBox("Parameters");
     QFormLayout *parametersLayout = new QFormLayout(parametersBox);
 
+    // parameter changes apply to the selected spring, or to all of them
+    m_springSelector = new QSpinBox;
+    m_springSelector->setSpecialValueText("All");
+    parametersLayout->addRow("Spring", m_springSelector);
+    connect(m_springSelector, SIGNAL(valueChanged(int)), m_openGLView, SLOT(setSelectedSpring(int)));
+    updateSpringSelector();
+
     m_spinners.append(createParameterSpinner(parametersLayout, "Mass", 1.0, 0.1, 10.0, 1, " kg"));
     m_spinners.append(createParameterSpinner(parametersLayout, "Stiffness", 100.0, 10.0, 5000.0, 0, " N/m"));
     m_spinners.append(createParameterSpinner(parametersLayout, "Damping", 1.0, 0.0, 100.0, 1, " Ns/m"));
@@ -113,12 +144,89 @@ QWidget *MyMainWindow::createControlPanel()
     QWidget *widget = new QWidget;
     QBoxLayout *widgetLayout = new QVBoxLayout(widget);
     widgetLayout->addWidget(parametersBox);
+    widgetLayout->addWidget(executionBox);
     widgetLayout->addStretch(2);
     widgetLayout->addLayout(buttonLayout);
 
     return widget;
 }
 
+void MyMainWindow::updateSpringSelector()
+{
+    m_springSelector->setRange(-1, m_openGLView->springCount() - 1);
+    m_springSelector->setValue(-1);
+}
+
+bool MyMainWindow::loadScene(const QString &filename)
+{
+    bool loaded = m_openGLView->loadScene(filename);
+    updateSpringSelector();
+    return loaded;
+}
+
+void MyMainWindow::openScene()
+{
+    QString filename = QFileDialog::getOpenFileName(this, tr("Open Scene"), QString(),
+                                                    tr("Scene files (*.scene);;All files (*)"));
+    if (!filename.isEmpty()) loadScene(filename);
+}
+
+void MyMainWindow::saveCheckpoint()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Checkpoint"), QString(),
+                                                    tr("Checkpoints (*.ckpt);;All files (*)"));
+    if (!filename.isEmpty()) m_openGLView->saveCheckpoint(filename);
+}
+
+void MyMainWindow::restoreCheckpoint()
+{
+    QString filename = QFileDialog::getOpenFileName(this, tr("Restore Checkpoint"), QString(),
+                                                    tr("Checkpoints (*.ckpt);;All files (*)"));
+    if (!filename.isEmpty()) {
+        m_openGLView->restoreCheckpoint(filename);
+        updateSpringSelector();
+    }
+}
+
+void MyMainWindow::saveCounters()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Integrator Counters"), QString(),
+                                                    tr("CSV files (*.csv);;All files (*)"));
+    if (!filename.isEmpty()) m_openGLView->saveCounters(filename);
+}
+
+void MyMainWindow::setRecording(bool recording)
+{
+    if (!recording) {
+        m_openGLView->stopRecording();
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Record Trajectory"), QString(),
+                                                    tr("Trajectories (*.traj);;All files (*)"));
+    if (filename.isEmpty() || !m_openGLView->startRecording(filename)) {
+        // leave the menu item unchecked if recording didn't start
+        QAction *action = qobject_cast<QAction *>(sender());
+        if (action) action->setChecked(false);
+    }
+}
+
+void MyMainWindow::setTracing(bool tracing)
+{
+    if (tracing) {
+        Trace::setEnabled(true);
+        return;
+    }
+
+    // stop collecting before asking where to save, so the trace ends here
+    Trace::setEnabled(false);
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Trace"), QString(),
+                                                    tr("Chrome traces (*.json);;All files (*)"));
+    std::string error;
+    if (!filename.isEmpty() && !Trace::writeChromeTrace(filename.toStdString(), &error))
+        QMessageBox::critical(this, tr("Trace Error"), QString::fromStdString(error));
+}
+
 void MyMainWindow::parameterChanged(double newValue)
 {
     int i = m_spinners.indexOf(dynamic_cast<QDoubleSpinBox *>(sender()));
@@ -131,6 +239,21 @@ void MyMainWindow::createMenus()
 {
     // file menu
     QMenu *fileMenu = m_menuBar->addMenu(tr("&File"));
+    QAction *actionOpen = fileMenu->addAction(tr("&Open Scene..."));
+    connect(actionOpen, SIGNAL(triggered()), this, SLOT(openScene()));
+    QAction *actionSave = fileMenu->addAction(tr("&Save Checkpoint..."));
+    connect(actionSave, SIGNAL(triggered()), this, SLOT(saveCheckpoint()));
+    QAction *actionRestore = fileMenu->addAction(tr("&Restore Checkpoint..."));
+    connect(actionRestore, SIGNAL(triggered()), this, SLOT(restoreCheckpoint()));
+    QAction *actionCounters = fileMenu->addAction(tr("Save Integrator &Counters..."));
+    connect(actionCounters, SIGNAL(triggered()), this, SLOT(saveCounters()));
+    QAction *actionRecord = fileMenu->addAction(tr("Record &Trajectory..."));
+    actionRecord->setCheckable(true);
+    connect(actionRecord, SIGNAL(toggled(bool)), this, SLOT(setRecording(bool)));
+    QAction *actionTrace = fileMenu->addAction(tr("Capture Tr&ace"));
+    actionTrace->setCheckable(true);
+    connect(actionTrace, SIGNAL(toggled(bool)), this, SLOT(setTracing(bool)));
+    fileMenu->addSeparator();
     QAction *actionExit = fileMenu->addAction(tr("E&xit"));
     connect(actionExit, SIGNAL(triggered()), qApp, SLOT(closeAllWindows()));
 
@@ -14,6 +14,7 @@
 #include <QSignalMapper>
 #include <QPushButton>
 #include <QDoubleSpinBox>
+#include <QSpinBox>
 #include "MyGLWidget.h"
 
 class MyMainWindow : public QMainWindow
@@ -27,16 +28,26 @@ class MyMainWindow : public QMainWindow
 
     QPushButton     *m_startButton;
     QList<QDoubleSpinBox *> m_spinners;
+    QSpinBox        *m_springSelector;
 
 public:
     MyMainWindow();
 
+    bool loadScene(const QString &filename);
+
 public slots:
     void parameterChanged(double newValue);
+    void openScene();
+    void saveCheckpoint();
+    void restoreCheckpoint();
+    void saveCounters();
+    void setRecording(bool recording);
+    void setTracing(bool tracing);
 
 protected:
     void createMenus();
     QWidget *createControlPanel();
+    void updateSpringSelector();
 
 private slots:
     void setEnvironment(int index)  { m_openGLView->setEnvironment(index); }
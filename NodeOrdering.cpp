@@ -0,0 +1,223 @@
+#include "NodeOrdering.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+namespace {
+
+// the breadth-first levels from root over the nodes not yet numbered;
+// returns the number of levels and leaves the last level's nodes at the
+// end of queue
+int levels(const vector<int> &start, const vector<int> &neighbours, int root,
+           const vector<char> &numbered, vector<int> &level, vector<int> &queue,
+           int *lastLevelStart)
+{
+    queue.assign(1, root);
+    level[root] = 0;
+    int depth = 0;
+    *lastLevelStart = 0;
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        int i = queue[head];
+        if (level[i] > depth) { depth = level[i];  *lastLevelStart = int(head); }
+        for (int k = start[i]; k < start[i + 1]; ++k) {
+            int j = neighbours[k];
+            if (!numbered[j] && level[j] < 0) {
+                level[j] = level[i] + 1;
+                queue.push_back(j);
+            }
+        }
+    }
+    for (size_t k = 0; k < queue.size(); ++k) level[queue[k]] = -1;
+    return depth + 1;
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+vector<int> reverseCuthillMcKeeOrdering(const vector<int> &start, const vector<int> &neighbours)
+{
+    int n = int(start.size()) - 1;
+    vector<int> degree(n);
+    for (int i = 0; i < n; ++i) degree[i] = start[i + 1] - start[i];
+
+    vector<char> numbered(n, 0);
+    vector<int> level(n, -1), queue, sequence, adjacent;
+    sequence.reserve(n);
+
+    for (int seed = 0; seed < n; ++seed)
+    {
+        if (numbered[seed]) continue;
+
+        // George and Liu's pseudo-peripheral node: move to a least connected
+        // node of the last level for as long as that deepens the levels
+        int root = seed, lastLevelStart;
+        int depth = levels(start, neighbours, root, numbered, level, queue, &lastLevelStart);
+        for (;;) {
+            int candidate = queue[lastLevelStart];
+            for (size_t k = lastLevelStart; k < queue.size(); ++k)
+                if (degree[queue[k]] < degree[candidate]) candidate = queue[k];
+            int candidateDepth = levels(start, neighbours, candidate, numbered, level, queue,
+                                        &lastLevelStart);
+            if (candidateDepth <= depth) break;
+            root = candidate;
+            depth = candidateDepth;
+        }
+
+        // Cuthill-McKee from it
+        size_t head = sequence.size();
+        sequence.push_back(root);
+        numbered[root] = 1;
+        for (; head < sequence.size(); ++head)
+        {
+            int i = sequence[head];
+            adjacent.clear();
+            for (int k = start[i]; k < start[i + 1]; ++k)
+                if (!numbered[neighbours[k]]) {
+                    numbered[neighbours[k]] = 1;
+                    adjacent.push_back(neighbours[k]);
+                }
+            stable_sort(adjacent.begin(), adjacent.end(),
+                        [&degree](int a, int b) { return degree[a] < degree[b]; });
+            sequence.insert(sequence.end(), adjacent.begin(), adjacent.end());
+        }
+    }
+
+    vector<int> order(n);
+    for (int k = 0; k < n; ++k) order[sequence[k]] = n - 1 - k;
+    return order;
+}
+
+// --------------------------------------------------------------------------
+
+// The elimination runs on the quotient graph: an eliminated node becomes an
+// element standing for the clique of its remaining neighbours, and absorbs
+// the elements it was part of, so the graph never grows.  A node's degree
+// is taken as its node neighbours plus the sizes of its elements, which
+// can count a neighbour twice but is cheap to keep up to date.
+vector<int> minimumDegreeOrdering(const vector<int> &start, const vector<int> &neighbours)
+{
+    int n = int(start.size()) - 1;
+    vector<vector<int> > nodes(n), elements(n), members(n);
+    for (int i = 0; i < n; ++i)
+        for (int k = start[i]; k < start[i + 1]; ++k)
+            if (neighbours[k] != i) nodes[i].push_back(neighbours[k]);
+
+    typedef pair<int, int> Entry;      // degree, node
+    priority_queue<Entry, vector<Entry>, greater<Entry> > heap;
+    vector<int> degree(n);
+    for (int i = 0; i < n; ++i) {
+        degree[i] = int(nodes[i].size());
+        heap.push(Entry(degree[i], i));
+    }
+
+    vector<char> eliminated(n, 0), absorbed(n, 0);
+    vector<int> mark(n, -1), order(n);
+    for (int k = 0; k < n; ++k)
+    {
+        int p;
+        for (;;) {
+            Entry top = heap.top();
+            heap.pop();
+            p = top.second;
+            if (!eliminated[p] && top.first == degree[p]) break;
+        }
+        eliminated[p] = 1;
+        order[p] = k;
+
+        // p's new element: its remaining node neighbours and the members
+        // of the elements it absorbs
+        vector<int> &clique = members[p];
+        clique.clear();
+        mark[p] = p;
+        for (size_t a = 0; a < nodes[p].size(); ++a) {
+            int j = nodes[p][a];
+            if (!eliminated[j] && mark[j] != p) { mark[j] = p;  clique.push_back(j); }
+        }
+        for (size_t a = 0; a < elements[p].size(); ++a) {
+            int e = elements[p][a];
+            for (size_t b = 0; b < members[e].size(); ++b) {
+                int j = members[e][b];
+                if (!eliminated[j] && mark[j] != p) { mark[j] = p;  clique.push_back(j); }
+            }
+            absorbed[e] = 1;
+            vector<int>().swap(members[e]);
+        }
+        vector<int>().swap(nodes[p]);
+        vector<int>().swap(elements[p]);
+
+        int remaining = n - k - 1;
+        for (size_t a = 0; a < clique.size(); ++a)
+        {
+            int i = clique[a];
+
+            // the element now covers i's links to the rest of the clique
+            vector<int> &own = elements[i];
+            own.erase(remove_if(own.begin(), own.end(),
+                                [&absorbed](int e) { return absorbed[e] != 0; }), own.end());
+            own.push_back(p);
+            vector<int> &adjacent = nodes[i];
+            adjacent.erase(remove_if(adjacent.begin(), adjacent.end(),
+                                     [&](int j) { return eliminated[j] || mark[j] == p; }),
+                           adjacent.end());
+
+            long long bound = adjacent.size();
+            for (size_t b = 0; b < own.size(); ++b) bound += members[own[b]].size() - 1;
+            degree[i] = int(min<long long>(bound, remaining - 1));
+            heap.push(Entry(degree[i], i));
+        }
+    }
+    return order;
+}
+
+// --------------------------------------------------------------------------
+
+// Row k of the factor has an entry in each column on the paths up the
+// elimination tree from row k's neighbours below the diagonal to k.
+long long factorFill(const vector<int> &start, const vector<int> &neighbours,
+                     const vector<int> &order)
+{
+    int n = int(start.size()) - 1;
+    vector<int> node(n);
+    for (int i = 0; i < n; ++i) node[order.empty() ? i : order[i]] = i;
+
+    // Liu's elimination tree, with path compression through ancestor
+    vector<int> parent(n, -1), ancestor(n, -1);
+    for (int k = 0; k < n; ++k)
+    {
+        int i = node[k];
+        for (int a = start[i]; a < start[i + 1]; ++a)
+        {
+            int j = order.empty() ? neighbours[a] : order[neighbours[a]];
+            while (j != -1 && j < k) {
+                int next = ancestor[j];
+                ancestor[j] = k;
+                if (next == -1) parent[j] = k;
+                j = next;
+            }
+        }
+    }
+
+    long long fill = 0;
+    vector<int> visited(n, -1);
+    for (int k = 0; k < n; ++k)
+    {
+        visited[k] = k;
+        int i = node[k];
+        for (int a = start[i]; a < start[i + 1]; ++a)
+            for (int j = order.empty() ? neighbours[a] : order[neighbours[a]];
+                 j < k && visited[j] != k; j = parent[j]) {
+                visited[j] = k;
+                ++fill;
+            }
+    }
+    return fill;
+}
+
+// --------------------------------------------------------------------------
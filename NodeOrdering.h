@@ -0,0 +1,36 @@
+#ifndef NODEORDERING_H
+#define NODEORDERING_H
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// Renumberings of the nodes of a symmetric graph, such as a spring
+// network's, given in compressed form: node i's neighbours are
+// neighbours[start[i]] to neighbours[start[i + 1] - 1], and may include i
+// itself.  Each returns order, with node i renumbered to order[i], as
+// bandwidth() takes it.
+
+// Reverse Cuthill-McKee: a breadth-first search from a node at the edge of
+// the graph, visiting neighbours by increasing degree, then reversed.  The
+// neighbours of a node end up close to it, which narrows the band of the
+// matrix and keeps a mat-vec's reads near each other in memory.
+std::vector<int> reverseCuthillMcKeeOrdering(const std::vector<int> &start,
+                                             const std::vector<int> &neighbours);
+
+// Approximate minimum degree: eliminates, one at a time, the node that
+// would join the fewest others, with the degrees bounded from above rather
+// than counted exactly, as in Amestoy, Davis and Duff's AMD.  It leaves far
+// less fill than a narrow band for a factorization that skips zeros.
+std::vector<int> minimumDegreeOrdering(const std::vector<int> &start,
+                                       const std::vector<int> &neighbours);
+
+// The number of entries below the diagonal of the Cholesky factor of a
+// matrix with this graph once renumbered by order (the identity if empty),
+// found from its elimination tree without factorizing.
+long long factorFill(const std::vector<int> &start, const std::vector<int> &neighbours,
+                     const std::vector<int> &order);
+
+// --------------------------------------------------------------------------
+
+#endif // NODEORDERING_H
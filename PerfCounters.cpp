@@ -0,0 +1,109 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------------------------------
+
+const char *PerfCounters::eventName(Event e)
+{
+    static const char *names[EventCount] = {
+        "cycles", "instructions", "cache_misses", "branch_misses"
+    };
+    return e < EventCount ? names[e] : "unknown";
+}
+
+#if defined(__linux__)
+
+PerfCounters::PerfCounters()
+{
+    static const unsigned long long configs[EventCount] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int e = 0; e < EventCount; ++e)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this thread, on whichever CPU it runs
+        m_fd[e] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        m_value[e] = 0.0;
+        if (m_fd[e] < 0 && m_error.empty())
+            m_error = std::string("perf_event_open: ") + strerror(errno);
+    }
+    if (isAvailable()) m_error.clear();
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int e = 0; e < EventCount; ++e)
+        if (m_fd[e] >= 0) close(m_fd[e]);
+}
+
+void PerfCounters::start()
+{
+    for (int e = 0; e < EventCount; ++e)
+        if (m_fd[e] >= 0) {
+            ioctl(m_fd[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void PerfCounters::stop()
+{
+    for (int e = 0; e < EventCount; ++e)
+        if (m_fd[e] >= 0) ioctl(m_fd[e], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (int e = 0; e < EventCount; ++e)
+    {
+        m_value[e] = 0.0;
+        unsigned long long data[3];         // value, time enabled, time running
+        if (m_fd[e] < 0 || read(m_fd[e], data, sizeof(data)) != ssize_t(sizeof(data)))
+            continue;
+        if (data[2] > 0)
+            m_value[e] = double(data[0]) * double(data[1]) / double(data[2]);
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : m_error("hardware counters are only read on Linux")
+{
+    for (int e = 0; e < EventCount; ++e) {
+        m_fd[e] = -1;
+        m_value[e] = 0.0;
+    }
+}
+
+PerfCounters::~PerfCounters()   {}
+void PerfCounters::start()      {}
+void PerfCounters::stop()       {}
+
+#endif
+
+bool PerfCounters::isAvailable() const
+{
+    for (int e = 0; e < EventCount; ++e)
+        if (m_fd[e] >= 0) return true;
+    return false;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <string>
+
+// --------------------------------------------------------------------------
+
+// Hardware event counters for the calling thread, read through Linux's
+// perf_event_open.  Each event is opened on its own, so if the kernel or
+// the CPU (or a virtual machine) refuses some of them the others still
+// work; on other platforms, or where perf events are not permitted at all,
+// every event is simply unavailable.  Counts are scaled up if the kernel
+// had to multiplex the events.
+
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        EventCount
+    };
+
+private:
+    int         m_fd[EventCount];
+    double      m_value[EventCount];
+    std::string m_error;
+
+    PerfCounters(const PerfCounters &);
+    PerfCounters &operator=(const PerfCounters &);
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    // true if at least one event could be opened
+    bool isAvailable() const;
+    bool isAvailable(Event e) const         { return m_fd[e] >= 0; }
+
+    // why the events are unavailable, if they are
+    const std::string &error() const        { return m_error; }
+
+    // zeroes and starts the counters, and stops and reads them
+    void start();
+    void stop();
+
+    // the count between the last start() and stop()
+    double value(Event e) const             { return m_value[e]; }
+
+    static const char *eventName(Event e);
+};
+
+// --------------------------------------------------------------------------
+
+#endif // PERFCOUNTERS_H
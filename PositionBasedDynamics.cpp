@@ -0,0 +1,189 @@
+#include "PositionBasedDynamics.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+XpbdIntegrator::XpbdIntegrator(Cloth *cloth, double dt, WorkStealingPool *pool)
+    : Integrator<StateType>(cloth, dt), m_cloth(cloth), m_pool(pool),
+      m_iterations(10), m_substeps(1), m_preparedStep(0.0), m_colour(0)
+{
+    m_task = [this](int chunk) { project(m_colourChunks[m_colour] + chunk); };
+}
+
+void XpbdIntegrator::bind(Cloth *cloth)
+{
+    Integrator<StateType>::bind(cloth);
+    m_cloth = cloth;
+    m_constraints.clear();
+}
+
+void XpbdIntegrator::setThreadPool(WorkStealingPool *pool)
+{
+    m_pool = pool;
+    m_constraints.clear();
+}
+
+void XpbdIntegrator::setSubsteps(int substeps)
+{
+    m_substeps = max(1, substeps);
+    m_preparedStep = 0.0;
+}
+
+void XpbdIntegrator::setTimeStep(double dt)
+{
+    Integrator<StateType>::setTimeStep(dt);
+    m_preparedStep = 0.0;
+}
+
+// Colours the springs and lays them out colour by colour, each colour cut
+// into a few chunks per thread.
+void XpbdIntegrator::partition()
+{
+    const Cloth &cloth = *m_cloth;
+    int n = cloth.particleCount(), springs = cloth.springCount();
+
+    vector<pair<int, int> > ends(springs);
+    for (int e = 0; e < springs; ++e) ends[e] = make_pair(cloth.spring(e).a, cloth.spring(e).b);
+    m_colouring = colourEdges(n, ends);
+
+    m_constraints.resize(springs);
+    for (int k = 0; k < springs; ++k) {
+        const ClothSpring &s = cloth.spring(m_colouring.order[k]);
+        m_constraints[k].a = s.a;
+        m_constraints[k].b = s.b;
+        m_constraints[k].length = s.length;
+    }
+    m_lambda.assign(springs, 0.0);
+
+    int chunks = m_pool ? 4 * m_pool->threadCount() : 1;
+    m_colourChunks.assign(1, 0);
+    m_chunkStart.clear();
+    for (int c = 0; c < m_colouring.colourCount; ++c)
+    {
+        int first = m_colouring.start[c], size = m_colouring.size(c);
+        int pieces = max(1, min(chunks, size));
+        for (int p = 0; p < pieces; ++p)
+            m_chunkStart.push_back(first + int((long long)size * p / pieces));
+        m_colourChunks.push_back(int(m_chunkStart.size()));
+    }
+    m_chunkStart.push_back(springs);
+
+    m_inverseMass.resize(n);
+    m_positions.resize(n);
+    m_previous.resize(n);
+    m_velocities.resize(n);
+    m_preparedStep = 0.0;
+}
+
+// scales each constraint's compliance and damping for a substep of h
+void XpbdIntegrator::prepare(double h)
+{
+    for (size_t k = 0; k < m_constraints.size(); ++k)
+    {
+        const ClothSpring &s = m_cloth->spring(m_colouring.order[k]);
+        Constraint &c = m_constraints[k];
+        if (s.stiffness > 0.0) {
+            c.compliance = 1.0 / (s.stiffness * h * h);
+            c.damping = s.damping / (s.stiffness * h);
+        }
+        else {
+            c.compliance = -1.0;    // no spring at all
+            c.damping = 0.0;
+        }
+    }
+    m_preparedStep = h;
+}
+
+// Moves both ends of each constraint along it by
+//
+//      dlambda = -(C + compliance lambda + damping grad C . (x - x_prev))
+//                / ((1 + damping)(w_a + w_b) + compliance),
+//
+// in proportion to their inverse masses; no two constraints of a chunk's
+// colour touch the same particle.
+void XpbdIntegrator::project(int chunk)
+{
+    for (int k = m_chunkStart[chunk]; k < m_chunkStart[chunk + 1]; ++k)
+    {
+        const Constraint &c = m_constraints[k];
+        if (c.compliance < 0.0) continue;
+
+        double wa = m_inverseMass[c.a], wb = m_inverseMass[c.b];
+        double w = wa + wb;
+        if (w == 0.0) continue;
+
+        Vector3d d = m_positions[c.b] - m_positions[c.a];
+        double length = d.norm();
+        if (length == 0.0) continue;
+        Vector3d u = d / length;
+
+        double motion = u.dot((m_positions[c.b] - m_previous[c.b])
+                              - (m_positions[c.a] - m_previous[c.a]));
+        double delta = -(length - c.length + c.compliance * m_lambda[k] + c.damping * motion)
+                       / ((1.0 + c.damping) * w + c.compliance);
+        m_lambda[k] += delta;
+        m_positions[c.a] -= wa * delta * u;
+        m_positions[c.b] += wb * delta * u;
+    }
+}
+
+void XpbdIntegrator::step()
+{
+    INTEGRATOR_TIME(stepSeconds);
+    INTEGRATOR_COUNT(steps, 1);
+
+    const Cloth &cloth = *m_cloth;
+    int n = cloth.particleCount();
+    if (m_constraints.empty() || int(m_positions.size()) != n
+        || int(m_constraints.size()) != cloth.springCount())
+        partition();
+
+    double h = m_timeStep / m_substeps;
+    if (m_preparedStep != h) prepare(h);
+
+    StateType &y = m_state;
+    for (int i = 0; i < n; ++i) {
+        m_velocities[i] = y.segment<3>(3 * i);
+        m_positions[i] = y.segment<3>(3 * n + 3 * i);
+        m_inverseMass[i] = cloth.isPinned(i) ? 0.0 : 1.0 / cloth.mass(i);
+    }
+
+    const Vector3d &g = cloth.gravity();
+    for (int substep = 0; substep < m_substeps; ++substep)
+    {
+        // the pinned particles go straight to their targets, the rest fly
+        for (int i = 0; i < n; ++i) {
+            m_previous[i] = m_positions[i];
+            if (cloth.isPinned(i)) m_positions[i] = cloth.pinTarget(i);
+            else {
+                m_velocities[i] += h * g;
+                m_positions[i] += h * m_velocities[i];
+            }
+        }
+
+        fill(m_lambda.begin(), m_lambda.end(), 0.0);
+        for (int iteration = 0; iteration < m_iterations; ++iteration)
+            for (m_colour = 0; m_colour < m_colouring.colourCount; ++m_colour)
+            {
+                int chunks = m_colourChunks[m_colour + 1] - m_colourChunks[m_colour];
+                if (m_pool && chunks > 1) m_pool->run(chunks, m_task);
+                else for (int c = 0; c < chunks; ++c) project(m_colourChunks[m_colour] + c);
+            }
+
+        for (int i = 0; i < n; ++i)
+            m_velocities[i] = (m_positions[i] - m_previous[i]) / h;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        y.segment<3>(3 * i) = m_velocities[i];
+        y.segment<3>(3 * n + 3 * i) = m_positions[i];
+    }
+    m_time += m_timeStep;
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+#ifndef POSITIONBASEDDYNAMICS_H
+#define POSITIONBASEDDYNAMICS_H
+
+#include <vector>
+
+#include "Eigen/Core"
+#include "Cloth.h"
+#include "GraphColouring.h"
+#include "Integrators.h"
+#include "WorkStealingPool.h"
+
+// --------------------------------------------------------------------------
+
+// Extended position-based dynamics (Macklin, Muller and Chentanez, "XPBD:
+// Position-Based Simulation of Compliant Constrained Dynamics") for a
+// Cloth, as an alternative to integrating its forces.  Each substep moves
+// the particles ballistically under gravity, then projects them back onto
+// the springs treated as compliant distance constraints,
+//
+//      C = |x_b - x_a| - length,      compliance 1 / stiffness,
+//
+// with a fixed number of Gauss-Seidel sweeps, and takes the velocities
+// from how far the particles moved.  A projection never overshoots however
+// stiff the spring, so the step is stable at any stiffness and time step;
+// stiff springs just need more sweeps to reach their length.
+//
+// The springs are coloured so that none of one colour share a particle.
+// A sweep runs through the colours in turn, and the springs of each colour
+// are projected in parallel on an optional pool, in fixed chunks, so the
+// result is the same with any number of threads.  Everything is allocated
+// up front, and a step costs the same every time.
+
+class XpbdIntegrator : public Integrator<Eigen::VectorXd>
+{
+public:
+    typedef Eigen::VectorXd StateType;
+
+private:
+    // a spring in the order of the colouring, with its compliance and
+    // damping scaled for the substep
+    struct Constraint
+    {
+        int     a, b;
+        double  length;
+        double  compliance;     // 1 / (stiffness h^2)
+        double  damping;        // damping / (stiffness h)
+    };
+
+    Cloth              *m_cloth;
+    WorkStealingPool   *m_pool;
+    int                 m_iterations;
+    int                 m_substeps;
+    double              m_preparedStep;     // the substep the constraints are scaled for
+
+    EdgeColouring                   m_colouring;
+    std::vector<Constraint>         m_constraints;
+    std::vector<double>             m_lambda;
+
+    // colour c is projected as chunks m_colourChunks[c] to
+    // m_colourChunks[c + 1] - 1, chunk k covering constraints
+    // m_chunkStart[k] to m_chunkStart[k + 1] - 1
+    std::vector<int>    m_colourChunks;
+    std::vector<int>    m_chunkStart;
+
+    // per particle
+    std::vector<double>             m_inverseMass;
+    std::vector<Eigen::Vector3d>    m_positions, m_previous, m_velocities;
+
+    int                     m_colour;
+    WorkStealingPool::Task  m_task;
+
+    void partition();
+    void prepare(double h);
+    void project(int chunk);
+
+public:
+    XpbdIntegrator(Cloth *cloth, double dt, WorkStealingPool *pool = 0);
+
+    void bind(Cloth *cloth);
+
+    // spreads each colour over the pool's threads, or runs on the calling
+    // thread if pool is null
+    void setThreadPool(WorkStealingPool *pool);
+
+    // Gauss-Seidel sweeps per substep (10 by default) and substeps per
+    // step (1).  For the same work, more substeps with fewer sweeps make
+    // stiff springs stiffer.
+    void setIterations(int iterations)      { m_iterations = iterations; }
+    void setSubsteps(int substeps);
+    int iterations() const                  { return m_iterations; }
+    int substeps() const                    { return m_substeps; }
+
+    int colourCount() const                 { return m_colouring.colourCount; }
+
+    virtual void setTimeStep(double dt);
+    virtual void step();
+};
+
+// --------------------------------------------------------------------------
+
+#endif // POSITIONBASEDDYNAMICS_H
@@ -1,4 +1,5 @@
 #include "SimpleSpring.h"
+#include "Checkpoint.h"
 
 void SimpleSpring::computeA()
 {
@@ -11,3 +12,30 @@ void SimpleSpring::computeB()
 {
     m_vectorB << m_gravity, 0.0;
 }
+
+void SimpleSpring::writeCheckpoint(CheckpointWriter &out) const
+{
+    out.write(m_mass);
+    out.write(m_stiffness);
+    out.write(m_damping);
+    out.write(m_gravity);
+    out.write(m_initialPosition);
+    out.write(m_timeRemainder);
+    out.write((unsigned char)(m_matrixChanged));
+    writeIntegrator(out, m_integrator);
+}
+
+bool SimpleSpring::readCheckpoint(CheckpointReader &in)
+{
+    unsigned char matrixChanged;
+    if (!in.read(m_mass) || !in.read(m_stiffness) || !in.read(m_damping) ||
+        !in.read(m_gravity) || !in.read(m_initialPosition) ||
+        !in.read(m_timeRemainder) || !in.read(matrixChanged))
+        return false;
+
+    computeA();
+    computeB();
+    m_matrixChanged = matrixChanged != 0;
+
+    return readIntegrator(in, m_integrator, this);
+}
@@ -1,9 +1,14 @@
 #ifndef SIMPLESPRING_H
 #define SIMPLESPRING_H
 
+#include <cmath>
+
 #include "Eigen/Core"
 #include "Integrators.h"
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class SimpleSpring : public LinearODE<Eigen::Vector2d, Eigen::Matrix2d>
 {
     double m_mass;
@@ -14,8 +19,8 @@ class SimpleSpring : public LinearODE<Eigen::Vector2d, Eigen::Matrix2d>
     double m_initialPosition;
     double m_timeRemainder;
 
-    // time integrator class
-    Integrator<Eigen::Vector2d> *m_integrator;
+    // time integrator, held by value
+    IntegratorVariant<Eigen::Vector2d, Eigen::Matrix2d> m_integrator;
 
     // derivative function f(t,y) = Ay + b
     Eigen::Matrix2d m_matrixA;
@@ -30,37 +35,71 @@ public:
     typedef Eigen::Vector2d StateType;
     typedef Eigen::Matrix2d MatrixType;
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     SimpleSpring(double m = 1.0, double k = 1000.0, double b = 0.0, double g = -9.81)
-        : m_mass(m), m_stiffness(k), m_damping(b), m_gravity(g), m_integrator(0),
+        : m_mass(m), m_stiffness(k), m_damping(b), m_gravity(g),
           m_initialPosition(0), m_timeRemainder(0)
     {
         computeA();
         computeB();
     }
 
-    ~SimpleSpring()
+    // copies carry their integrator's state along, rebound to the copy
+    SimpleSpring(const SimpleSpring &s) : LinearODE<StateType, MatrixType>(s)
     {
-        if (m_integrator) delete m_integrator;
+        *this = s;
     }
 
-    void setIntegrator(Integrator<StateType> *i) { m_integrator = i; }
+    SimpleSpring &operator=(const SimpleSpring &s)
+    {
+        m_mass              = s.m_mass;
+        m_stiffness         = s.m_stiffness;
+        m_damping           = s.m_damping;
+        m_gravity           = s.m_gravity;
+        m_initialPosition   = s.m_initialPosition;
+        m_timeRemainder     = s.m_timeRemainder;
+        m_matrixA           = s.m_matrixA;
+        m_vectorB           = s.m_vectorB;
+        m_matrixChanged     = s.m_matrixChanged;
+        m_integrator        = s.m_integrator;
+        m_integrator.bind(this);
+        return *this;
+    }
+
+    void setIntegrator(IntegratorType type, double dt)
+    {
+        m_integrator.create(type, this, dt);
+    }
+    IntegratorType integratorType() const { return m_integrator.type(); }
 
     void setMass(double m)      { m_mass = m;       computeA(); }
     void setStiffness(double k) { m_stiffness = k;  computeA(); }
     void setDamping(double b)   { m_damping = b;    computeA(); }
     void setGravity(double g)   { m_gravity = g;    computeB(); }
 
-    void setTimeStep(double dt) { if (m_integrator) m_integrator->setTimeStep(dt); }
+    void setTimeStep(double dt) { if (!m_integrator.isNull()) m_integrator.setTimeStep(dt); }
+    double timeStep() const     { return m_integrator.isNull() ? 0.0 : m_integrator.timeStep(); }
+    void setTolerance(double t) { if (!m_integrator.isNull()) m_integrator.setTolerance(t); }
     void setInitialPosition(double p) { m_initialPosition = p; }
 
+    double mass() const             { return m_mass; }
+    double stiffness() const        { return m_stiffness; }
+    double damping() const          { return m_damping; }
+    double gravity() const          { return m_gravity; }
+    double initialPosition() const  { return m_initialPosition; }
+
+    // the height at which the spring holds the mass against gravity
+    double equilibrium() const      { return m_mass * m_gravity / m_stiffness; }
+
     void update(double elapsedTime = -1.0)
     {
-        if (m_integrator)
+        if (!m_integrator.isNull())
         {
-            double dt = m_integrator->timeStep();
+            double dt = m_integrator.timeStep();
             m_timeRemainder += (elapsedTime < 0.0 ? dt : elapsedTime);
             while (m_timeRemainder >= dt) {
-                m_integrator->step();
+                m_integrator.step();
                 m_timeRemainder -= dt;
             }
         }
@@ -69,15 +108,43 @@ public:
     void reset()
     {
         Eigen::Vector2d initial(0.0, m_initialPosition);
-        if (m_integrator) m_integrator->setState(initial);
+        if (!m_integrator.isNull()) m_integrator.setState(initial);
     }
 
+    // changes the mass's velocity by impulse / mass
+    void applyImpulse(double impulse)
+    {
+        if (m_integrator.isNull()) return;
+        Eigen::Vector2d y = m_integrator.state();
+        y[0] += impulse / m_mass;
+        m_integrator.setState(y);
+    }
+
+    // whether the mass moves with less kinetic energy than given, within
+    // distance of its equilibrium
+    bool isAtRest(double energy, double distance) const
+    {
+        Eigen::Vector2d y = currentState();
+        return 0.5 * m_mass * y[0] * y[0] < energy
+            && std::abs(y[1] - equilibrium()) < distance;
+    }
+
+    // saves or restores the complete state of the spring and its integrator
+    void writeCheckpoint(CheckpointWriter &out) const;
+    bool readCheckpoint(CheckpointReader &in);
+
     // derivate function for this ODE: y' = f(t, y)
     virtual Eigen::Vector2d derivativeFunction(double t, const Eigen::Vector2d &y) const
     {
         return m_matrixA * y + m_vectorB;
     }
 
+    virtual void derivative(double t, const Eigen::Vector2d &y, Eigen::Vector2d &dy) const
+    {
+        dy.noalias() = m_matrixA * y;
+        dy += m_vectorB;
+    }
+
     virtual const Eigen::Matrix2d &matrixA() const { return m_matrixA; }
     virtual const Eigen::Vector2d &vectorB() const { return m_vectorB; }
     virtual bool matrixChanged()
@@ -85,9 +152,13 @@ public:
 
     Eigen::Vector2d currentState() const
     {
-        if (m_integrator)   return m_integrator->state();
+        if (!m_integrator.isNull()) return m_integrator.state();
         else                return Eigen::Vector2d(0.0, 0.0);
     }
+
+    // work done by this spring's integrator
+    IntegratorCounters counters() const { return m_integrator.counters(); }
+    void resetCounters()                { m_integrator.resetCounters(); }
 };
 
 #endif // SIMPLESPRING_H
@@ -0,0 +1,133 @@
+#include "SimulationThread.h"
+#include <QMutexLocker>
+#include "Trace.h"
+
+// --------------------------------------------------------------------------
+
+SimulationBarrier::SimulationBarrier(int threads, int renderInterval)
+    : m_threads(threads), m_arrived(0), m_generation(0),
+      m_renderInterval(renderInterval > 0 ? renderInterval : 1),
+      m_frameInterval(m_renderInterval), m_stopRequested(false), m_stopping(false)
+{}
+
+void SimulationBarrier::setRenderInterval(int n)
+{
+    QMutexLocker lock(&m_mutex);
+    m_renderInterval = n > 0 ? n : 1;
+}
+
+void SimulationBarrier::requestStop()
+{
+    QMutexLocker lock(&m_mutex);
+    m_stopRequested = true;
+}
+
+int SimulationBarrier::frameInterval()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_frameInterval;
+}
+
+bool SimulationBarrier::wait(int *nextInterval)
+{
+    QMutexLocker lock(&m_mutex);
+    unsigned generation = m_generation;
+    if (++m_arrived == m_threads) {
+        // the last to arrive decides the next frame for everyone
+        m_arrived = 0;
+        ++m_generation;
+        m_frameInterval = m_renderInterval;
+        m_stopping = m_stopRequested;
+        m_released.wakeAll();
+    }
+    else {
+        while (generation == m_generation) m_released.wait(&m_mutex);
+    }
+
+    // no other frame can end before this thread arrives again
+    *nextInterval = m_frameInterval;
+    return !m_stopping;
+}
+
+// --------------------------------------------------------------------------
+
+SimulationThread::SimulationThread(SpringScene *scene, SimulationBarrier *barrier, int first,
+                                   int last, QObject *parent)
+    : QThread(parent), m_scene(scene), m_barrier(barrier), m_first(first), m_last(last),
+      m_positions(last - first), m_simulatedTime(0.0), m_countersRequested(0),
+      m_producer(0), m_startTime(0.0)
+{
+    for (int i = m_first; i < m_last; ++i)
+        m_positions[i - m_first] = m_scene->spring(i).currentState()[1];
+    m_counters = m_scene->counters(m_first, m_last);
+}
+
+double SimulationThread::simulatedTime() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_simulatedTime;
+}
+
+IntegratorCounters SimulationThread::counters() const
+{
+    m_countersRequested.fetchAndStoreOrdered(1);
+    QMutexLocker lock(&m_mutex);
+    return m_counters;
+}
+
+double SimulationThread::position(int index) const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_positions[index - m_first];
+}
+
+// --------------------------------------------------------------------------
+
+void SimulationThread::run()
+{
+    // springs may have different time steps, so advance all of them by the
+    // largest one to keep them at the same simulated time
+    double quantum = m_scene->maxTimeStep();
+    Trace::setThreadName("simulation");
+
+    int interval = m_barrier->frameInterval();
+    bool running = true;
+    while (running)
+    {
+        // integrate a whole frame, and wait for the other threads to, before
+        // publishing anything
+        {
+            TRACE_ZONE("integrate");
+            for (int n = 0; n < interval; ++n)
+                m_scene->update(quantum, m_first, m_last);
+        }
+        int frame = interval;
+        {
+            TRACE_ZONE("wait");
+            running = m_barrier->wait(&interval);
+        }
+
+        TRACE_ZONE("publish");
+        double t;
+        {
+            QMutexLocker lock(&m_mutex);
+            m_simulatedTime += frame * quantum;
+            t = m_startTime + m_simulatedTime;
+            for (int i = m_first; i < m_last; ++i)
+                m_positions[i - m_first] = m_scene->spring(i).currentState()[1];
+        }
+
+        // the springs are this thread's, so they can be read unlocked; a
+        // producer may block until the recorder catches up
+        if (m_countersRequested.fetchAndStoreOrdered(0)) {
+            IntegratorCounters counters = m_scene->counters(m_first, m_last);
+            QMutexLocker lock(&m_mutex);
+            m_counters = counters;
+        }
+        if (m_producer)
+            for (int i = m_first; i < m_last; ++i)
+                m_producer->record(t, i, m_scene->spring(i).currentState());
+    }
+}
+
+// --------------------------------------------------------------------------
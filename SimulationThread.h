@@ -0,0 +1,101 @@
+#ifndef SIMULATIONTHREAD_H
+#define SIMULATIONTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <QAtomicInt>
+#include <QWaitCondition>
+
+#include "SpringScene.h"
+#include "TrajectoryRecorder.h"
+
+// --------------------------------------------------------------------------
+
+// Holds the threads integrating one scene to the same frames, so that all
+// the springs stay at the same simulated time.  A frame is a render
+// interval of steps; every thread finishes it before any starts the next,
+// and a change of render interval or a request to stop takes effect for
+// all of them at the same frame boundary.
+
+class SimulationBarrier
+{
+    QMutex              m_mutex;
+    QWaitCondition      m_released;
+    int                 m_threads, m_arrived;
+    unsigned            m_generation;
+    int                 m_renderInterval;   // for the frames after the next boundary
+    int                 m_frameInterval;    // of the frame in progress
+    bool                m_stopRequested, m_stopping;
+
+public:
+    SimulationBarrier(int threads, int renderInterval);
+
+    void setRenderInterval(int n);
+    void requestStop();
+
+    // the render interval of the first frame
+    int frameInterval();
+
+    // Waits for every thread to finish the frame.  Returns false if they
+    // are to stop, and otherwise the render interval of the next frame.
+    bool wait(int *nextInterval);
+};
+
+// --------------------------------------------------------------------------
+
+// Integrates a contiguous range of a scene's springs as fast as possible on
+// its own thread, in step with the other threads on the barrier.  After
+// each frame the spring positions are copied into a snapshot that the GUI
+// thread can read without touching the springs.
+
+class SimulationThread : public QThread
+{
+    Q_OBJECT
+
+    SpringScene        *m_scene;
+    SimulationBarrier  *m_barrier;
+    int                 m_first, m_last;
+
+    // snapshot published to the GUI thread, guarded by m_mutex
+    mutable QMutex      m_mutex;
+    QVector<double>     m_positions;
+    double              m_simulatedTime;
+    IntegratorCounters  m_counters;
+
+    // set by counters(), so that they are only gathered when wanted
+    mutable QAtomicInt  m_countersRequested;
+
+    // published snapshots are also recorded here, if set
+    TrajectoryRecorder::Producer *m_producer;
+    double              m_startTime;
+
+public:
+    SimulationThread(SpringScene *scene, SimulationBarrier *barrier, int first, int last,
+                     QObject *parent = 0);
+
+    // records every published snapshot, stamped with simulated time
+    // counted from startTime
+    void setProducer(TrajectoryRecorder::Producer *p, double startTime)
+                                        { m_producer = p; m_startTime = startTime; }
+
+    // simulated seconds integrated by this thread since it was started
+    double simulatedTime() const;
+
+    // work done by the integrators of this thread's springs, as gathered
+    // after the first frame to end since the last call
+    IntegratorCounters counters() const;
+
+    int first() const                   { return m_first; }
+    int last() const                    { return m_last; }
+
+    // position of the index-th spring, which must be in this thread's range
+    double position(int index) const;
+
+protected:
+    virtual void run();
+};
+
+// --------------------------------------------------------------------------
+
+#endif // SIMULATIONTHREAD_H
@@ -0,0 +1,53 @@
+#include "SpringChain.h"
+
+// --------------------------------------------------------------------------
+
+SpringChain::SpringChain(int n, double m, double k, double b, double g)
+    : m_count(n), m_mass(m), m_stiffness(k), m_damping(b), m_gravity(g)
+{
+    computeA();
+    computeB();
+}
+
+void SpringChain::computeA()
+{
+    int n = m_count;
+    m_matrixA.setZero(2*n, 2*n);
+
+    // spring i joins mass i to mass i-1 (or to the support for i = 0), so
+    // each mass feels its own spring and the one below it
+    for (int i = 0; i < n; ++i)
+    {
+        bool below = i + 1 < n;
+        double k = m_stiffness / m_mass, b = m_damping / m_mass;
+
+        m_matrixA(i, i)         = -b * (below ? 2.0 : 1.0);
+        m_matrixA(i, n + i)     = -k * (below ? 2.0 : 1.0);
+        if (i > 0) {
+            m_matrixA(i, i - 1)     = b;
+            m_matrixA(i, n + i - 1) = k;
+        }
+        if (below) {
+            m_matrixA(i, i + 1)     = b;
+            m_matrixA(i, n + i + 1) = k;
+        }
+
+        m_matrixA(n + i, i) = 1.0;
+    }
+}
+
+void SpringChain::computeB()
+{
+    m_vectorB.setZero(2 * m_count);
+    m_vectorB.head(m_count).setConstant(m_gravity);
+}
+
+SpringChain::StateType SpringChain::initialState(double p) const
+{
+    StateType y = StateType::Zero(2 * m_count);
+    for (int i = 0; i < m_count; ++i)
+        y[m_count + i] = p * (i + 1);
+    return y;
+}
+
+// --------------------------------------------------------------------------
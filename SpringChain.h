@@ -0,0 +1,57 @@
+#ifndef SPRINGCHAIN_H
+#define SPRINGCHAIN_H
+
+#include "Eigen/Core"
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// A chain of n identical masses hanging from a fixed support, each joined to
+// the next by a spring and damper.  It is written as a dense linear ODE, so
+// it gives the integrators a workload whose state size can be varied.  As
+// with SimpleSpring the state holds the velocities first, then the
+// positions: y = [v; x].
+
+class SpringChain : public LinearODE<Eigen::VectorXd, Eigen::MatrixXd>
+{
+    int     m_count;
+    double  m_mass;
+    double  m_stiffness;
+    double  m_damping;
+    double  m_gravity;
+
+    Eigen::MatrixXd m_matrixA;
+    Eigen::VectorXd m_vectorB;
+
+    void computeA();
+    void computeB();
+
+public:
+    typedef Eigen::VectorXd StateType;
+    typedef Eigen::MatrixXd MatrixType;
+
+    SpringChain(int n, double m = 1.0, double k = 1000.0, double b = 1.0, double g = -9.81);
+
+    int size() const                { return m_count; }
+
+    // all masses at rest, displaced from their spring's rest length by p
+    StateType initialState(double p = 0.1) const;
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const
+    {
+        return m_matrixA * y + m_vectorB;
+    }
+
+    virtual void derivative(double t, const StateType &y, StateType &dy) const
+    {
+        dy.noalias() = m_matrixA * y;
+        dy += m_vectorB;
+    }
+
+    virtual const MatrixType &matrixA() const   { return m_matrixA; }
+    virtual const StateType &vectorB() const    { return m_vectorB; }
+};
+
+// --------------------------------------------------------------------------
+
+#endif // SPRINGCHAIN_H
@@ -0,0 +1,275 @@
+#include "SpringNetwork.h"
+#include <algorithm>
+#include "NodeOrdering.h"
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+SpringNetwork::SpringNetwork(double gravity)
+    : m_gravity(gravity), m_ordering(NaturalOrdering), m_assembled(false),
+      m_matrixChanged(true)
+{}
+
+void SpringNetwork::clear()
+{
+    m_masses.clear();
+    m_positions.clear();
+    m_edges.clear();
+    m_rowOfNode.clear();
+    m_nodeOfRow.clear();
+    m_assembled = false;
+}
+
+int SpringNetwork::addNode(double mass, double position)
+{
+    m_masses.push_back(mass);
+    m_positions.push_back(position);
+    m_assembled = false;
+    return nodeCount() - 1;
+}
+
+int SpringNetwork::addEdge(int from, int to, double stiffness, double damping, double length)
+{
+    SpringNetworkEdge e = { from, to, stiffness, damping, length };
+    m_edges.push_back(e);
+    m_assembled = false;
+    return edgeCount() - 1;
+}
+
+void SpringNetwork::setEdge(int e, double stiffness, double damping, double length)
+{
+    // take the old edge out of A and b, and put the new one in
+    if (m_assembled) applyEdge(e, -1.0);
+    m_edges[e].stiffness = stiffness;
+    m_edges[e].damping = damping;
+    m_edges[e].length = length;
+    if (m_assembled) {
+        applyEdge(e, 1.0);
+        m_matrixChanged = true;
+    }
+}
+
+void SpringNetwork::createChain(int n, double m, double k, double b, double spacing)
+{
+    clear();
+    for (int i = 0; i < n; ++i) {
+        addNode(m, -spacing * (i + 1));
+        addEdge(i == 0 ? int(Ground) : i - 1, i, k, b, -spacing);
+    }
+    assemble();
+}
+
+void SpringNetwork::createLattice(int width, int height, double m, double k, double b)
+{
+    clear();
+    for (int r = 0; r < height; ++r)
+        for (int c = 0; c < width; ++c) {
+            int i = addNode(m, -0.1 * (r + 1));
+            if (r == 0) addEdge(Ground, i, k, b, -0.1);
+            else        addEdge(i - width, i, k, b, -0.1);
+            if (c > 0)  addEdge(i - 1, i, k, b, 0.0);
+        }
+    assemble();
+}
+
+// --------------------------------------------------------------------------
+
+// the offset of (row, column) among the first width entries of the row
+static int findSlot(const int *columns, const int *rows, int row, int column, int width)
+{
+    return int(lower_bound(columns + rows[row], columns + rows[row] + width, column) - columns);
+}
+
+// The force of edge (a, b) on b is -k (x_b - x_a - L) - c (v_b - v_a), and
+// on a the opposite; divided by the mass, these give each node's row.
+
+void SpringNetwork::applyEdge(int e, double scale)
+{
+    const SpringNetworkEdge &edge = m_edges[e];
+    const int *slots = &m_edgeSlots[4 * e];
+    double *values = m_matrixA._valuePtr();
+
+    double k = scale * edge.stiffness, c = scale * edge.damping, kL = k * edge.length;
+
+    if (edge.from != Ground)
+    {
+        int a = row(edge.from), width = m_rowWidths[a];
+        double im = 1.0 / m_masses[edge.from];
+        values[slots[0]]            -= c * im;
+        values[slots[1]]            += c * im;
+        values[slots[0] + width]    -= k * im;
+        values[slots[1] + width]    += k * im;
+        m_vectorB[a]                -= kL * im;
+    }
+
+    int b = row(edge.to), width = m_rowWidths[b];
+    double im = 1.0 / m_masses[edge.to];
+    values[slots[2]]            -= c * im;
+    values[slots[2] + width]    -= k * im;
+    if (edge.from != Ground) {
+        values[slots[3]]            += c * im;
+        values[slots[3] + width]    += k * im;
+    }
+    m_vectorB[b]                += kL * im;
+}
+
+void SpringNetwork::assemble()
+{
+    int n = nodeCount();
+
+    // each node's neighbours, including itself, in column order
+    vector<int> start(n + 1, 0);
+    for (int i = 0; i < n; ++i) ++start[i + 1];
+    for (size_t e = 0; e < m_edges.size(); ++e)
+        if (m_edges[e].from != Ground) {
+            ++start[m_edges[e].from + 1];
+            ++start[m_edges[e].to + 1];
+        }
+    for (int i = 0; i < n; ++i) start[i + 1] += start[i];
+
+    vector<int> neighbours(start[n]);
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < n; ++i) neighbours[fill[i]++] = i;
+    for (size_t e = 0; e < m_edges.size(); ++e)
+        if (m_edges[e].from != Ground) {
+            neighbours[fill[m_edges[e].from]++] = m_edges[e].to;
+            neighbours[fill[m_edges[e].to]++] = m_edges[e].from;
+        }
+
+    // renumber, moving each node's list to its new row
+    m_rowOfNode.clear();
+    m_nodeOfRow.clear();
+    if (m_ordering != NaturalOrdering)
+    {
+        m_rowOfNode = m_ordering == BandwidthOrdering
+                    ? reverseCuthillMcKeeOrdering(start, neighbours)
+                    : minimumDegreeOrdering(start, neighbours);
+        m_nodeOfRow.resize(n);
+        for (int i = 0; i < n; ++i) m_nodeOfRow[m_rowOfNode[i]] = i;
+
+        vector<int> rowStart(n + 1, 0), rowNeighbours(start[n]);
+        for (int r = 0; r < n; ++r) {
+            int i = m_nodeOfRow[r];
+            rowStart[r + 1] = rowStart[r] + start[i + 1] - start[i];
+            for (int k = start[i]; k < start[i + 1]; ++k)
+                rowNeighbours[rowStart[r] + k - start[i]] = m_rowOfNode[neighbours[k]];
+        }
+        start.swap(rowStart);
+        neighbours.swap(rowNeighbours);
+    }
+
+    m_rowWidths.resize(n);
+    for (int i = 0; i < n; ++i) {
+        int *first = &neighbours[0] + start[i], *last = &neighbours[0] + start[i + 1];
+        sort(first, last);
+        m_rowWidths[i] = int(unique(first, last) - first);
+    }
+
+    // rows 0..n-1 give the accelerations from the velocities and then the
+    // positions of the node and its neighbours; rows n..2n-1 are x' = v
+    long long nonZeros = n;
+    for (int i = 0; i < n; ++i) nonZeros += 2 * m_rowWidths[i];
+
+    m_matrixA.resize(2 * n, 2 * n);
+    m_matrixA.reserve(int(nonZeros));
+    for (int i = 0; i < n; ++i) {
+        m_matrixA.startVec(i);
+        for (int half = 0; half < 2; ++half)
+            for (int j = 0; j < m_rowWidths[i]; ++j)
+                m_matrixA.insertBack(i, half * n + neighbours[start[i] + j]) = 0.0;
+    }
+    for (int i = 0; i < n; ++i) {
+        m_matrixA.startVec(n + i);
+        m_matrixA.insertBack(n + i, i) = 1.0;
+    }
+    m_matrixA.finalize();
+
+    m_vectorB.setZero(2 * n);
+    m_vectorB.head(n).setConstant(m_gravity);
+
+    // where each edge's entries landed
+    const int *columns = m_matrixA._innerIndexPtr();
+    const int *rows = m_matrixA._outerIndexPtr();
+
+    m_edgeSlots.assign(4 * m_edges.size(), -1);
+    for (size_t e = 0; e < m_edges.size(); ++e)
+    {
+        int a = m_edges[e].from == Ground ? int(Ground) : row(m_edges[e].from);
+        int b = row(m_edges[e].to);
+        int *slots = &m_edgeSlots[4 * e];
+        if (a != Ground) {
+            slots[0] = findSlot(columns, rows, a, a, m_rowWidths[a]);
+            slots[1] = findSlot(columns, rows, a, b, m_rowWidths[a]);
+            slots[3] = findSlot(columns, rows, b, a, m_rowWidths[b]);
+        }
+        slots[2] = findSlot(columns, rows, b, b, m_rowWidths[b]);
+    }
+
+    m_assembled = true;
+    for (size_t e = 0; e < m_edges.size(); ++e)
+        applyEdge(int(e), 1.0);
+    m_matrixChanged = true;
+}
+
+// --------------------------------------------------------------------------
+
+SpringNetwork::StateType SpringNetwork::initialState() const
+{
+    int n = nodeCount();
+    StateType y = StateType::Zero(2 * n);
+    for (int i = 0; i < n; ++i)
+        y[n + row(i)] = m_positions[i];
+    return y;
+}
+
+SpringNetwork::StateType SpringNetwork::toNodeOrder(const StateType &y) const
+{
+    int n = nodeCount();
+    StateType z(2 * n);
+    for (int i = 0; i < n; ++i) {
+        z[i] = y[row(i)];
+        z[n + i] = y[n + row(i)];
+    }
+    return z;
+}
+
+SpringNetwork::StateType SpringNetwork::fromNodeOrder(const StateType &z) const
+{
+    int n = nodeCount();
+    StateType y(2 * n);
+    for (int i = 0; i < n; ++i) {
+        y[row(i)] = z[i];
+        y[n + row(i)] = z[n + i];
+    }
+    return y;
+}
+
+SpringNetwork::StateType SpringNetwork::derivativeFunction(double t, const StateType &y) const
+{
+    StateType dy;
+    derivative(t, y, dy);
+    return dy;
+}
+
+void SpringNetwork::derivative(double t, const StateType &y, StateType &dy) const
+{
+    const double *values = m_matrixA._valuePtr();
+    const int *columns = m_matrixA._innerIndexPtr();
+    const int *rows = m_matrixA._outerIndexPtr();
+    const double *b = m_vectorB.data();
+    const double *x = y.data();
+
+    int size = int(m_vectorB.size());
+    dy.resize(size);
+    double *out = dy.data();
+    for (int r = 0; r < size; ++r) {
+        double sum = b[r];
+        for (int k = rows[r]; k < rows[r + 1]; ++k)
+            sum += values[k] * x[columns[k]];
+        out[r] = sum;
+    }
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,144 @@
+#ifndef SPRINGNETWORK_H
+#define SPRINGNETWORK_H
+
+#include <vector>
+
+#ifndef EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
+#define EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
+#endif
+#include "Eigen/Core"
+#include "Eigen/Sparse"
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// Masses joined by springs and dampers in any topology (chains, lattices,
+// meshes), described by a node and edge list.  Like SimpleSpring and
+// SpringChain it moves along the vertical only, and its state holds the
+// velocities first, then the positions: y = [v; x].
+//
+// A is assembled directly in compressed row form, with one row per node
+// holding the node and its neighbours, so the derivative is a sparse
+// mat-vec whose cost grows linearly with the number of springs.  Changing
+// one edge's parameters updates its handful of entries in place; only
+// adding edges or nodes needs a new assembly.
+//
+// Nodes are numbered as they were added, which for a network read from
+// elsewhere may scatter each row's columns all over the state.  assemble()
+// can renumber them (see setOrdering()): the state and A then follow the
+// new numbering, while node and edge indices, and everything passed in or
+// read back per node, keep the caller's.
+
+struct SpringNetworkEdge
+{
+    int     from, to;       // node indices, or SpringNetwork::Ground for from
+    double  stiffness;
+    double  damping;
+    double  length;         // rest length: at rest, x[to] = x[from] + length
+};
+
+class SpringNetwork
+    : public LinearODE<Eigen::VectorXd, Eigen::SparseMatrix<double, Eigen::RowMajor> >
+{
+public:
+    typedef Eigen::VectorXd StateType;
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor> MatrixType;
+
+    // the fixed support, at height zero
+    enum { Ground = -1 };
+
+    // how assemble() numbers the nodes in the state: as added, by reverse
+    // Cuthill-McKee for a narrow band and a local mat-vec, or by approximate
+    // minimum degree for little fill (see NodeOrdering.h)
+    enum Ordering { NaturalOrdering, BandwidthOrdering, FillOrdering };
+
+private:
+    std::vector<double>             m_masses;
+    std::vector<double>             m_positions;    // initial heights
+    std::vector<SpringNetworkEdge>  m_edges;
+    double                          m_gravity;
+    Ordering                        m_ordering;
+
+    // where each node's row is, and which node each row belongs to; empty
+    // for the natural ordering
+    std::vector<int>    m_rowOfNode;
+    std::vector<int>    m_nodeOfRow;
+
+    MatrixType      m_matrixA;
+    StateType       m_vectorB;
+
+    // for each edge, the offsets into A's values of its (from, from),
+    // (from, to), (to, to) and (to, from) velocity entries (-1 where from
+    // is the ground); a row's position entries follow its velocity ones at
+    // a fixed distance, the row's width
+    std::vector<int>    m_edgeSlots;
+    std::vector<int>    m_rowWidths;
+
+    bool    m_assembled;
+    bool    m_matrixChanged;
+
+    // adds scale times the edge's contribution to A and b
+    void applyEdge(int e, double scale);
+
+public:
+    explicit SpringNetwork(double gravity = -9.81);
+
+    void clear();
+
+    // returns the index of the new node
+    int addNode(double mass, double position = 0.0);
+
+    // returns the index of the new edge
+    int addEdge(int from, int to, double stiffness, double damping, double length = 0.0);
+
+    // changes one edge in place, in constant time once assembled
+    void setEdge(int e, double stiffness, double damping, double length);
+
+    // n masses hanging one below the other from the ground
+    void createChain(int n, double m = 1.0, double k = 1000.0, double b = 1.0,
+                     double spacing = 0.1);
+
+    // a width by height grid of masses joined to their right and lower
+    // neighbours, with the top row hung from the ground
+    void createLattice(int width, int height, double m = 1.0, double k = 1000.0,
+                       double b = 1.0);
+
+    // Builds A and b from the nodes and edges; must be called after adding
+    // any, before the model is integrated.
+    void assemble();
+    bool isAssembled() const                    { return m_assembled; }
+
+    // takes effect at the next assemble()
+    void setOrdering(Ordering ordering)         { m_ordering = ordering;  m_assembled = false; }
+    Ordering ordering() const                   { return m_ordering; }
+
+    // node i's velocity is y[row(i)] and its position y[nodeCount() + row(i)]
+    int row(int node) const                     { return m_rowOfNode.empty() ? node : m_rowOfNode[node]; }
+    int nodeOfRow(int row) const                { return m_nodeOfRow.empty() ? row : m_nodeOfRow[row]; }
+
+    // the state with the nodes in the order they were added, as [v; x],
+    // and back
+    StateType toNodeOrder(const StateType &y) const;
+    StateType fromNodeOrder(const StateType &y) const;
+
+    int nodeCount() const                       { return int(m_masses.size()); }
+    int edgeCount() const                       { return int(m_edges.size()); }
+    const SpringNetworkEdge &edge(int e) const  { return m_edges[e]; }
+    double mass(int node) const                 { return m_masses[node]; }
+    double gravity() const                      { return m_gravity; }
+
+    // all masses at rest at their initial heights, in the state's order
+    StateType initialState() const;
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void derivative(double t, const StateType &y, StateType &dy) const;
+
+    virtual const MatrixType &matrixA() const   { return m_matrixA; }
+    virtual const StateType &vectorB() const    { return m_vectorB; }
+    virtual bool matrixChanged()
+                { return m_matrixChanged ? !(m_matrixChanged = false) : false; }
+};
+
+// --------------------------------------------------------------------------
+
+#endif // SPRINGNETWORK_H
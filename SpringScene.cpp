@@ -0,0 +1,472 @@
+#include "SpringScene.h"
+#include "AutoTuner.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+void SpringScene::clear()
+{
+    m_springs.clear();
+    m_awake.clear();
+    m_restTime.clear();
+    m_sleep = SleepThresholds();
+}
+
+void SpringScene::reserve(int n)
+{
+    m_springs.reserve(n);
+    m_awake.reserve(n);
+    m_restTime.reserve(n);
+}
+
+int SpringScene::addSpring(const SpringDescription &d)
+{
+    m_springs.push_back(SimpleSpring(d.mass, d.stiffness, d.damping, d.gravity));
+
+    SimpleSpring &s = m_springs.back();
+    s.setInitialPosition(d.initialPosition);
+    s.setIntegrator(d.integrator, d.timeStep);
+    if (d.tolerance > 0.0) s.setTolerance(d.tolerance);
+    s.reset();
+    m_awake.push_back(1);
+    m_restTime.push_back(0.0);
+
+    return size() - 1;
+}
+
+void SpringScene::createDefault()
+{
+    clear();
+
+    SpringDescription d;
+    d.stiffness = 200.0;
+    d.damping = 1.0;
+    d.initialPosition = .25;
+    d.timeStep = 0.005;
+    for (int i = 0; i < IntegratorTypeCount; ++i) {
+        d.integrator = IntegratorType(i);
+        addSpring(d);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// Scene files are plain text.  Blank lines and anything after a '#' are
+// ignored; every other line is a command followed by key=value pairs:
+//
+//      default mass=1 stiffness=200 damping=1 gravity=-9.81 dt=0.005
+//      spring  count=1000 integrator=rk4 stiffness=100:400 position=.25
+//
+// "default" changes the values used by subsequent springs, and "spring"
+// adds count springs (one if omitted).  A numeric value written as a:b is
+// spread linearly over the springs created by that line.
+//
+// "integrator=auto" lets the auto-tuner pick the fastest integrator and
+// time step keeping the spring within "accuracy" (1e-4 by default); dt is
+// then the largest step it may use.
+//
+//      sleep energy=1e-6 distance=1e-4 dwell=0.5
+//
+// lets springs that come to rest sleep (see setSleeping()); a scene
+// without a "sleep" line keeps every spring awake.
+
+namespace {
+
+struct Range
+{
+    double from, to;
+    Range(double v = 0.0) : from(v), to(v) {}
+    double at(int i, int count) const
+        { return count > 1 ? from + (to - from) * i / (count - 1) : from; }
+};
+
+bool parseRange(const string &text, Range *range)
+{
+    const char *begin = text.c_str();
+    char *end = 0;
+    range->from = range->to = strtod(begin, &end);
+    if (end == begin) return false;
+    if (*end == ':') {
+        begin = end + 1;
+        range->to = strtod(begin, &end);
+        if (end == begin) return false;
+    }
+    return *end == '\0';
+}
+
+bool parseNumber(const string &text, double *value)
+{
+    const char *begin = text.c_str();
+    char *end = 0;
+    *value = strtod(begin, &end);
+    return end != begin && *end == '\0';
+}
+
+// a positive whole number that fits an int, with nothing after it
+bool parseCount(const string &text, int *count)
+{
+    const char *begin = text.c_str();
+    char *end = 0;
+    errno = 0;
+    long value = strtol(begin, &end, 10);
+    if (end == begin || *end != '\0' || errno == ERANGE || value <= 0 || value > INT_MAX)
+        return false;
+    *count = int(value);
+    return true;
+}
+
+struct SpringRanges
+{
+    Range mass, stiffness, damping, gravity, position, timeStep, accuracy;
+    IntegratorType integrator;
+    bool autoTune;
+
+    SpringRanges()
+    {
+        SpringDescription d;
+        mass = d.mass; stiffness = d.stiffness; damping = d.damping;
+        gravity = d.gravity; position = d.initialPosition; timeStep = d.timeStep;
+        accuracy = 1e-4;
+        integrator = d.integrator;
+        autoTune = false;
+    }
+
+    SpringDescription at(int i, int count) const
+    {
+        SpringDescription d;
+        d.mass = mass.at(i, count);
+        d.stiffness = stiffness.at(i, count);
+        d.damping = damping.at(i, count);
+        d.gravity = gravity.at(i, count);
+        d.initialPosition = position.at(i, count);
+        d.timeStep = timeStep.at(i, count);
+        d.integrator = integrator;
+        return d;
+    }
+};
+
+}
+
+bool SpringScene::load(const string &filename, string *error)
+{
+    ifstream in(filename.c_str());
+    if (!in) {
+        clear();
+        if (error) *error = "could not open " + filename;
+        return false;
+    }
+    return load(in, error);
+}
+
+bool SpringScene::load(istream &in, string *error)
+{
+    clear();
+
+    SpringRanges defaults;
+    SleepThresholds sleep;
+    string line;
+    for (int lineNumber = 1; getline(in, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        istringstream tokens(line);
+        string command;
+        if (!(tokens >> command)) continue;
+
+        ostringstream where;
+        where << "line " << lineNumber << ": ";
+
+        if (command != "default" && command != "spring" && command != "sleep") {
+            clear();
+            if (error) *error = where.str() + "unknown command '" + command + "'";
+            return false;
+        }
+
+        SpringRanges values = defaults;
+        int count = 1;
+        string pair;
+        while (tokens >> pair)
+        {
+            size_t equals = pair.find('=');
+            string key = pair.substr(0, equals);
+            string value = equals == string::npos ? "" : pair.substr(equals + 1);
+
+            bool ok = true;
+            if (command == "sleep") {
+                if      (key == "energy")   ok = parseNumber(value, &sleep.energy) && sleep.energy > 0.0;
+                else if (key == "distance") ok = parseNumber(value, &sleep.distance) && sleep.distance > 0.0;
+                else if (key == "dwell")    ok = parseNumber(value, &sleep.dwell) && sleep.dwell >= 0.0;
+                else ok = false;
+            }
+            else if (key == "mass")         ok = parseRange(value, &values.mass);
+            else if (key == "stiffness")    ok = parseRange(value, &values.stiffness);
+            else if (key == "damping")      ok = parseRange(value, &values.damping);
+            else if (key == "gravity")      ok = parseRange(value, &values.gravity);
+            else if (key == "position")     ok = parseRange(value, &values.position);
+            else if (key == "dt")           ok = parseRange(value, &values.timeStep);
+            else if (key == "accuracy")     ok = parseRange(value, &values.accuracy);
+            else if (key == "integrator") {
+                values.autoTune = value == "auto";
+                ok = values.autoTune || parseIntegratorType(value, &values.integrator);
+            }
+            else if (key == "count" && command == "spring")
+                ok = parseCount(value, &count);
+            else ok = false;
+
+            if (!ok) {
+                clear();
+                if (error) *error = where.str() + "bad setting '" + pair + "'";
+                return false;
+            }
+        }
+
+        if (command == "sleep") continue;
+        if (command == "default") {
+            defaults = values;
+            continue;
+        }
+
+        AutoTuner localTuner;
+        AutoTuner *tuner = m_tuner ? m_tuner : &localTuner;
+
+        reserve(size() + count);
+        for (int i = 0; i < count; ++i)
+        {
+            SpringDescription d = values.at(i, count);
+            if (values.autoTune) {
+                // a spring the tuner cannot satisfy gets its most accurate setting
+                SimpleSpring model(d.mass, d.stiffness, d.damping, d.gravity);
+                TuningChoice choice;
+                tuner->choose(model.matrixA(), model.vectorB(), StateType(0.0, d.initialPosition),
+                              values.accuracy.at(i, count), d.timeStep, &choice);
+                d.integrator = choice.type;
+                d.timeStep = choice.timeStep;
+                d.tolerance = choice.tolerance;
+            }
+            addSpring(d);
+        }
+    }
+    setSleeping(sleep);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool SpringScene::saveCheckpoint(const string &filename, string *error) const
+{
+    ofstream out(filename.c_str(), ios::binary);
+    bool written = out && saveCheckpoint(out);
+    out.close();
+    if (!written || !out) {
+        if (error) *error = "could not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool SpringScene::saveCheckpoint(ostream &out) const
+{
+    CheckpointWriter writer(out);
+    writer.writeHeader();
+    writer.write((long long)(m_springs.size()));
+    for (size_t i = 0; i < m_springs.size(); ++i)
+        m_springs[i].writeCheckpoint(writer);
+    return writer.flush();
+}
+
+bool SpringScene::restoreCheckpoint(const string &filename, string *error)
+{
+    ifstream in(filename.c_str(), ios::binary);
+    if (!in) {
+        clear();
+        if (error) *error = "could not open " + filename;
+        return false;
+    }
+    return restoreCheckpoint(in, error);
+}
+
+bool SpringScene::restoreCheckpoint(istream &in, string *error)
+{
+    // checkpoints hold the springs only, so keep the sleep thresholds
+    SleepThresholds sleep = m_sleep;
+    clear();
+
+    CheckpointReader reader(in);
+    long long count = 0;
+    if (reader.readHeader() && reader.read(count) && count >= 0)
+    {
+        // the count is only as good as the file, so grow with the springs
+        // actually read rather than trust it with the allocation
+        m_springs.reserve(size_t(min(count, 1LL << 16)));
+        for (long long i = 0; i < count; ++i) {
+            m_springs.push_back(SimpleSpring());
+            if (!m_springs.back().readCheckpoint(reader)) break;
+        }
+        m_awake.assign(m_springs.size(), 1);
+        m_restTime.assign(m_springs.size(), 0.0);
+    }
+    else if (reader.ok()) reader.fail("bad spring count");
+
+    if (!reader.ok()) {
+        clear();
+        if (error) *error = reader.error();
+        return false;
+    }
+    setSleeping(sleep);
+    return true;
+}
+
+double SpringScene::maxStateDifference(const SpringScene &other) const
+{
+    double difference = 0.0;
+    int n = min(size(), other.size());
+    for (int i = 0; i < n; ++i) {
+        StateType d = m_springs[i].currentState() - other.m_springs[i].currentState();
+        difference = max(difference, d.cwiseAbs().maxCoeff());
+    }
+    return difference;
+}
+
+// --------------------------------------------------------------------------
+
+void SpringScene::setParameter(int index, SpringParameter parameter, double value)
+{
+    int first = index < 0 ? 0 : index;
+    int last = index < 0 ? size() : min(index + 1, size());
+
+    for (int i = first; i < last; ++i)
+    {
+        SimpleSpring &s = m_springs[i];
+        switch (parameter) {
+        case Mass:      s.setMass(value);       break;
+        case Stiffness: s.setStiffness(value);  break;
+        case Damping:   s.setDamping(value);    break;
+        case Gravity:   s.setGravity(value);    break;
+        case TimeStep:  s.setTimeStep(value);   break;
+        default:                                break;
+        }
+        m_awake[i] = 1;
+        m_restTime[i] = 0.0;
+    }
+}
+
+void SpringScene::setSleeping(const SleepThresholds &thresholds)
+{
+    m_sleep = thresholds;
+    wake();
+}
+
+void SpringScene::wake(int index)
+{
+    int first = index < 0 ? 0 : index;
+    int last = index < 0 ? size() : min(index + 1, size());
+    for (int i = first; i < last; ++i) {
+        m_awake[i] = 1;
+        m_restTime[i] = 0.0;
+    }
+}
+
+int SpringScene::awakeCount() const
+{
+    return int(count(m_awake.begin(), m_awake.end(), 1));
+}
+
+void SpringScene::applyImpulse(int index, double impulse)
+{
+    m_springs[index].applyImpulse(impulse);
+    wake(index);
+}
+
+void SpringScene::update(double elapsed, int first, int last)
+{
+    if (last < 0) last = size();
+
+    if (!m_sleep.isEnabled()) {
+        for (int i = first; i < last; ++i)
+            m_springs[i].update(elapsed);
+        return;
+    }
+
+    for (int i = first; i < last; ++i)
+    {
+        // runs of sleeping springs are passed over eight at a time
+        if (!m_awake[i]) {
+            unsigned long long word;
+            while (i + 8 <= last && (memcpy(&word, &m_awake[i], 8), word == 0)) i += 8;
+            if (i >= last || !m_awake[i]) continue;
+        }
+
+        SimpleSpring &s = m_springs[i];
+        s.update(elapsed);
+        if (s.isAtRest(m_sleep.energy, m_sleep.distance)) {
+            m_restTime[i] += elapsed < 0.0 ? s.timeStep() : elapsed;
+            if (m_restTime[i] >= m_sleep.dwell) m_awake[i] = 0;
+        }
+        else m_restTime[i] = 0.0;
+    }
+}
+
+void SpringScene::reset()
+{
+    for (int i = 0; i < size(); ++i)
+        m_springs[i].reset();
+    wake();
+}
+
+double SpringScene::maxTimeStep() const
+{
+    double dt = 0.0;
+    for (int i = 0; i < size(); ++i)
+        dt = max(dt, m_springs[i].timeStep());
+    return dt;
+}
+
+// --------------------------------------------------------------------------
+
+IntegratorCounters SpringScene::counters(int first, int last) const
+{
+    if (last < 0) last = size();
+    IntegratorCounters total;
+    for (int i = first; i < last; ++i)
+        total += m_springs[i].counters();
+    return total;
+}
+
+void SpringScene::resetCounters()
+{
+    for (int i = 0; i < size(); ++i)
+        m_springs[i].resetCounters();
+}
+
+bool SpringScene::writeCounters(const string &filename, string *error) const
+{
+    ofstream out(filename.c_str());
+    if (out) writeCounters(out);
+    if (!out) {
+        if (error) *error = "could not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+void SpringScene::writeCounters(ostream &out) const
+{
+    out << "spring,integrator,steps,evaluations,factorizations,solves,"
+           "rejected_steps,step_seconds,factor_seconds\n";
+    for (int i = 0; i < size(); ++i) {
+        IntegratorCounters c = m_springs[i].counters();
+        out << i << ',' << integratorName(integratorType(i)) << ',' << c.steps << ','
+            << c.evaluations << ',' << c.factorizations << ',' << c.solves << ','
+            << c.rejectedSteps << ',' << c.stepSeconds << ',' << c.factorSeconds << '\n';
+    }
+}
+
+// --------------------------------------------------------------------------
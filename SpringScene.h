@@ -0,0 +1,165 @@
+#ifndef SPRINGSCENE_H
+#define SPRINGSCENE_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "Eigen/StdVector"
+#include "SimpleSpring.h"
+
+class AutoTuner;
+
+// --------------------------------------------------------------------------
+
+// parameters that can be changed on a running scene, in the same order as
+// the spinners on the main window's control panel
+enum SpringParameter
+{
+    Mass,
+    Stiffness,
+    Damping,
+    Gravity,
+    TimeStep
+};
+
+struct SpringDescription
+{
+    double          mass;
+    double          stiffness;
+    double          damping;
+    double          gravity;
+    double          initialPosition;
+    double          timeStep;
+    double          tolerance;      // of the adaptive integrator, if positive
+    IntegratorType  integrator;
+
+    SpringDescription()
+        : mass(1.0), stiffness(200.0), damping(1.0), gravity(-9.81),
+          initialPosition(.25), timeStep(0.005), tolerance(0.0), integrator(RungeKutta4) {}
+};
+
+// When a spring may stop being integrated: once its kinetic energy and its
+// distance from equilibrium have both stayed below these for the dwell
+// time.  Sleeping is off unless both thresholds are positive.
+struct SleepThresholds
+{
+    double  energy;
+    double  distance;
+    double  dwell;          // seconds
+
+    SleepThresholds(double e = 0.0, double d = 0.0, double t = 0.5)
+        : energy(e), distance(d), dwell(t) {}
+
+    bool isEnabled() const  { return energy > 0.0 && distance > 0.0; }
+};
+
+// --------------------------------------------------------------------------
+
+// A runtime-sized collection of springs, each with its own parameters and
+// integrator.  Springs hold their integrators inline and are stored in one
+// contiguous array, so building a scene of a million springs is a single
+// allocation, and a scene can be copied wholesale (e.g. to try something
+// speculatively and throw it away).
+//
+// Springs that have come to rest can be put to sleep (see setSleeping()):
+// update() then skips them, so that a scene in which most springs have
+// settled costs little more than its moving ones.  A sleeping spring wakes
+// when one of its parameters changes, it is pushed, or the scene is reset.
+
+class SpringScene
+{
+public:
+    typedef SimpleSpring::StateType  StateType;
+    typedef SimpleSpring::MatrixType MatrixType;
+
+private:
+    std::vector<SimpleSpring, Eigen::aligned_allocator<SimpleSpring> > m_springs;
+
+    AutoTuner  *m_tuner;
+
+    // per spring, kept apart from the springs so that skipping the sleeping
+    // ones reads a byte each; concurrent updates of disjoint ranges write
+    // disjoint entries
+    SleepThresholds             m_sleep;
+    std::vector<unsigned char>  m_awake;
+    std::vector<double>         m_restTime;
+
+public:
+    SpringScene() : m_tuner(0) {}
+
+    // removes every spring and turns sleeping off
+    void clear();
+    void reserve(int n);
+
+    // adds a spring and returns its index
+    int addSpring(const SpringDescription &description);
+
+    // Springs loaded with "integrator=auto" are tuned by this tuner, whose
+    // cache then spares later loads the calibration.  Without one they are
+    // calibrated on every load.
+    void setAutoTuner(AutoTuner *tuner)         { m_tuner = tuner; }
+
+    // Populates the scene from a text file, replacing whatever was there.
+    // Returns false and describes the problem in error if the file could
+    // not be read; the scene is left empty in that case.
+    bool load(const std::string &filename, std::string *error = 0);
+    bool load(std::istream &in, std::string *error = 0);
+
+    // Saves the complete state of every spring as a binary checkpoint, or
+    // replaces the scene with one restored from a checkpoint.  On failure
+    // error describes the problem; a failed save leaves the scene as it
+    // was, and a failed restore leaves it empty.
+    bool saveCheckpoint(const std::string &filename, std::string *error = 0) const;
+    bool saveCheckpoint(std::ostream &out) const;
+    bool restoreCheckpoint(const std::string &filename, std::string *error = 0);
+    bool restoreCheckpoint(std::istream &in, std::string *error = 0);
+
+    // largest difference between corresponding spring states of two scenes,
+    // for comparing runs forked from the same checkpoint
+    double maxStateDifference(const SpringScene &other) const;
+
+    // the scene shown by the demo: one spring for each integrator
+    void createDefault();
+
+    int size() const                            { return int(m_springs.size()); }
+    SimpleSpring &spring(int i)                 { return m_springs[i]; }
+    const SimpleSpring &spring(int i) const     { return m_springs[i]; }
+    IntegratorType integratorType(int i) const  { return m_springs[i].integratorType(); }
+
+    // changes a parameter of one spring, or of all springs if index < 0
+    void setParameter(int index, SpringParameter parameter, double value);
+
+    // lets springs that come to rest sleep; the default thresholds keep
+    // every spring awake
+    void setSleeping(const SleepThresholds &thresholds);
+    const SleepThresholds &sleeping() const     { return m_sleep; }
+
+    // wakes one spring, or all springs if index < 0
+    void wake(int index = -1);
+    bool isAwake(int i) const                   { return m_awake[i] != 0; }
+    int awakeCount() const;
+
+    // pushes a spring, changing its velocity by impulse / mass, and wakes it
+    void applyImpulse(int index, double impulse);
+
+    // advances springs [first, last) by the elapsed time, or by a single
+    // step of their own time step if elapsed is negative
+    void update(double elapsed = -1.0, int first = 0, int last = -1);
+    void reset();
+
+    double maxTimeStep() const;
+
+    // work done by the integrators of springs [first, last), summed
+    IntegratorCounters counters(int first = 0, int last = -1) const;
+    void resetCounters();
+
+    // Writes every spring's counters as CSV, one row per spring, for
+    // attributing cost to integrators and operations with other tools.
+    bool writeCounters(const std::string &filename, std::string *error = 0) const;
+    void writeCounters(std::ostream &out) const;
+};
+
+// --------------------------------------------------------------------------
+
+#endif // SPRINGSCENE_H
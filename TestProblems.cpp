@@ -0,0 +1,305 @@
+#include "TestProblems.h"
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace Eigen;
+
+// --------------------------------------------------------------------------
+
+void TestProblem::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    int n = int(y.size());
+    J.resize(n, n);
+
+    StateType f = derivativeFunction(t, y);
+    StateType shifted = y;
+    for (int j = 0; j < n; ++j) {
+        double h = sqrt(numeric_limits<double>::epsilon()) * max(1.0, abs(y(j)));
+        shifted(j) = y(j) + h;
+        J.col(j) = (derivativeFunction(t, shifted) - f) / h;
+        shifted(j) = y(j);
+    }
+}
+
+TestProblem::StateType TestProblem::reference() const
+{
+    if (m_reference.size() == 0)
+    {
+        // the outer steps only bound the substeps, which adapt freely
+        const int steps = 100;
+        DormandPrinceIntegrator<StateType> integrator(const_cast<TestProblem *>(this),
+                                                      endTime() / steps);
+        integrator.setTolerance(1e-12);
+        integrator.setState(initialState());
+        for (int i = 0; i < steps; ++i) integrator.step();
+        m_reference = integrator.state();
+    }
+    return m_reference;
+}
+
+// --------------------------------------------------------------------------
+
+VanDerPol::StateType VanDerPol::initialState() const
+{
+    return Vector2d(2.0, 0.0);
+}
+
+VanDerPol::StateType VanDerPol::derivativeFunction(double t, const StateType &y) const
+{
+    return Vector2d(y(1), m_mu * (1.0 - y(0) * y(0)) * y(1) - y(0));
+}
+
+void VanDerPol::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    J.resize(2, 2);
+    J << 0.0,                             1.0,
+         -2.0 * m_mu * y(0) * y(1) - 1.0,  m_mu * (1.0 - y(0) * y(0));
+}
+
+// --------------------------------------------------------------------------
+
+Duffing::StateType Duffing::initialState() const
+{
+    return Vector2d(1.0, 0.0);
+}
+
+Duffing::StateType Duffing::derivativeFunction(double t, const StateType &y) const
+{
+    double x = y(0), v = y(1);
+    return Vector2d(v, m_gamma * cos(m_omega * t) - m_delta * v - m_alpha * x - m_beta * x * x * x);
+}
+
+void Duffing::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    J.resize(2, 2);
+    J << 0.0,                                   1.0,
+         -m_alpha - 3.0 * m_beta * y(0) * y(0),  -m_delta;
+}
+
+double Duffing::invariant(const StateType &y) const
+{
+    double x = y(0), v = y(1);
+    return 0.5 * v * v + 0.5 * m_alpha * x * x + 0.25 * m_beta * x * x * x * x;
+}
+
+// --------------------------------------------------------------------------
+
+DoublePendulum::StateType DoublePendulum::initialState() const
+{
+    return Vector4d(0.5 * M_PI, 0.5 * M_PI, 0.0, 0.0);
+}
+
+DoublePendulum::StateType DoublePendulum::derivativeFunction(double t, const StateType &y) const
+{
+    double m1 = m_mass1, m2 = m_mass2, l1 = m_length1, l2 = m_length2, g = m_gravity;
+    double theta1 = y(0), theta2 = y(1), omega1 = y(2), omega2 = y(3);
+    double delta = theta1 - theta2;
+    double denominator = 2.0 * m1 + m2 - m2 * cos(2.0 * delta);
+
+    double alpha1 = (-g * (2.0 * m1 + m2) * sin(theta1) - m2 * g * sin(theta1 - 2.0 * theta2)
+                     - 2.0 * sin(delta) * m2 * (omega2 * omega2 * l2 + omega1 * omega1 * l1 * cos(delta)))
+                    / (l1 * denominator);
+    double alpha2 = 2.0 * sin(delta) * (omega1 * omega1 * l1 * (m1 + m2) + g * (m1 + m2) * cos(theta1)
+                                        + omega2 * omega2 * l2 * m2 * cos(delta))
+                    / (l2 * denominator);
+
+    return Vector4d(omega1, omega2, alpha1, alpha2);
+}
+
+double DoublePendulum::invariant(const StateType &y) const
+{
+    double m1 = m_mass1, m2 = m_mass2, l1 = m_length1, l2 = m_length2, g = m_gravity;
+    double theta1 = y(0), theta2 = y(1), omega1 = y(2), omega2 = y(3);
+
+    double kinetic = 0.5 * m1 * l1 * l1 * omega1 * omega1
+                   + 0.5 * m2 * (l1 * l1 * omega1 * omega1 + l2 * l2 * omega2 * omega2
+                                 + 2.0 * l1 * l2 * omega1 * omega2 * cos(theta1 - theta2));
+    double potential = -(m1 + m2) * g * l1 * cos(theta1) - m2 * g * l2 * cos(theta2);
+    return kinetic + potential;
+}
+
+// --------------------------------------------------------------------------
+
+Lorenz::StateType Lorenz::initialState() const
+{
+    return Vector3d(1.0, 1.0, 1.0);
+}
+
+Lorenz::StateType Lorenz::derivativeFunction(double t, const StateType &y) const
+{
+    return Vector3d(m_sigma * (y(1) - y(0)),
+                    y(0) * (m_rho - y(2)) - y(1),
+                    y(0) * y(1) - m_beta * y(2));
+}
+
+void Lorenz::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    J.resize(3, 3);
+    J << -m_sigma,       m_sigma,  0.0,
+         m_rho - y(2),   -1.0,     -y(0),
+         y(1),           y(0),     -m_beta;
+}
+
+// --------------------------------------------------------------------------
+
+static const double k_robertson1 = 0.04, k_robertson2 = 3e7, k_robertson3 = 1e4;
+
+Robertson::StateType Robertson::initialState() const
+{
+    return Vector3d(1.0, 0.0, 0.0);
+}
+
+Robertson::StateType Robertson::derivativeFunction(double t, const StateType &y) const
+{
+    double a = k_robertson1 * y(0);
+    double b = k_robertson2 * y(1) * y(1);
+    double c = k_robertson3 * y(1) * y(2);
+    return Vector3d(-a + c, a - b - c, b);
+}
+
+void Robertson::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    J.resize(3, 3);
+    J << -k_robertson1,  k_robertson3 * y(2),                              k_robertson3 * y(1),
+         k_robertson1,   -2.0 * k_robertson2 * y(1) - k_robertson3 * y(2),  -k_robertson3 * y(1),
+         0.0,            2.0 * k_robertson2 * y(1),                        0.0;
+}
+
+// --------------------------------------------------------------------------
+
+Hires::StateType Hires::initialState() const
+{
+    StateType y = StateType::Zero(8);
+    y(0) = 1.0;
+    y(7) = 0.0057;
+    return y;
+}
+
+Hires::StateType Hires::derivativeFunction(double t, const StateType &y) const
+{
+    StateType f(8);
+    f(0) = -1.71 * y(0) + 0.43 * y(1) + 8.32 * y(2) + 0.0007;
+    f(1) = 1.71 * y(0) - 8.75 * y(1);
+    f(2) = -10.03 * y(2) + 0.43 * y(3) + 0.035 * y(4);
+    f(3) = 8.32 * y(1) + 1.71 * y(2) - 1.12 * y(3);
+    f(4) = -1.745 * y(4) + 0.43 * y(5) + 0.43 * y(6);
+    f(5) = -280.0 * y(5) * y(7) + 0.69 * y(3) + 1.71 * y(4) - 0.43 * y(5) + 0.69 * y(6);
+    f(6) = 280.0 * y(5) * y(7) - 1.81 * y(6);
+    f(7) = -f(6);
+    return f;
+}
+
+void Hires::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    J.setZero(8, 8);
+    J(0, 0) = -1.71;    J(0, 1) = 0.43;     J(0, 2) = 8.32;
+    J(1, 0) = 1.71;     J(1, 1) = -8.75;
+    J(2, 2) = -10.03;   J(2, 3) = 0.43;     J(2, 4) = 0.035;
+    J(3, 1) = 8.32;     J(3, 2) = 1.71;     J(3, 3) = -1.12;
+    J(4, 4) = -1.745;   J(4, 5) = 0.43;     J(4, 6) = 0.43;
+    J(5, 3) = 0.69;     J(5, 4) = 1.71;     J(5, 5) = -0.43 - 280.0 * y(7);
+    J(5, 6) = 0.69;     J(5, 7) = -280.0 * y(5);
+    J(6, 5) = 280.0 * y(7);     J(6, 6) = -1.81;    J(6, 7) = 280.0 * y(5);
+    J.row(7) = -J.row(6);
+}
+
+// the published solution at the end time
+Hires::StateType Hires::reference() const
+{
+    StateType y(8);
+    y << 0.7371312573325668e-3, 0.1442485726316185e-3, 0.5888729740967575e-4,
+         0.1175651343283149e-2, 0.2386356198831331e-2, 0.6238968252742796e-2,
+         0.2849998395185769e-2, 0.2850001604814231e-2;
+    return y;
+}
+
+// --------------------------------------------------------------------------
+
+Brusselator::StateType Brusselator::initialState() const
+{
+    int n = m_points;
+    StateType y(2 * n);
+    for (int i = 0; i < n; ++i) {
+        double x = double(i + 1) / (n + 1);
+        y(i)     = 1.0 + sin(2.0 * M_PI * x);
+        y(n + i) = 3.0;
+    }
+    return y;
+}
+
+Brusselator::StateType Brusselator::derivativeFunction(double t, const StateType &y) const
+{
+    int n = m_points;
+    double c = m_alpha * (n + 1) * (n + 1);
+    StateType f(2 * n);
+
+    // the boundary values are held at u = 1, v = 3
+    for (int i = 0; i < n; ++i)
+    {
+        double u = y(i), v = y(n + i);
+        double uLeft  = i > 0     ? y(i - 1)     : 1.0;
+        double uRight = i < n - 1 ? y(i + 1)     : 1.0;
+        double vLeft  = i > 0     ? y(n + i - 1) : 3.0;
+        double vRight = i < n - 1 ? y(n + i + 1) : 3.0;
+
+        f(i)     = 1.0 + u * u * v - 4.0 * u + c * (uLeft - 2.0 * u + uRight);
+        f(n + i) = 3.0 * u - u * u * v + c * (vLeft - 2.0 * v + vRight);
+    }
+    return f;
+}
+
+void Brusselator::jacobian(double t, const StateType &y, MatrixType &J) const
+{
+    int n = m_points;
+    double c = m_alpha * (n + 1) * (n + 1);
+    J.setZero(2 * n, 2 * n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        double u = y(i), v = y(n + i);
+        J(i, i)             = 2.0 * u * v - 4.0 - 2.0 * c;
+        J(i, n + i)         = u * u;
+        J(n + i, i)         = 3.0 - 2.0 * u * v;
+        J(n + i, n + i)     = -u * u - 2.0 * c;
+        if (i > 0)     { J(i, i - 1) = c;   J(n + i, n + i - 1) = c; }
+        if (i < n - 1) { J(i, i + 1) = c;   J(n + i, n + i + 1) = c; }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+static const char *k_testProblemNames[TestProblemCount] = {
+    "vanderpol", "duffing", "pendulum", "lorenz", "robertson", "hires", "brusselator"
+};
+
+const char *testProblemName(TestProblemType type)
+{
+    return type < TestProblemCount ? k_testProblemNames[type] : "unknown";
+}
+
+bool parseTestProblemType(const string &name, TestProblemType *type)
+{
+    for (int i = 0; i < TestProblemCount; ++i)
+        if (name == k_testProblemNames[i]) {
+            *type = TestProblemType(i);
+            return true;
+        }
+    return false;
+}
+
+unique_ptr<TestProblem> createTestProblem(TestProblemType type)
+{
+    switch (type) {
+    case VanDerPolProblem:      return unique_ptr<TestProblem>(new VanDerPol);
+    case DuffingProblem:        return unique_ptr<TestProblem>(new Duffing);
+    case DoublePendulumProblem: return unique_ptr<TestProblem>(new DoublePendulum);
+    case LorenzProblem:         return unique_ptr<TestProblem>(new Lorenz);
+    case RobertsonProblem:      return unique_ptr<TestProblem>(new Robertson);
+    case HiresProblem:          return unique_ptr<TestProblem>(new Hires);
+    case BrusselatorProblem:    return unique_ptr<TestProblem>(new Brusselator);
+    default:                    return unique_ptr<TestProblem>();
+    }
+}
+
+// --------------------------------------------------------------------------
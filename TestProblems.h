@@ -0,0 +1,206 @@
+#ifndef TESTPROBLEMS_H
+#define TESTPROBLEMS_H
+
+#include <memory>
+#include <string>
+
+#include "Eigen/Core"
+#include "Integrators.h"
+
+// --------------------------------------------------------------------------
+
+// Well-known initial value problems for measuring the integrators on
+// nonlinear, chaotic and stiff workloads, where SimpleSpring is linear and
+// mild.  Each problem has a standard initial state and end time, and a
+// reference solution at the end time; most also have a conserved quantity
+// whose drift shows an integrator's long-run behaviour.
+
+class TestProblem : public DifferentiableODE<Eigen::VectorXd, Eigen::MatrixXd>
+{
+    mutable Eigen::VectorXd m_reference;
+
+public:
+    typedef Eigen::VectorXd StateType;
+    typedef Eigen::MatrixXd MatrixType;
+
+    virtual ~TestProblem() {}
+
+    virtual const char *name() const = 0;
+    virtual StateType initialState() const = 0;
+    virtual double endTime() const = 0;
+
+    // true if explicit integrators need steps far below the accuracy
+    // required, i.e. the problem is stiff
+    virtual bool isStiff() const                        { return false; }
+
+    // by forward differences, unless the problem overrides it
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+
+    // a quantity the exact solution keeps constant, if there is one
+    virtual bool hasInvariant() const                   { return false; }
+    virtual double invariant(const StateType &y) const  { return 0.0; }
+
+    // The state at endTime().  Unless a problem gives a published value,
+    // it is computed once with the adaptive integrator at a tolerance of
+    // 1e-12, which takes a moment for the stiff problems.
+    virtual StateType reference() const;
+};
+
+// --------------------------------------------------------------------------
+
+// x'' = mu (1 - x^2) x' - x, a relaxation oscillator; stiff for large mu.
+class VanDerPol : public TestProblem
+{
+    double m_mu;
+
+public:
+    explicit VanDerPol(double mu = 10.0) : m_mu(mu) {}
+
+    virtual const char *name() const                { return "vanderpol"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 2.0 * m_mu; }
+    virtual bool isStiff() const                    { return m_mu > 100.0; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+};
+
+// x'' + delta x' + alpha x + beta x^3 = gamma cos(omega t), a hardening
+// spring.  Unforced and undamped (the default) it conserves its energy;
+// with delta = 0.3, alpha = -1, beta = 1, gamma = 0.5, omega = 1.2 it is
+// chaotic.
+class Duffing : public TestProblem
+{
+    double m_delta, m_alpha, m_beta, m_gamma, m_omega;
+
+public:
+    Duffing(double delta = 0.0, double alpha = 1.0, double beta = 1.0,
+            double gamma = 0.0, double omega = 1.0)
+        : m_delta(delta), m_alpha(alpha), m_beta(beta), m_gamma(gamma), m_omega(omega) {}
+
+    virtual const char *name() const                { return "duffing"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 20.0; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+
+    virtual bool hasInvariant() const               { return m_delta == 0.0 && m_gamma == 0.0; }
+    virtual double invariant(const StateType &y) const;
+};
+
+// Two point masses on rigid rods, released from horizontal; chaotic, and
+// conserves its energy.  The state is [theta1, theta2, omega1, omega2].
+class DoublePendulum : public TestProblem
+{
+    double m_mass1, m_mass2, m_length1, m_length2, m_gravity;
+
+public:
+    DoublePendulum(double m1 = 1.0, double m2 = 1.0, double l1 = 1.0, double l2 = 1.0,
+                   double g = 9.81)
+        : m_mass1(m1), m_mass2(m2), m_length1(l1), m_length2(l2), m_gravity(g) {}
+
+    virtual const char *name() const                { return "pendulum"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 5.0; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+
+    virtual bool hasInvariant() const               { return true; }
+    virtual double invariant(const StateType &y) const;
+};
+
+// The Lorenz attractor with the classic sigma = 10, rho = 28, beta = 8/3.
+class Lorenz : public TestProblem
+{
+    double m_sigma, m_rho, m_beta;
+
+public:
+    Lorenz(double sigma = 10.0, double rho = 28.0, double beta = 8.0 / 3.0)
+        : m_sigma(sigma), m_rho(rho), m_beta(beta) {}
+
+    virtual const char *name() const                { return "lorenz"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 5.0; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+};
+
+// Robertson's chemical kinetics, the classic stiff problem; conserves the
+// total concentration y1 + y2 + y3.
+class Robertson : public TestProblem
+{
+public:
+    virtual const char *name() const                { return "robertson"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 40.0; }
+    virtual bool isStiff() const                    { return true; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+
+    virtual bool hasInvariant() const               { return true; }
+    virtual double invariant(const StateType &y) const  { return y.sum(); }
+};
+
+// HIRES, eight stiff reactions of plant physiology, from the IVP test set
+// of Mazzia and Magherini; conserves y7 + y8.
+class Hires : public TestProblem
+{
+public:
+    virtual const char *name() const                { return "hires"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 321.8122; }
+    virtual bool isStiff() const                    { return true; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+    virtual StateType reference() const;
+
+    virtual bool hasInvariant() const               { return true; }
+    virtual double invariant(const StateType &y) const  { return y(6) + y(7); }
+};
+
+// The one-dimensional Brusselator reaction-diffusion system discretized on
+// n interior points (Hairer and Wanner), a larger, mildly stiff problem
+// with a banded Jacobian.  The state is [u1..un, v1..vn].
+class Brusselator : public TestProblem
+{
+    int     m_points;
+    double  m_alpha;
+
+public:
+    explicit Brusselator(int n = 32, double alpha = 0.02) : m_points(n), m_alpha(alpha) {}
+
+    virtual const char *name() const                { return "brusselator"; }
+    virtual StateType initialState() const;
+    virtual double endTime() const                  { return 10.0; }
+
+    virtual StateType derivativeFunction(double t, const StateType &y) const;
+    virtual void jacobian(double t, const StateType &y, MatrixType &J) const;
+};
+
+// --------------------------------------------------------------------------
+
+enum TestProblemType
+{
+    VanDerPolProblem,
+    DuffingProblem,
+    DoublePendulumProblem,
+    LorenzProblem,
+    RobertsonProblem,
+    HiresProblem,
+    BrusselatorProblem,
+    TestProblemCount
+};
+
+const char *testProblemName(TestProblemType type);
+bool parseTestProblemType(const std::string &name, TestProblemType *type);
+
+// the problem with its standard parameters
+std::unique_ptr<TestProblem> createTestProblem(TestProblemType type);
+
+// --------------------------------------------------------------------------
+
+#endif // TESTPROBLEMS_H
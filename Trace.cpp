@@ -0,0 +1,214 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+namespace Trace {
+
+atomic<bool> g_enabled(false);
+
+namespace {
+
+struct Event
+{
+    const char *name;
+    long long   start;
+    long long   end;
+};
+
+// Written only by its own thread.  Readers copy the events and then check
+// the head again, discarding any that may have been overwritten meanwhile.
+struct Ring
+{
+    static const size_t k_capacity = 1 << 16;      // events, power of two
+
+    vector<Event>           events;
+    atomic<size_t>          head;
+    atomic<size_t>          clearedAt;          // head when last cleared
+    int                     thread;
+    string                  name;
+
+    // guarded by g_ringsMutex
+    bool                    finished;           // its thread has exited
+    size_t                  exportedTo;         // head when last written out
+
+    Ring(int id) : events(k_capacity), head(0), clearedAt(0), thread(id), finished(false),
+                   exportedTo(0) {}
+
+    // nothing left that a trace has not shown or has been told to drop
+    bool isSpent() const
+    {
+        size_t h = head.load();
+        return finished && (h == clearedAt.load() || exportedTo == h);
+    }
+};
+
+mutex                       g_ringsMutex;
+vector<unique_ptr<Ring> >   g_rings;
+int                         g_threadCount = 0;
+
+// A thread's name, and its ring once it first records.  Rings outlive
+// their threads, so that finished threads still show up in traces, but
+// once a finished thread's events have been written out or cleared its
+// ring is handed to the next thread that needs one.
+struct ThreadState
+{
+    Ring       *ring;
+    string      name;
+
+    ThreadState() : ring(0) {}
+    ~ThreadState()
+    {
+        if (!ring) return;
+        lock_guard<mutex> lock(g_ringsMutex);
+        ring->finished = true;
+    }
+};
+
+thread_local ThreadState t_thread;
+
+Ring &threadRing()
+{
+    if (!t_thread.ring) {
+        lock_guard<mutex> lock(g_ringsMutex);
+        for (size_t i = 0; i < g_rings.size() && !t_thread.ring; ++i)
+            if (g_rings[i]->isSpent()) t_thread.ring = g_rings[i].get();
+        if (t_thread.ring) {
+            Ring &ring = *t_thread.ring;
+            ring.clearedAt.store(ring.head.load());
+            ring.finished = false;
+        }
+        else {
+            g_rings.push_back(unique_ptr<Ring>(new Ring(0)));
+            t_thread.ring = g_rings.back().get();
+        }
+        t_thread.ring->thread = ++g_threadCount;
+        t_thread.ring->name = t_thread.name;
+    }
+    return *t_thread.ring;
+}
+
+void writeString(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        if (*s >= 0 && *s < 0x20) fputc(' ', out);
+        else fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+}
+
+// --------------------------------------------------------------------------
+
+void setEnabled(bool enabled)
+{
+    if (enabled && !isEnabled()) {
+        // threads own their heads, so mark where the new trace starts
+        // instead of resetting them
+        lock_guard<mutex> lock(g_ringsMutex);
+        for (size_t i = 0; i < g_rings.size(); ++i)
+            g_rings[i]->clearedAt.store(g_rings[i]->head.load());
+    }
+    g_enabled.store(enabled);
+}
+
+void setThreadName(const char *name)
+{
+    // the ring, if any, takes the name when it is made
+    t_thread.name = name;
+    if (t_thread.ring) {
+        lock_guard<mutex> lock(g_ringsMutex);
+        t_thread.ring->name = name;
+    }
+}
+
+long long now()
+{
+    static const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char *name, long long start, long long end)
+{
+    Ring &ring = threadRing();
+    size_t head = ring.head.load(memory_order_relaxed);
+
+    Event &e = ring.events[head & (Ring::k_capacity - 1)];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+
+    ring.head.store(head + 1, memory_order_release);
+}
+
+bool writeChromeTrace(const string &filename, string *error)
+{
+    FILE *out = fopen(filename.c_str(), "w");
+    if (!out) {
+        if (error) *error = "could not open " + filename + " for writing";
+        return false;
+    }
+
+    lock_guard<mutex> lock(g_ringsMutex);
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    vector<Event> events;
+    for (size_t r = 0; r < g_rings.size(); ++r)
+    {
+        Ring &ring = *g_rings[r];
+
+        // copy the live part of the ring
+        size_t head = ring.head.load(memory_order_acquire);
+        size_t from = ring.clearedAt.load();
+        if (head - from > Ring::k_capacity) from = head - Ring::k_capacity;
+        events.clear();
+        for (size_t n = from; n != head; ++n)
+            events.push_back(ring.events[n & (Ring::k_capacity - 1)]);
+
+        // the thread kept going while we copied, and may have lapped us;
+        // a write still in flight goes to the slot of event after - capacity
+        atomic_thread_fence(memory_order_acquire);
+        size_t after = ring.head.load(memory_order_relaxed);
+        size_t skip = after - from >= Ring::k_capacity
+                    ? min(events.size(), after - from - Ring::k_capacity + 1) : 0;
+        ring.exportedTo = head;
+
+        if (!ring.name.empty()) {
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":", first ? "" : ",\n", ring.thread);
+            writeString(out, ring.name.c_str());
+            fprintf(out, "}}");
+            first = false;
+        }
+
+        // complete ("X") events, with times in microseconds
+        for (size_t i = skip; i < events.size(); ++i) {
+            const Event &e = events[i];
+            fprintf(out, "%s{\"name\":", first ? "" : ",\n");
+            writeString(out, e.name);
+            fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    ring.thread, e.start / 1000.0, (e.end - e.start) / 1000.0);
+            first = false;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+    bool ok = !ferror(out);
+    ok = fclose(out) == 0 && ok;
+    if (!ok && error) *error = "could not write " + filename;
+    return ok;
+}
+
+}
+
+// --------------------------------------------------------------------------
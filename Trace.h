@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+// --------------------------------------------------------------------------
+
+// Scoped trace zones for seeing where the time goes, e.g.
+//
+//      void MyGLWidget::paintGL()
+//      {
+//          TRACE_ZONE("paintGL");
+//          ...
+//      }
+//
+// While tracing is enabled, each zone leaves one event, holding its start
+// time and duration, in a ring buffer owned by the calling thread, so
+// recording never takes a lock; when a ring is full its oldest events are
+// overwritten.  The collected events can be written out at any time as a
+// Chrome trace (load it in chrome://tracing or Perfetto).  A thread gets
+// its ring when it first records; once the thread has exited and its
+// events have been written out, the ring goes to the next new thread.
+//
+// While tracing is disabled a zone costs one relaxed atomic load, so zones
+// can stay in release builds.  Defining TRACE_DISABLED removes them
+// altogether.  Zone names must be string literals, or otherwise outlive
+// the trace.
+
+namespace Trace {
+
+extern std::atomic<bool> g_enabled;
+
+inline bool isEnabled()     { return g_enabled.load(std::memory_order_relaxed); }
+
+// clears any previously collected events when tracing is switched on
+void setEnabled(bool enabled);
+
+// names the calling thread in exported traces
+void setThreadName(const char *name);
+
+// nanoseconds on a monotonic clock
+long long now();
+
+// adds a finished zone to the calling thread's ring
+void record(const char *name, long long start, long long end);
+
+// writes every thread's events as Chrome trace event JSON
+bool writeChromeTrace(const std::string &filename, std::string *error = 0);
+
+class Zone
+{
+    const char *m_name;
+    long long   m_start;
+
+    Zone(const Zone &);
+    Zone &operator=(const Zone &);
+
+public:
+    explicit Zone(const char *name) : m_name(name), m_start(isEnabled() ? now() : -1) {}
+    ~Zone() { if (m_start >= 0) record(m_name, m_start, now()); }
+};
+
+}
+
+#define TRACE_CONCAT2(a, b)     a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT2(a, b)
+
+#if defined(TRACE_DISABLED)
+#define TRACE_ZONE(name)        ((void)0)
+#else
+#define TRACE_ZONE(name)        Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#endif
+
+// --------------------------------------------------------------------------
+
+#endif // TRACE_H
@@ -0,0 +1,313 @@
+#include "TrajectoryRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+static const char           k_trajectoryMagic[8]    = { 'S', 'P', 'R', 'T', 'R', 'A', 'J', '1' };
+static const char           k_trajectoryEnd[8]      = { 'S', 'P', 'R', 'T', 'R', 'A', 'J', 'E' };
+static const unsigned int   k_trajectoryVersion     = 1;
+
+static bool chunkBefore(const TrajectoryChunkInfo &a, const TrajectoryChunkInfo &b)
+{
+    return a.minTime < b.minTime;
+}
+
+// --------------------------------------------------------------------------
+
+TrajectoryRecorder::Producer::Producer(int stateSize, size_t capacity)
+    : m_stateSize(stateSize), m_recordSize(stateSize + 2), m_capacity(1),
+      m_head(0), m_stalls(0), m_tail(0)
+{
+    while (m_capacity < capacity) m_capacity <<= 1;
+    m_ring.resize(m_capacity * m_recordSize);
+}
+
+// --------------------------------------------------------------------------
+
+TrajectoryRecorder::TrajectoryRecorder(size_t chunkRecords)
+    : m_stateSize(0), m_chunkRecords(chunkRecords), m_file(0), m_offset(0),
+      m_writeFailed(false), m_stopRequested(false), m_recordCount(0)
+{}
+
+bool TrajectoryRecorder::start(const string &filename, int stateSize, string *error)
+{
+    stop();
+
+    m_file = fopen(filename.c_str(), "wb");
+    if (!m_file) {
+        if (error) *error = "could not open " + filename + " for writing";
+        return false;
+    }
+
+    m_filename = filename;
+    m_stateSize = stateSize;
+    m_offset = 0;
+    m_writeFailed = false;
+    m_recordCount = 0;
+    m_index.clear();
+    m_times.clear();
+    m_ids.clear();
+    m_states.assign(stateSize, vector<double>());
+
+    unsigned int version = k_trajectoryVersion, size = stateSize;
+    writeBytes(k_trajectoryMagic, sizeof(k_trajectoryMagic));
+    writeBytes(&version, sizeof(version));
+    writeBytes(&size, sizeof(size));
+
+    m_stopRequested = false;
+    m_writer = thread(&TrajectoryRecorder::writerLoop, this);
+    return true;
+}
+
+TrajectoryRecorder::Producer *TrajectoryRecorder::createProducer(size_t capacity)
+{
+    lock_guard<mutex> lock(m_producersMutex);
+    m_producers.push_back(unique_ptr<Producer>(new Producer(m_stateSize, capacity)));
+    return m_producers.back().get();
+}
+
+bool TrajectoryRecorder::stop(string *error)
+{
+    if (!m_file) return true;
+
+    m_stopRequested = true;
+    m_writer.join();
+
+    // the writer drained everything before exiting, so finish the file
+    writeChunk();
+    sort(m_index.begin(), m_index.end(), chunkBefore);
+
+    unsigned long long indexOffset = m_offset, chunkCount = m_index.size();
+    if (!m_index.empty())
+        writeBytes(&m_index[0], m_index.size() * sizeof(TrajectoryChunkInfo));
+    writeBytes(&indexOffset, sizeof(indexOffset));
+    writeBytes(&chunkCount, sizeof(chunkCount));
+    writeBytes(k_trajectoryEnd, sizeof(k_trajectoryEnd));
+
+    bool ok = !m_writeFailed;
+    ok = fclose(m_file) == 0 && ok;
+    m_file = 0;
+    m_producers.clear();
+    if (!ok && error) *error = "could not write " + m_filename;
+    return ok;
+}
+
+// --------------------------------------------------------------------------
+
+void TrajectoryRecorder::writerLoop()
+{
+    vector<Producer *> producers;
+    for (;;)
+    {
+        // check the flag before draining, so that nothing recorded before
+        // stop() was called can be missed
+        bool stopping = m_stopRequested.load();
+        {
+            lock_guard<mutex> lock(m_producersMutex);
+            producers.clear();
+            for (size_t i = 0; i < m_producers.size(); ++i)
+                producers.push_back(m_producers[i].get());
+        }
+
+        size_t drained = 0;
+        for (size_t i = 0; i < producers.size(); ++i)
+            drained += drain(*producers[i]);
+
+        if (stopping) break;
+        if (drained == 0) this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+size_t TrajectoryRecorder::drain(Producer &p)
+{
+    size_t tail = p.m_tail.load(memory_order_relaxed);
+    size_t head = p.m_head.load(memory_order_acquire);
+
+    for (size_t n = tail; n != head; ++n)
+    {
+        const double *r = &p.m_ring[(n & (p.m_capacity - 1)) * p.m_recordSize];
+        m_times.push_back(r[0]);
+        m_ids.push_back(unsigned(r[1]));
+        for (int k = 0; k < m_stateSize; ++k)
+            m_states[k].push_back(r[2 + k]);
+
+        if (m_times.size() >= m_chunkRecords) writeChunk();
+    }
+
+    p.m_tail.store(head, memory_order_release);
+    m_recordCount += head - tail;
+    return head - tail;
+}
+
+void TrajectoryRecorder::writeChunk()
+{
+    if (m_times.empty()) return;
+
+    TrajectoryChunkInfo info;
+    info.offset = m_offset;
+    info.count = m_times.size();
+    info.minTime = *min_element(m_times.begin(), m_times.end());
+    info.maxTime = *max_element(m_times.begin(), m_times.end());
+    m_index.push_back(info);
+
+    // pad the id column so that the state columns stay 8-byte aligned
+    if (m_ids.size() % 2) m_ids.push_back(0);
+
+    writeBytes(&info.count, sizeof(info.count));
+    writeBytes(&m_times[0], m_times.size() * sizeof(double));
+    writeBytes(&m_ids[0], m_ids.size() * sizeof(unsigned));
+    for (int k = 0; k < m_stateSize; ++k)
+        writeBytes(&m_states[k][0], m_states[k].size() * sizeof(double));
+
+    m_times.clear();
+    m_ids.clear();
+    for (int k = 0; k < m_stateSize; ++k)
+        m_states[k].clear();
+}
+
+// after a short write the offsets no longer match the file, so stop
+// writing; the writer still drains the producers, so they never block
+void TrajectoryRecorder::writeBytes(const void *data, size_t size)
+{
+    if (m_writeFailed) return;
+    if (fwrite(data, 1, size, m_file) != size) {
+        m_writeFailed = true;
+        return;
+    }
+    m_offset += size;
+}
+
+// --------------------------------------------------------------------------
+
+TrajectoryFile::TrajectoryFile()
+    : m_data(0), m_size(0), m_stateSize(0), m_index(0), m_chunkCount(0)
+{}
+
+bool TrajectoryFile::open(const string &filename, string *error)
+{
+    close();
+
+#if defined(_WIN32)
+    ifstream in(filename.c_str(), ios::binary);
+    m_contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    if (!in.eof() && !in) {
+        if (error) *error = "could not read " + filename;
+        return false;
+    }
+    m_data = m_contents.empty() ? 0 : &m_contents[0];
+    m_size = m_contents.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) ::close(fd);
+        if (error) *error = "could not open " + filename;
+        return false;
+    }
+    m_size = size_t(st.st_size);
+    void *mapping = m_size > 0 ? mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        m_size = 0;
+        if (error) *error = "could not map " + filename;
+        return false;
+    }
+    m_data = static_cast<const char *>(mapping);
+#endif
+
+    // validate the header and footer before trusting any offsets
+    const size_t headerSize = 16, footerSize = 24;
+    unsigned long long indexOffset = 0, chunkCount = 0;
+    unsigned int version = 0, stateSize = 0;
+    bool valid = m_size >= headerSize + footerSize &&
+                 memcmp(m_data, k_trajectoryMagic, 8) == 0 &&
+                 memcmp(m_data + m_size - 8, k_trajectoryEnd, 8) == 0;
+    if (valid) {
+        memcpy(&version, m_data + 8, sizeof(version));
+        memcpy(&stateSize, m_data + 12, sizeof(stateSize));
+        memcpy(&indexOffset, m_data + m_size - footerSize, sizeof(indexOffset));
+        memcpy(&chunkCount, m_data + m_size - footerSize + 8, sizeof(chunkCount));
+        valid = version == k_trajectoryVersion && indexOffset % 8 == 0 &&
+                indexOffset >= headerSize && indexOffset <= m_size - footerSize &&
+                chunkCount <= (m_size - footerSize - indexOffset) / sizeof(TrajectoryChunkInfo) &&
+                indexOffset + chunkCount * sizeof(TrajectoryChunkInfo) + footerSize == m_size;
+    }
+
+    // and every chunk must lie between the header and the index
+    const TrajectoryChunkInfo *index =
+        valid ? reinterpret_cast<const TrajectoryChunkInfo *>(m_data + indexOffset) : 0;
+    unsigned long long recordBytes = sizeof(double) + sizeof(unsigned) + 8ull * stateSize;
+    for (unsigned long long i = 0; valid && i < chunkCount; ++i)
+    {
+        unsigned long long offset = index[i].offset, count = index[i].count;
+        valid = offset >= headerSize && offset % 8 == 0 && offset < indexOffset &&
+                indexOffset - offset >= sizeof(unsigned long long) &&
+                count <= (indexOffset - offset - sizeof(unsigned long long)) / recordBytes &&
+                offset + sizeof(unsigned long long) + count * recordBytes
+                    + (count % 2) * sizeof(unsigned) <= indexOffset;
+    }
+    if (!valid) {
+        close();
+        if (error) *error = filename + " is not a complete trajectory file";
+        return false;
+    }
+
+    m_stateSize = int(stateSize);
+    m_index = reinterpret_cast<const TrajectoryChunkInfo *>(m_data + indexOffset);
+    m_chunkCount = size_t(chunkCount);
+
+    m_latestTime.resize(m_chunkCount);
+    for (size_t i = 0; i < m_chunkCount; ++i)
+        m_latestTime[i] = i > 0 ? max(m_latestTime[i - 1], m_index[i].maxTime)
+                                : m_index[i].maxTime;
+    return true;
+}
+
+void TrajectoryFile::close()
+{
+#if defined(_WIN32)
+    m_contents.clear();
+#else
+    if (m_data) munmap(const_cast<char *>(m_data), m_size);
+#endif
+    m_data = 0;
+    m_size = 0;
+    m_index = 0;
+    m_chunkCount = 0;
+    m_latestTime.clear();
+}
+
+TrajectoryFile::Chunk TrajectoryFile::chunk(size_t i) const
+{
+    const char *p = m_data + m_index[i].offset + sizeof(unsigned long long);
+    size_t count = size_t(m_index[i].count);
+
+    Chunk c;
+    c.count = count;
+    c.time  = reinterpret_cast<const double *>(p);
+    c.id    = reinterpret_cast<const unsigned *>(p + count * sizeof(double));
+    c.state = reinterpret_cast<const double *>(p + count * sizeof(double) +
+                                               (count + count % 2) * sizeof(unsigned));
+    return c;
+}
+
+size_t TrajectoryFile::findChunk(double t) const
+{
+    // chunks before the first whose running maximum reaches t all end
+    // before t, so the answer is found by binary search
+    return lower_bound(m_latestTime.begin(), m_latestTime.end(), t) - m_latestTime.begin();
+}
+
+// --------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Eigen/Core"
+
+// --------------------------------------------------------------------------
+
+// Trajectory files are written in chunks.  Each chunk stores its records
+// column by column (all the times, then all the system ids, then each state
+// component), 8-byte aligned, so a memory-mapped file can be read in place.
+// An index of the chunks sorted by their first time follows the last chunk,
+// and a fixed-size footer at the very end locates the index:
+//
+//      header:  magic[8]  version(u32)  stateSize(u32)
+//      chunk:   count(u64)  time[count]  id[count] (padded)  state_k[count]...
+//      index:   { offset(u64)  count(u64)  minTime  maxTime } per chunk
+//      footer:  indexOffset(u64)  chunkCount(u64)  magic[8]
+
+struct TrajectoryChunkInfo
+{
+    unsigned long long  offset;
+    unsigned long long  count;
+    double              minTime;
+    double              maxTime;
+};
+
+// --------------------------------------------------------------------------
+
+// Copies state snapshots off the stepping threads and writes them to disk
+// from a background thread.  Every stepping thread records through its own
+// Producer, a single-producer/single-consumer ring buffer, so recording
+// never takes a lock; if the writer falls behind, the producer spins until
+// there is room rather than dropping samples.
+
+class TrajectoryRecorder
+{
+public:
+    class Producer
+    {
+        friend class TrajectoryRecorder;
+
+        int                         m_stateSize;
+        int                         m_recordSize;       // in doubles
+        size_t                      m_capacity;         // in records, power of two
+        std::vector<double>         m_ring;
+
+        // producer-owned and consumer-owned positions on separate lines
+        char                        m_padding0[64];
+        std::atomic<size_t>         m_head;
+        long long                   m_stalls;
+        char                        m_padding1[64];
+        std::atomic<size_t>         m_tail;
+        char                        m_padding2[64];
+
+        Producer(int stateSize, size_t capacity);
+
+    public:
+        void record(double t, unsigned id, const double *state)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            while (head - m_tail.load(std::memory_order_acquire) >= m_capacity) {
+                ++m_stalls;
+                std::this_thread::yield();
+            }
+
+            double *r = &m_ring[(head & (m_capacity - 1)) * m_recordSize];
+            r[0] = t;
+            r[1] = double(id);
+            for (int k = 0; k < m_stateSize; ++k) r[2 + k] = state[k];
+
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        template <typename Derived>
+        void record(double t, unsigned id, const Eigen::DenseBase<Derived> &state)
+        {
+            // the state must be stored contiguously, like a plain vector
+            record(t, id, state.derived().data());
+        }
+
+        // number of times the producer had to wait for the writer
+        long long stalls() const    { return m_stalls; }
+    };
+
+private:
+    int                                     m_stateSize;
+    size_t                                  m_chunkRecords;
+    FILE                                   *m_file;
+    std::string                             m_filename;
+    unsigned long long                      m_offset;
+    bool                                    m_writeFailed;  // nothing more is written
+
+    std::mutex                              m_producersMutex;
+    std::vector<std::unique_ptr<Producer> > m_producers;
+
+    std::thread                             m_writer;
+    std::atomic<bool>                       m_stopRequested;
+    std::atomic<long long>                  m_recordCount;
+
+    // the chunk being filled by the writer, one column per vector
+    std::vector<double>                     m_times;
+    std::vector<unsigned>                   m_ids;
+    std::vector<std::vector<double> >       m_states;
+    std::vector<TrajectoryChunkInfo>        m_index;
+
+    void writerLoop();
+    size_t drain(Producer &p);
+    void writeChunk();
+    void writeBytes(const void *data, size_t size);
+
+    TrajectoryRecorder(const TrajectoryRecorder &);
+    TrajectoryRecorder &operator=(const TrajectoryRecorder &);
+
+public:
+    explicit TrajectoryRecorder(size_t chunkRecords = 1 << 16);
+    ~TrajectoryRecorder() { stop(); }
+
+    // opens the file and starts the background writer
+    bool start(const std::string &filename, int stateSize, std::string *error = 0);
+
+    // creates a producer for one stepping thread; it stays valid until
+    // stop() is called
+    Producer *createProducer(size_t capacity = 1 << 16);
+
+    // drains every producer, writes the index and closes the file; returns
+    // false if any of the file could not be written, which leaves it
+    // incomplete
+    bool stop(std::string *error = 0);
+
+    bool isRecording() const        { return m_file != 0; }
+    long long recordCount() const   { return m_recordCount.load(); }
+};
+
+// --------------------------------------------------------------------------
+
+// Read-only view of a trajectory file.  The file is memory-mapped, so the
+// column pointers handed out by chunk() point straight into the mapping.
+
+class TrajectoryFile
+{
+    const char                 *m_data;
+    size_t                      m_size;
+    int                         m_stateSize;
+    const TrajectoryChunkInfo  *m_index;
+    size_t                      m_chunkCount;
+    std::vector<double>         m_latestTime;   // running max of maxTime
+
+#if defined(_WIN32)
+    std::vector<char>           m_contents;
+#endif
+
+    TrajectoryFile(const TrajectoryFile &);
+    TrajectoryFile &operator=(const TrajectoryFile &);
+
+public:
+    struct Chunk
+    {
+        size_t          count;
+        const double   *time;
+        const unsigned *id;
+        const double   *state;      // component k starts at state + k * count
+
+        double component(int k, size_t i) const { return state[k * count + i]; }
+    };
+
+    TrajectoryFile();
+    ~TrajectoryFile() { close(); }
+
+    bool open(const std::string &filename, std::string *error = 0);
+    void close();
+
+    int stateSize() const                           { return m_stateSize; }
+    size_t chunkCount() const                       { return m_chunkCount; }
+    const TrajectoryChunkInfo &chunkInfo(size_t i) const { return m_index[i]; }
+
+    // chunks are numbered in order of their first time
+    Chunk chunk(size_t i) const;
+
+    // the first chunk that may contain records at time t, or chunkCount()
+    // if there is none
+    size_t findChunk(double t) const;
+};
+
+// --------------------------------------------------------------------------
+
+#endif // TRAJECTORYRECORDER_H
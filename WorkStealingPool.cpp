@@ -0,0 +1,108 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+using namespace std;
+
+// --------------------------------------------------------------------------
+
+WorkStealingPool::WorkStealingPool(int threads)
+    : m_task(0), m_generation(0), m_busy(0), m_remaining(0), m_stopping(false)
+{
+    if (threads <= 0) threads = max(1, int(thread::hardware_concurrency()));
+
+    for (int i = 0; i < threads; ++i)
+        m_workers.push_back(unique_ptr<Worker>(new Worker));
+    for (int i = 0; i < threads; ++i)
+        m_workers[i]->thread = thread(&WorkStealingPool::work, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->thread.join();
+}
+
+void WorkStealingPool::run(int count, const Task &task)
+{
+    if (count <= 0) return;
+
+    unique_lock<mutex> lock(m_mutex);
+
+    // a worker that woke late for the previous loop may still be looking
+    // for items, and must not find these ones under the old task
+    m_done.wait(lock, [this] { return m_busy == 0; });
+
+    int n = int(m_workers.size());
+    for (int w = 0; w < n; ++w) {
+        Worker &worker = *m_workers[w];
+        lock_guard<mutex> items(worker.mutex);
+        worker.first = int((long long)count * w / n);
+        worker.last = int((long long)count * (w + 1) / n);
+    }
+
+    m_task = &task;
+    m_remaining = count;
+    ++m_generation;
+    m_wake.notify_all();
+
+    m_done.wait(lock, [this] { return m_remaining == 0 && m_busy == 0; });
+}
+
+// takes the next item of the worker's own block, or else steals the last
+// item of another worker's
+bool WorkStealingPool::next(int worker, int *item)
+{
+    {
+        Worker &own = *m_workers[worker];
+        lock_guard<mutex> lock(own.mutex);
+        if (own.first < own.last) {
+            *item = own.first++;
+            return true;
+        }
+    }
+
+    int n = int(m_workers.size());
+    for (int i = 1; i < n; ++i) {
+        Worker &victim = *m_workers[(worker + i) % n];
+        lock_guard<mutex> lock(victim.mutex);
+        if (victim.first < victim.last) {
+            *item = --victim.last;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(int worker)
+{
+    unsigned seen = 0;
+    for (;;)
+    {
+        const Task *task;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+            task = m_task;
+            ++m_busy;
+        }
+
+        int item;
+        while (next(worker, &item)) {
+            (*task)(item);
+            --m_remaining;
+        }
+
+        lock_guard<mutex> lock(m_mutex);
+        --m_busy;
+        m_done.notify_all();
+    }
+}
+
+// --------------------------------------------------------------------------
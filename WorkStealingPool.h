@@ -0,0 +1,73 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------------------------
+
+// A fixed set of worker threads running parallel loops whose iterations
+// may differ widely in cost, e.g.
+//
+//      WorkStealingPool pool;
+//      pool.run(cases.size(), [&](int i) { simulate(cases[i]); });
+//
+// Each worker starts with a contiguous block of the iterations and works
+// through it from the front; a worker that runs out takes iterations from
+// the back of another worker's block, so expensive iterations clustered in
+// one block do not leave the other cores idle.  A block is only ever cut
+// from its ends, so it is kept as a range of indices, and running a loop
+// leaves the heap alone.
+
+class WorkStealingPool
+{
+public:
+    typedef std::function<void(int)> Task;
+
+private:
+    struct Worker
+    {
+        std::mutex          mutex;
+        int                 first, last;    // the items left, [first, last)
+        std::thread         thread;
+
+        Worker() : first(0), last(0) {}
+    };
+
+    std::vector<std::unique_ptr<Worker> > m_workers;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const Task             *m_task;
+    unsigned                m_generation;
+    int                     m_busy;         // workers between waking and running dry
+    std::atomic<int>        m_remaining;
+    bool                    m_stopping;
+
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    bool next(int worker, int *item);
+    void work(int worker);
+
+public:
+    // starts one thread per hardware thread if threads <= 0
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    int threadCount() const { return int(m_workers.size()); }
+
+    // runs task(i) for every i in [0, count) and returns when all are done;
+    // task is called concurrently from the worker threads
+    void run(int count, const Task &task);
+};
+
+// --------------------------------------------------------------------------
+
+#endif // WORKSTEALINGPOOL_H
@@ -7,10 +7,26 @@
 
 #include <QApplication>
 #include "MyMainWindow.h"
+#include "Trace.h"
+
+// Traces the delivery of every event, so that time spent in Qt's own event
+// handling shows up next to the zones in our handlers.
+class TracingApplication : public QApplication
+{
+public:
+    TracingApplication(int &argc, char **argv) : QApplication(argc, argv) {}
+
+    virtual bool notify(QObject *receiver, QEvent *event)
+    {
+        TRACE_ZONE("event");
+        return QApplication::notify(receiver, event);
+    }
+};
 
 int main(int argc, char *argv[])
 {
-    QApplication application(argc, argv);
+    TracingApplication application(argc, argv);
+    Trace::setThreadName("GUI");
 
     // initialize resources -- remember to change "Boilerplate" below!
     Q_INIT_RESOURCE(Integrator);
@@ -18,6 +34,11 @@ int main(int argc, char *argv[])
     MyMainWindow window;
     window.show();
 
+    // an optional scene file can be given on the command line
+    QStringList arguments = application.arguments();
+    if (arguments.size() > 1)
+        window.loadScene(arguments.at(1));
+
     return application.exec();
 }
 